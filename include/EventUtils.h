@@ -21,6 +21,7 @@
 #include <iostream>
 #include <string>
 #include <algorithm>
+#include <map>
 
 #include <syslog.h>
 using std::cout;
@@ -28,9 +29,18 @@ using std::endl;
 using std::string;
 
 #include "EventListener.h"
+#include "Logger.h"
 
 #define REQUEST_TIMEOUT_IN_MS 1000
 #define RDKSHELL_TIMEOUT_IN_MS 5000
+// Shutdown budget: all devices share one deadline for the unsubscribe replies, and the
+// websocket close handshake is not waited on for longer than this.
+#define SHUTDOWN_UNSUBSCRIBE_DEADLINE_IN_MS 100
+#define CLOSE_HANDSHAKE_TIMEOUT_IN_MS 50
+// Warm pool: how long a warmed app runs before it is suspended, and how long a warm-up that
+// failed or did not fit the budget, or an app that crashed, waits before it is warmed again.
+#define WARM_SETTLE_IN_MS 2000
+#define WARM_RETRY_INTERVAL_IN_MS 60000
 
 // These will be used for memory events to differentiate between critical and low memory states.
 template <typename T>
@@ -63,7 +73,6 @@ inline bool stringCompareIgnoreCase(const std::string &a, const std::string &b)
 }
 extern bool debug;
 extern bool tdebug;
-extern bool traceEnabled;
 bool isDebugEnabled();
 
 bool getMessageId(const string &jsonMsg, int &msgId);
@@ -82,8 +91,22 @@ bool getParamFromResult(const string &jsonMsg, const string & param, string &val
 #define COLOR_GREEN   "\033[32m"
 #define COLOR_CYAN    "\033[36m"
 
-#define LOGTRACE(fmt, ...) do { if (traceEnabled) { fprintf(stderr, COLOR_GREEN "TRACE [%s:%d] %s: " fmt COLOR_RESET "\n",  __FILENAME__, __LINE__, __FUNCTION__, ##__VA_ARGS__); fflush(stderr); } } while (0)
+// All levels go through the asynchronous Logger once it has been started (see Logger.h).
+// Each call is gated on the level of LOG_MODULE; levels above XDIAL_LOG_COMPILE_LEVEL fold
+// to a constant false and are dropped from the binary.
+#define LOG_AT_LEVEL(level, prefix, fmt, ...) do { if ((level) <= XDIAL_LOG_COMPILE_LEVEL && logLevelEnabled(LOG_MODULE, (level))) { logPrintf(prefix " [%s:%d] %s: " fmt COLOR_RESET "\n",  __FILENAME__, __LINE__, __FUNCTION__, ##__VA_ARGS__); } } while (0)
 
-#define LOGINFO(fmt, ...) do { fprintf(stderr, COLOR_WHITE "INFO [%s:%d] %s: " fmt COLOR_RESET "\n",  __FILENAME__, __LINE__, __FUNCTION__, ##__VA_ARGS__); fflush(stderr); } while (0)
-#define LOGWARN(fmt, ...) do { fprintf(stderr, COLOR_ORANGE "WARN [%s:%d] %s: " fmt COLOR_RESET "\n",  __FILENAME__, __LINE__, __FUNCTION__, ##__VA_ARGS__); fflush(stderr); } while (0)
-#define LOGERR(fmt, ...) do { fprintf(stderr, COLOR_RED "ERROR [%s:%d] %s: " fmt COLOR_RESET "\n",  __FILENAME__ , __LINE__, __FUNCTION__, ##__VA_ARGS__); fflush(stderr); } while (0)
+#define LOGTRACE(fmt, ...) LOG_AT_LEVEL(LOG_LEVEL_TRACE, COLOR_GREEN "TRACE", fmt, ##__VA_ARGS__)
+#define LOGINFO(fmt, ...) LOG_AT_LEVEL(LOG_LEVEL_INFO, COLOR_WHITE "INFO", fmt, ##__VA_ARGS__)
+#define LOGWARN(fmt, ...) LOG_AT_LEVEL(LOG_LEVEL_WARN, COLOR_ORANGE "WARN", fmt, ##__VA_ARGS__)
+#define LOGERR(fmt, ...) LOG_AT_LEVEL(LOG_LEVEL_ERROR, COLOR_RED "ERROR", fmt, ##__VA_ARGS__)
+
+// Logs a JSON frame at INFO, truncated and sampled per setPayloadLogging(); the whole frame at TRACE.
+#define LOGPAYLOAD(label, payload) do { \
+    if (LOG_LEVEL_INFO <= XDIAL_LOG_COMPILE_LEVEL && logLevelEnabled(LOG_MODULE, LOG_LEVEL_INFO)) { \
+        static std::atomic<unsigned> _payloadCalls{0}; \
+        const std::string &_payload = (payload); \
+        int _shown = logPayloadShownBytes(LOG_MODULE, _payload.size(), _payloadCalls); \
+        if (_shown >= 0) \
+            LOGINFO(label "%.*s%s", _shown, _payload.c_str(), static_cast<size_t>(_shown) < _payload.size() ? " ...(truncated)" : ""); \
+    } } while (0)
@@ -0,0 +1,147 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2022 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdarg>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Subsystems with independently adjustable log levels. A translation unit selects
+// its module by defining LOG_MODULE before its first include.
+enum LogModule {
+    LOG_MODULE_TRANSPORT,
+    LOG_MODULE_RESPONSE,
+    LOG_MODULE_PROTOCOL,
+    LOG_MODULE_MONITOR,
+    LOG_MODULE_COUNT
+};
+
+#ifndef LOG_MODULE
+#define LOG_MODULE LOG_MODULE_MONITOR
+#endif
+
+enum LogLevel {
+    LOG_LEVEL_ERROR,
+    LOG_LEVEL_WARN,
+    LOG_LEVEL_INFO,
+    LOG_LEVEL_TRACE
+};
+
+// Levels above this are compiled out of the binary (set with -DLOG_COMPILE_LEVEL=...).
+#ifndef XDIAL_LOG_COMPILE_LEVEL
+#define XDIAL_LOG_COMPILE_LEVEL LOG_LEVEL_TRACE
+#endif
+
+extern std::atomic<int> g_logLevels[LOG_MODULE_COUNT];
+
+inline bool logLevelEnabled(int module, int level)
+{
+    return level <= g_logLevels[module].load(std::memory_order_relaxed);
+}
+
+void setLogLevel(int module, LogLevel level);
+void setAllLogLevels(LogLevel level);
+// Applies "trace", "transport:trace,monitor:warn" or "all:info,response:trace".
+// Allocation free so it can run from a signal handler.
+bool applyLogLevelSpec(const char *spec);
+// Re-reads a level spec file with async-signal-safe calls only.
+bool reloadLogLevelsFromFile(const char *path);
+
+// Full frames are logged only at TRACE; at INFO they are sampled and truncated.
+void setPayloadLogging(size_t maxBytes, unsigned everyNth);
+// Number of payload bytes to show for this call, or -1 when the frame is sampled out.
+int logPayloadShownBytes(int module, size_t payloadSize, std::atomic<unsigned> &callCount);
+
+// What a producer does when its ring buffer has no room for a new record.
+enum class LogOverflowPolicy {
+    DROP,   // discard the record and count it; the writer reports the count later
+    BLOCK   // wait for the writer thread to make room
+};
+
+struct LogRing;
+
+/*
+ * Asynchronous logging backend behind the LOGxxx macros.
+ *
+ * Each logging thread owns a single-producer ring buffer. The calling thread only
+ * copies the format pointer and the raw arguments (strings by value) into its ring;
+ * formatting and the write to stderr happen on a background writer thread. Records
+ * carry a global sequence number so the writer can emit them in call order.
+ *
+ * Until start() is called (and after stop()), logging is synchronous as before.
+ */
+class Logger
+{
+    static Logger *mcp_INSTANCE;
+
+    std::atomic<bool> m_running;
+    LogOverflowPolicy m_policy;
+    size_t m_ringSize;
+
+    std::atomic<uint64_t> m_sequence;
+    std::atomic<bool> m_writerSleeping;
+
+    std::mutex m_ringsMutex;          // guards m_rings and m_dropped; taken once per thread on first log
+    std::vector<LogRing *> m_rings;
+    uint64_t m_dropped;
+
+    std::mutex m_wakeMutex;
+    std::condition_variable m_wakeCV;
+    std::thread *mp_writer;
+
+    Logger();
+    ~Logger() {}
+
+    LogRing *getThreadRing();
+    void runWriterLoop();
+    bool drainRings(std::string &out);
+    void wakeWriter();
+
+public:
+    static constexpr size_t DEFAULT_RING_SIZE = 64 * 1024;
+    // Strings longer than this are truncated when captured.
+    static constexpr size_t MAX_STRING_BYTES = 4096;
+
+    static Logger *getInstance();
+
+    void start(LogOverflowPolicy policy = LogOverflowPolicy::DROP, size_t ringSize = DEFAULT_RING_SIZE);
+    // Drains every ring and stops the writer. Logging is synchronous afterwards.
+    void stop();
+    bool isAsync() const { return m_running.load(std::memory_order_acquire); }
+
+    void vwrite(const char *fmt, va_list args);
+
+    // Records dropped under LogOverflowPolicy::DROP since start().
+    uint64_t getDroppedCount();
+
+    friend struct LogRing;
+
+    // no copying allowed
+    Logger(const Logger &) = delete;
+    Logger &operator=(const Logger &) = delete;
+};
+
+void logPrintf(const char *fmt, ...) __attribute__((format(printf, 1, 2)));
+bool parseLogOverflowPolicy(const char *name, LogOverflowPolicy &policy);
@@ -0,0 +1,153 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2022 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+enum class MetricType {
+    COUNTER,
+    GAUGE,
+    HISTOGRAM
+};
+
+// Common part of every registered metric; identified by name plus a rendered label set.
+class Metric
+{
+    std::string m_name;
+    std::string m_labels;
+    MetricType m_type;
+
+public:
+    Metric(const std::string &name, const std::string &labels, MetricType type)
+        : m_name(name), m_labels(labels), m_type(type) {}
+    virtual ~Metric() = default;
+
+    const std::string &getName() const { return m_name; }
+    const std::string &getLabels() const { return m_labels; }
+    MetricType getType() const { return m_type; }
+};
+
+class Counter : public Metric
+{
+    std::atomic<uint64_t> m_value{0};
+
+public:
+    Counter(const std::string &name, const std::string &labels) : Metric(name, labels, MetricType::COUNTER) {}
+
+    void inc(uint64_t n = 1) { m_value.fetch_add(n, std::memory_order_relaxed); }
+    uint64_t value() const { return m_value.load(std::memory_order_relaxed); }
+};
+
+class Gauge : public Metric
+{
+    std::atomic<int64_t> m_value{0};
+
+public:
+    Gauge(const std::string &name, const std::string &labels) : Metric(name, labels, MetricType::GAUGE) {}
+
+    void set(int64_t v) { m_value.store(v, std::memory_order_relaxed); }
+    void add(int64_t n = 1) { m_value.fetch_add(n, std::memory_order_relaxed); }
+    void sub(int64_t n = 1) { m_value.fetch_sub(n, std::memory_order_relaxed); }
+    int64_t value() const { return m_value.load(std::memory_order_relaxed); }
+};
+
+// Power-of-two buckets: bucket b counts values whose bit length is b, i.e. [2^(b-1), 2^b).
+class Histogram : public Metric
+{
+public:
+    static constexpr int BUCKETS = 40;
+
+private:
+    std::atomic<uint64_t> m_buckets[BUCKETS];
+    std::atomic<uint64_t> m_count{0};
+    std::atomic<uint64_t> m_sum{0};
+
+public:
+    Histogram(const std::string &name, const std::string &labels);
+
+    void observe(uint64_t v)
+    {
+        int b = v ? 64 - __builtin_clzll(v) : 0;
+        if (b >= BUCKETS)
+            b = BUCKETS - 1;
+        m_buckets[b].fetch_add(1, std::memory_order_relaxed);
+        m_count.fetch_add(1, std::memory_order_relaxed);
+        m_sum.fetch_add(v, std::memory_order_relaxed);
+    }
+    void observeSince(std::chrono::steady_clock::time_point start)
+    {
+        observe(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count());
+    }
+
+    uint64_t bucketCount(int b) const { return m_buckets[b].load(std::memory_order_relaxed); }
+    // Inclusive upper bound of bucket b.
+    static uint64_t bucketBound(int b) { return b == 0 ? 0 : (b >= 64 ? UINT64_MAX : (uint64_t(1) << b) - 1); }
+    uint64_t count() const { return m_count.load(std::memory_order_relaxed); }
+    uint64_t sum() const { return m_sum.load(std::memory_order_relaxed); }
+    // Upper bound of the bucket holding the q-quantile (0 < q <= 1).
+    uint64_t quantile(double q) const;
+};
+
+/*
+ * Process wide registry of counters, gauges and histograms.
+ *
+ * Lookups go through a fixed-size open addressing table whose slots are claimed with a
+ * compare-and-swap, so neither registration nor recording takes a lock. Callers on hot
+ * paths should resolve their metric once and keep the pointer; returned pointers stay
+ * valid for the life of the process and are never null.
+ */
+class MetricsRegistry
+{
+    static MetricsRegistry *mcp_INSTANCE;
+    static constexpr size_t CAPACITY = 4096;  // per-device labels multiply the series count
+
+    std::atomic<Metric *> m_slots[CAPACITY];
+
+    MetricsRegistry();
+    ~MetricsRegistry() {}
+
+    Metric *findOrCreate(const std::string &name, const std::string &labels, MetricType type);
+
+public:
+    static MetricsRegistry *getInstance();
+
+    Counter *counter(const std::string &name, const std::string &labels = "");
+    Gauge *gauge(const std::string &name, const std::string &labels = "");
+    Histogram *histogram(const std::string &name, const std::string &labels = "");
+
+    // Prometheus text exposition format (version 0.0.4). Refreshes the process_* gauges first.
+    std::string renderPrometheus();
+
+    // no copying allowed
+    MetricsRegistry(const MetricsRegistry &) = delete;
+    MetricsRegistry &operator=(const MetricsRegistry &) = delete;
+};
+
+// Samples resident set size, malloc heap in use, open descriptors and thread count of this
+// process into the process_* gauges.
+void updateProcessMetrics();
+
+// Renders key="value" with the value escaped for the exposition format.
+std::string metricLabel(const char *key, const std::string &value);
+
+// Joins two rendered label sets, either of which may be empty.
+std::string joinLabels(const std::string &first, const std::string &second);
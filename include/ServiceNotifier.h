@@ -0,0 +1,78 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2022 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <boost/asio/io_service.hpp>
+#include <boost/asio/steady_timer.hpp>
+
+/*
+ * Reports to systemd through sd_notify: STATUS= while starting up, READY=1 once casting is
+ * registered, STOPPING=1 on SIGTERM and WATCHDOG=1 while the process is healthy. Every call
+ * is a no-op when not started by systemd with Type=notify.
+ */
+class ServiceNotifier
+{
+public:
+    // Returns whether everything is still making progress; maxAge is how stale a heartbeat
+    // may be for that.
+    using HealthCheck = std::function<bool(std::chrono::steady_clock::duration maxAge)>;
+
+private:
+    static ServiceNotifier *mcp_INSTANCE;
+
+    HealthCheck m_healthy;
+    std::chrono::microseconds m_interval;
+    std::atomic<bool> m_running;
+    std::mutex m_lock;
+    std::condition_variable m_cv;
+    std::thread *mp_thread;
+    // Set when the watchdog runs as a timer on a caller's io service instead of mp_thread.
+    std::unique_ptr<boost::asio::steady_timer> mp_timer;
+
+    ServiceNotifier();
+    ~ServiceNotifier() {}
+
+    void runLoop();
+    void armTimer();
+    void ping();
+
+public:
+    static ServiceNotifier *getInstance();
+
+    void status(const char *format, ...) __attribute__((format(printf, 2, 3)));
+    void ready(const std::string &status);
+    void stopping();
+
+    // Sends WATCHDOG=1 every half WatchdogSec for as long as healthy() holds. Returns false
+    // when systemd has no watchdog configured for us. With io the pings are a timer on io.
+    bool startWatchdog(HealthCheck healthy, boost::asio::io_service *io = nullptr);
+    void stopWatchdog();
+
+    // no copying allowed
+    ServiceNotifier(const ServiceNotifier &) = delete;
+    ServiceNotifier &operator=(const ServiceNotifier &) = delete;
+};
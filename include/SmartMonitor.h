@@ -21,15 +21,27 @@
 #include <iostream>
 #include <cstring>
 #include <mutex>
+#include <atomic>
+#include <chrono>
+#include <vector>
 #include <map>
+#include <unordered_map>
 #include <condition_variable>
 #include "json/json.h"
 // #include "ConfigReader.h"
 #include "thunder/ThunderInterface.h"
+#include "thunder/IoServicePool.h"
 using std::string;
 
 typedef enum { YOUTUBE, NETFLIX, AMAZON, APPLIMIT } DialApps;
 
+// A DIAL request repeating one handled less than ms ago (same event, app, appId and payload)
+// is not acted on again; 0 handles every request.
+void setDialDedupWindow(unsigned ms);
+// While on (the default), a DIAL state change seen in RDKShell or Controller events is
+// reported to Xcast right away, once per change, instead of only when a sender asks.
+void setDialStatePush(bool enable);
+
 typedef struct appDialState_t
 {
 	DialApps app;
@@ -46,25 +58,118 @@ class SmartMonitor
   volatile bool m_isActive;
   volatile bool isConnected;
   std::mutex m_lock;
+  std::atomic<bool> m_stopping;
+  std::vector<int> m_unsubscribeIds;
   appDialState_t m_dialApps[DialApps::APPLIMIT];
+  string m_device;
+  string m_deviceLabel;
+  // Only touched from DIAL event handlers, which run one at a time.
+  // The last state request and the last other request handled for each app, with when they
+  // were handled; only a repeat of one of those is dropped.
+  struct RecentDialRequest {
+    string key;
+    std::chrono::steady_clock::time_point handled;
+  };
+  std::unordered_map<string, RecentDialRequest> m_recentDialRequests; // by app and kind of request
+  string m_reportedDialState[DialApps::APPLIMIT];  // last state reported to Xcast
+  // Set from the reply of a pushed state that Xcast did not take; see reportedDialState().
+  std::atomic<bool> m_pushFailed[DialApps::APPLIMIT];
+  string m_dialAppIds[DialApps::APPLIMIT];         // from the last DIAL request, for pushed states
+
+  // Warm pool: apps kept launched and suspended so a cast only has to resume them. Run by
+  // maintainWarmPool() on the device's supervision thread. m_warmLock[app] is held by a
+  // warm-up of the app and by a DIAL request for it, so the two never interleave. A request
+  // that finds a warm-up running does not wait for it: it cancels the warm-up and is queued
+  // in m_deferredDialRequests, which the warm-up hands back to event dispatch as it ends.
+  std::mutex m_warmLock[DialApps::APPLIMIT];
+  std::mutex m_deferLock;                              // guards the two below, and taking m_warmLock
+  std::vector<std::pair<DIALEVENTS, DialParams>> m_deferredDialRequests[DialApps::APPLIMIT];
+  std::atomic<bool> m_warmCancelled[DialApps::APPLIMIT]; // set by a request, cleared as a warm-up starts
+  bool m_warmApps[DialApps::APPLIMIT];                 // in the pool
+  // steady_clock ticks from which the app is to be warmed, 0 while it is not; set at startup,
+  // after a failed warm-up and after the app crashed, never after a requested stop.
+  std::atomic<int64_t> m_warmDue[DialApps::APPLIMIT];
+  bool m_warmed[DialApps::APPLIMIT];                   // launched by the pool, not exited since
+  // Launched by the pool and not asked for by a sender since; its state is not pushed to Xcast.
+  std::atomic<bool> m_poolHeld[DialApps::APPLIMIT];
+  int64_t m_warmFootprintKb[DialApps::APPLIMIT];       // free RAM the warm-up took, 0 until measured
+  int64_t m_warmBudgetKb;                              // 0 for no limit
 
   //  MonitorConfig *config;
 
-  static SmartMonitor *_instance;
   static const char *resCallsign;
   ThunderInterface *tiface;
+  ResponseHandler *mp_responses;  // single thread mode only; otherwise owned by tiface
+  IoServicePool *mp_pool;
+
+  // Gives the app ms to settle after a launch; cut short by stop, and by *cancelled turning
+  // true. Returns false when stopping.
+  bool settle(int ms, const std::atomic<bool> *cancelled = nullptr);
 
+  // Drops repeats of a request handled within the dedup window, then handles it.
   void onDialEvent(DIALEVENTS dialEvent, const DialParams &dialParams);
+  // False when the request could not be carried out.
+  bool handleDialEvent(DIALEVENTS dialEvent, const DialParams &dialParams);
+  // Counts a request dropped unanswered because the device is overloaded.
+  void shed(DIALEVENTS dialEvent, const DialParams &dialParams);
+  // Sheds the request if its last Thunder request was rejected as overloaded rather than failed.
+  bool shedIfRejected(DIALEVENTS dialEvent, const DialParams &dialParams);
+  // The state last reported to Xcast for app, empty once a push of it turned out to fail.
+  const string &reportedDialState(int app);
+  // Follow-up of a state event that updated the cache of app; crashed when Thunder reported
+  // that the app went down by a crash or a memory kill rather than on request.
+  void onAppStateChanged(int app, bool crashed = false);
+  // Has app warmed delayMs from now.
+  void scheduleWarmUp(int app, int delayMs);
+  // Reports the cached DIAL state of app to Xcast unless that is what it last reported.
+  void pushDialState(int app);
+  // Warms app unless a DIAL request for it is being handled or waiting, then hands the
+  // requests that came in meanwhile back to event dispatch.
+  void warmApp(int app);
+  // Launches and suspends app for the pool, within the memory budget; gives up, leaving the
+  // app to the sender, once a DIAL request cancels it.
+  void warmUp(int app);
+  // Handles the DIAL requests for app queued while it was being warmed, on the dispatch thread.
+  void runDeferredDialRequests(int app);
+  // Free RAM the pool's warmed apps took, by their measured footprints.
+  int64_t warmPoolKb() const;
+  // Index of appName in m_dialApps, APPLIMIT when it is not one of ours.
+  int findApp(const string &appName) const;
   void onRDKShellEvent(const std::string &event, const std::string &params);
   void onControllerStateChangeEvent(const std::string &event, const std::string &params);
 
-  SmartMonitor();
+public:
+  // One Thunder device session. device labels its metrics and logs; pool, when given, is the
+  // shared io pool its websocket runs on and must be stopped before the monitor is destroyed.
+  // A pool that runs on its caller puts event dispatch and cleanup on it too (single thread
+  // mode); the owner then runs the pool instead of calling waitForTermSignal().
+  explicit SmartMonitor(const string &device = "", IoServicePool *pool = nullptr);
   ~SmartMonitor();
-  void handleTermSignal(int _sig);
 
-public:
   int initialize();
+  // Unregisters from Thunder and releases waitForTermSignal(), waiting at most
+  // SHUTDOWN_UNSUBSCRIBE_DEADLINE_IN_MS for the acknowledgements.
+  void stop();
+  // stop() in two halves, so several devices can send their unsubscribes together and then
+  // share one deadline: beginStop() sends the batch and interrupts settle waits,
+  // finishStop() collects what is acknowledged by deadline and releases waitForTermSignal().
+  void beginStop();
+  void finishStop(std::chrono::steady_clock::time_point deadline);
+  // Closes the Thunder session and stops event dispatch. Called by the destructor; safe to
+  // call earlier to release the connection threads before the monitors are deleted.
+  void shutdown();
+  const string &getDeviceName() const
+  {
+    return m_device;
+  }
+  void setThunderConnectionURL(const string &wsurl);
+  bool startCapture(const string &path, size_t maxBytes);
+  void stopCapture();
   void connectToThunder();
+  std::chrono::steady_clock::time_point lastDispatchHeartbeat() const
+  {
+    return tiface->lastDispatchHeartbeat();
+  }
 
   void registerForEvents();
 
@@ -77,8 +182,11 @@ public:
   bool convertPluginStateToDIALState(const std::string &pluginState, std::string &dialState);
   bool isAppRunning(const string &myapp);
   bool setStandbyBehaviour();
-
-  static SmartMonitor *getInstance();
+  // Keeps appCallsigns (comma separated) launched and suspended for fast casting, using at
+  // most budgetMb of free RAM (0 for no limit). Call before startup; not for single thread mode.
+  void setWarmPool(const string &appCallsigns, unsigned budgetMb);
+  // Warms the pool apps that are not running; called periodically once the device is up.
+  void maintainWarmPool();
 
   // no copying allowed
   SmartMonitor(const SmartMonitor &) = delete;
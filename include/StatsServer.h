@@ -0,0 +1,95 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2022 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <memory>
+#include <string>
+#include <thread>
+#include <boost/asio/io_service.hpp>
+#include <boost/asio/posix/stream_descriptor.hpp>
+
+/*
+ * Local stats endpoint. Serves one command per connection on a Unix stream socket:
+ *
+ *     echo metrics | socat - UNIX-CONNECT:/tmp/xdialtester.sock
+ *
+ * "metrics" (also the default for an empty request) returns the MetricsRegistry in
+ * Prometheus text format. Other subsystems add commands with registerCommand().
+ * requestDump() is async-signal-safe and makes the server thread log a metrics dump.
+ */
+class StatsServer
+{
+public:
+    using CommandHandler = std::function<std::string(const std::string &args)>;
+
+private:
+    static StatsServer *mcp_INSTANCE;
+
+    std::string m_socketPath;
+    int m_listenFd;
+    int m_wakePipe[2];
+    std::atomic<bool> m_running;
+    std::thread *mp_thread;
+
+    // Set when the server runs as handlers on a caller's io service instead of mp_thread.
+    boost::asio::io_service *mp_io;
+    std::unique_ptr<boost::asio::posix::stream_descriptor> mp_wakeDescriptor;
+    std::unique_ptr<boost::asio::posix::stream_descriptor> mp_listenDescriptor;
+
+    std::mutex m_commandMutex;
+    std::map<std::string, CommandHandler> m_commands;
+
+    // A client served by handlers on the io service, see serveClientAsync().
+    struct AsyncClient;
+
+    StatsServer();
+    ~StatsServer() {}
+
+    void runLoop();
+    void handleWake();
+    void handleAccept();
+    void armWake();
+    void armAccept();
+    void serveClient(int fd);
+    // Reads the request and writes the reply without ever blocking the io service, which in
+    // --single-thread mode also runs event dispatch and the DIAL handlers.
+    void serveClientAsync(int fd);
+    void readRequest(const std::shared_ptr<AsyncClient> &client);
+    std::string runCommand(const std::string &request);
+    void logMetricsDump();
+
+public:
+    static StatsServer *getInstance();
+
+    // An empty socketPath runs without a socket (SIGUSR1 dumps only). With io the socket and
+    // dump requests are served by handlers on io rather than on a thread of the server's own.
+    bool start(const std::string &socketPath, boost::asio::io_service *io = nullptr);
+    void stop();
+
+    void registerCommand(const std::string &name, CommandHandler handler);
+    void requestDump();
+
+    // no copying allowed
+    StatsServer(const StatsServer &) = delete;
+    StatsServer &operator=(const StatsServer &) = delete;
+};
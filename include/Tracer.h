@@ -0,0 +1,119 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2022 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+struct TraceSpan {
+    uint64_t traceId;
+    uint64_t spanId;
+    uint64_t parentId;   // 0 for the root span of a trace
+    std::string name;
+    std::string detail;
+    int64_t startUs;     // steady clock
+    int64_t durationUs;
+    uint32_t tid;
+};
+
+// The trace and innermost open span of the calling thread.
+struct TraceContext {
+    uint64_t traceId;
+    uint64_t spanId;
+};
+
+/*
+ * Keeps the most recent completed spans in a fixed-size in-memory ring and exports
+ * them as Chrome trace-event JSON (loadable in Perfetto or chrome://tracing).
+ * Spans are opened with ScopedSpan; nesting follows the per-thread TraceContext.
+ */
+class Tracer
+{
+public:
+    static constexpr size_t DEFAULT_CAPACITY = 4096;
+
+private:
+    static Tracer *mcp_INSTANCE;
+
+    std::mutex m_ringMutex;
+    std::vector<TraceSpan> m_ring;
+    size_t m_next;
+    uint64_t m_recorded;
+    std::atomic<bool> m_enabled;
+    std::atomic<uint64_t> m_nextId;
+
+    Tracer();
+    ~Tracer() {}
+
+public:
+    static Tracer *getInstance();
+
+    // A capacity of 0 disables tracing.
+    void setCapacity(size_t capacity);
+    bool isEnabled() const { return m_enabled.load(std::memory_order_relaxed); }
+
+    uint64_t newId() { return m_nextId.fetch_add(1, std::memory_order_relaxed); }
+    void record(TraceSpan &&span);
+    void clear();
+
+    // Completed spans still in the ring, oldest first.
+    std::vector<TraceSpan> snapshot();
+    std::string exportChromeTrace();
+
+    // no copying allowed
+    Tracer(const Tracer &) = delete;
+    Tracer &operator=(const Tracer &) = delete;
+};
+
+TraceContext &currentTraceContext();
+int64_t traceTimestampUs(std::chrono::steady_clock::time_point tp = std::chrono::steady_clock::now());
+
+// Records an already finished interval as a child of the calling thread's current span.
+void recordSpan(const std::string &name, std::chrono::steady_clock::time_point start,
+                std::chrono::steady_clock::time_point end, const std::string &detail = "");
+
+/*
+ * Times the enclosing scope as a span. The first span opened on a thread without an
+ * active trace starts a new trace; spans opened while it is alive become its children.
+ */
+class ScopedSpan
+{
+    TraceSpan m_span;
+    TraceContext m_saved;
+    bool m_active;
+
+public:
+    explicit ScopedSpan(const char *name, const std::string &detail = "",
+                        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now());
+    ~ScopedSpan();
+
+    void setDetail(const std::string &detail)
+    {
+        if (m_active)
+            m_span.detail = detail;
+    }
+    uint64_t traceId() const { return m_active ? m_span.traceId : 0; }
+
+    ScopedSpan(const ScopedSpan &) = delete;
+    ScopedSpan &operator=(const ScopedSpan &) = delete;
+};
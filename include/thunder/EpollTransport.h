@@ -0,0 +1,121 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2022 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <random>
+#include <string>
+#include "Transport.h"
+#include "Heartbeat.h"
+#include "IoServicePool.h"
+#include "Metrics.h"
+
+/*
+ * Minimal in-tree WebSocket client for ws:// Thunder endpoints, built instead of the
+ * websocketpp TransportHandler with -DEPOLL_WEBSOCKET=ON. It does the opening handshake,
+ * masks what it sends, reassembles fragmented messages, answers pings, sends heartbeat pings
+ * (see Heartbeat.h) and closes cleanly;
+ * there is no TLS and no extension support.
+ *
+ * Each connection is serviced by one epoll loop on its connect() thread. sendMessage()
+ * writes straight to the socket from the calling thread and leaves only what did not fit
+ * to the loop. With a pool that runs on its owner (single thread mode), received frames
+ * and the connect callback are posted to the pool so they run on that thread, as they do
+ * with TransportHandler; otherwise they run on the loop thread.
+ */
+class EpollTransport : public Transport
+{
+    std::string m_wsUrl = "ws://127.0.0.1:9998/jsonrpc";
+    IoServicePool *mp_pool;
+
+    Counter *mp_framesOut;
+    Counter *mp_bytesOut;
+    Counter *mp_framesIn;
+    Counter *mp_bytesIn;
+
+    std::mutex m_stateMutex;
+    std::condition_variable m_stateChanged;
+
+    Heartbeat m_heartbeat;
+
+    int m_epollFd;
+    int m_wakeFd;                           // eventfd, written by disconnect()
+    std::atomic<bool> m_closeRequested{false};
+
+    // The socket and the frames not yet written to it, shared with sendMessage() callers.
+    std::mutex m_sendMutex;
+    int m_fd = -1;
+    std::string m_outbox;
+    bool m_writeArmed = false;              // EPOLLOUT is set because m_outbox did not fit
+    std::mt19937 m_random;                  // masking keys
+
+    // Only touched by the connect() thread.
+    std::string m_inbox;                    // bytes read but not yet parsed into frames
+    std::string m_message;                  // fragments of the message being received
+    int m_messageOpcode = -1;               // its opcode; -1 while no message is fragmented
+    bool m_closeSent = false;
+
+public:
+    // pool is only used to reach its thread in single thread mode; device labels the ws_* metrics.
+    explicit EpollTransport(IoServicePool *pool = nullptr, const std::string &device = "");
+    ~EpollTransport();
+
+    void setConnectURL(const std::string &url) override
+    {
+        m_wsUrl = url;
+    }
+    std::string getConnectURL()
+    {
+        return m_wsUrl;
+    }
+
+    bool waitForConnection(std::chrono::milliseconds timeout);
+
+    int initializeTransport() override;
+    void connect() override;
+    int sendMessage(const std::string &message) override;
+    void disconnect() override;
+
+private:
+    void setState(ConnectionState state);
+    // Runs fn on the pool's thread in single thread mode, else right here.
+    void runOnIo(std::function<void()> fn);
+    int openSocket(const std::string &host, const std::string &port, std::chrono::steady_clock::time_point deadline);
+    bool handshake(const std::string &host, const std::string &port, const std::string &path,
+                   std::chrono::steady_clock::time_point deadline);
+    // Waits for events on fd; false on timeout, error or disconnect().
+    bool waitReady(int fd, uint32_t events, std::chrono::steady_clock::time_point deadline);
+    void serviceConnection();
+    void closeSocket();
+    // Each returns false once the connection is finished.
+    bool readFrames();
+    bool parseFrames(std::chrono::steady_clock::time_point arrival);
+    bool onFrame(bool fin, uint8_t opcode, const char *payload, size_t size, std::chrono::steady_clock::time_point arrival);
+    bool protocolError(const char *reason, uint16_t code);
+    void deliver(std::string payload, std::chrono::steady_clock::time_point arrival);
+    void sendFrame(uint8_t opcode, const char *payload, size_t size);
+    void sendClose(uint16_t code);
+    // Writes as much of m_outbox as the socket takes; m_sendMutex must be held.
+    void flushLocked();
+};
@@ -0,0 +1,33 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2022 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+#include <memory>
+#include <string>
+
+// An inbound JSON-RPC frame. The payload stays owned by whatever read it off the connection
+// (the websocketpp message for TransportHandler) and is shared, never copied, on its way to
+// the reply table and the event queue. Readers take views into it (see JsonDocument.h).
+using Frame = std::shared_ptr<const std::string>;
+
+// For payloads that have no owner of their own: injected, replayed and loopback frames.
+inline Frame makeFrame(std::string payload)
+{
+    return std::make_shared<const std::string>(std::move(payload));
+}
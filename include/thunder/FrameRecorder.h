@@ -0,0 +1,96 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2022 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+/*
+ * Capture file layout: an 8 byte magic "XDCAP001" followed by records of
+ *
+ *     uint32 length | uint32 direction | uint64 monotonic timestamp (ns) | payload
+ *
+ * in host byte order, each padded to a multiple of 8 bytes. A record whose length
+ * is 0 marks the end of the capture (the tail of a file left by a crash is zeroed).
+ */
+enum class FrameDirection : uint32_t {
+    INBOUND = 1,
+    OUTBOUND = 2
+};
+
+struct CapturedFrame {
+    FrameDirection direction;
+    uint64_t timestampNs;
+    std::string payload;
+};
+
+/*
+ * Appends frames to a memory mapped capture file. The file is sized to maxBytes up
+ * front, writers claim space with an atomic add and copy into the mapping, so record()
+ * never takes a lock or makes a system call. Frames that do not fit are counted and dropped.
+ */
+class FrameRecorder
+{
+    int m_fd;
+    char *mp_base;
+    size_t m_capacity;
+    std::atomic<size_t> m_offset;
+    std::atomic<int> m_writers;
+    std::atomic<bool> m_open;
+    std::atomic<uint64_t> m_dropped;
+    std::string m_path;
+
+public:
+    static constexpr size_t DEFAULT_MAX_BYTES = 64 * 1024 * 1024;
+
+    FrameRecorder();
+    ~FrameRecorder();
+
+    bool open(const std::string &path, size_t maxBytes = DEFAULT_MAX_BYTES);
+    // Truncates the file to the recorded length and unmaps it.
+    void close();
+
+    void record(FrameDirection direction, const std::string &payload);
+
+    size_t bytesWritten() const { return m_offset.load(std::memory_order_relaxed); }
+    uint64_t droppedFrames() const { return m_dropped.load(std::memory_order_relaxed); }
+
+    FrameRecorder(const FrameRecorder &) = delete;
+    FrameRecorder &operator=(const FrameRecorder &) = delete;
+};
+
+// Sequential reader for capture files.
+class FrameReader
+{
+    int m_fd;
+    const char *mp_base;
+    size_t m_size;
+    size_t m_offset;
+
+public:
+    FrameReader();
+    ~FrameReader();
+
+    bool open(const std::string &path);
+    bool next(CapturedFrame &frame);
+
+    FrameReader(const FrameReader &) = delete;
+    FrameReader &operator=(const FrameReader &) = delete;
+};
@@ -0,0 +1,65 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2022 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include "Metrics.h"
+
+// Ping interval and the number of pongs in a row that may go missing before a connection is
+// declared stalled, for every Thunder connection. An interval of 0 disables the heartbeat.
+void setHeartbeat(unsigned intervalMs, unsigned maxMissed);
+
+/*
+ * WebSocket ping/pong bookkeeping of one Thunder connection. The transport asks for a ping
+ * every interval; a ping still unanswered by then counts as missed. The pong round trip is
+ * exported as thunder_ping_rtt_us. Thunder answers pings on its socket thread without
+ * entering any plugin, so this is the network and Thunder scheduling share of
+ * thunder_request_rtt_us.
+ */
+class Heartbeat
+{
+    std::mutex m_lock;
+    uint64_t m_sequence;
+    bool m_outstanding;
+    std::chrono::steady_clock::time_point m_sentAt;
+    unsigned m_missed;
+
+    Histogram *mp_rtt;
+    Counter *mp_missedPongs;
+    Counter *mp_stalls;
+
+public:
+    // labels are those of the transport's ws_* metrics.
+    explicit Heartbeat(const std::string &labels);
+
+    // The configured interval; zero when the heartbeat is off.
+    static std::chrono::milliseconds interval();
+
+    // Forgets the previous connection's ping; call once connected.
+    void reset();
+    // Called every interval. Sets the payload of the next ping, or returns false when the
+    // last maxMissed pings all went unanswered and the connection should be dropped.
+    bool tick(std::string &payload);
+    // A pong arrived. Any pong clears the missed count; only the answer to the latest ping is timed.
+    void pong(const std::string &payload);
+};
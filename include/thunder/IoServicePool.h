@@ -0,0 +1,65 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2022 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <boost/asio/io_service.hpp>
+#include <memory>
+#include <thread>
+#include <vector>
+
+/*
+ * One asio io_service run by a fixed number of threads and shared by every websocket
+ * transport created on it, so driving N devices costs N sockets rather than N io threads.
+ * A pool of zero threads is run by its owner (single thread mode): nothing services it
+ * unless the owner calls run(), run_for() or run_one() on ioService().
+ */
+class IoServicePool
+{
+    boost::asio::io_service m_ioService;
+    std::unique_ptr<boost::asio::io_service::work> mp_work;
+    std::vector<std::thread> m_threads;
+    bool m_runsOnCaller;
+
+public:
+    explicit IoServicePool(size_t threads);
+    // Calls stop().
+    ~IoServicePool();
+
+    boost::asio::io_service &ioService()
+    {
+        return m_ioService;
+    }
+    size_t threadCount() const
+    {
+        return m_threads.size();
+    }
+    bool runsOnCaller() const
+    {
+        return m_runsOnCaller;
+    }
+
+    // Abandons outstanding work and joins the threads. Transports using the pool must not
+    // be destroyed before this returns, their handlers may still be running until then.
+    void stop();
+
+    // no copying allowed
+    IoServicePool(const IoServicePool &) = delete;
+    IoServicePool &operator=(const IoServicePool &) = delete;
+};
@@ -0,0 +1,178 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2022 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+// Read-only JSON document for the replies and notifications we receive from Thunder. Parsing
+// builds the tree in a monotonic arena owned by the document (inline first, heap chunks only
+// for unusually large frames) and strings point into the frame itself, so a typical frame is
+// parsed without a single heap allocation. Only strings containing escapes are copied, decoded,
+// into the arena. Use jsoncpp for anything that builds or modifies JSON.
+
+enum class JsonType : uint8_t {
+    NULLVALUE,
+    BOOL,
+    INT,
+    DOUBLE,
+    STRING,
+    ARRAY,
+    OBJECT
+};
+
+// Characters inside the parsed frame or the document arena; not NUL terminated.
+struct JsonText {
+    const char *data;
+    size_t size;
+
+    bool operator==(const char *s) const { return std::strlen(s) == size && std::memcmp(data, s, size) == 0; }
+    bool operator==(const std::string &s) const { return s.size() == size && std::memcmp(data, s.data(), size) == 0; }
+    bool operator!=(const char *s) const { return !(*this == s); }
+    bool operator!=(const std::string &s) const { return !(*this == s); }
+    bool empty() const { return size == 0; }
+    std::string str() const { return std::string(data, size); }
+};
+
+struct JsonNode {
+    JsonType type;
+    bool boolean;
+    uint32_t count;     // members or elements
+    union {
+        int64_t integer;
+        double real;
+    };
+    JsonText text;      // STRING: decoded value; otherwise same as source
+    JsonText source;    // the value as it appears in the frame
+    JsonText key;       // member name inside an object
+    JsonNode *child;    // first member or element
+    JsonNode *next;     // next sibling
+};
+
+// Handle to a node of a JsonDocument, valid as long as the document. Lookups that miss yield a
+// null value, so paths can be chained like with Json::Value: doc.root()["result"]["state"].
+class JsonValue
+{
+    const JsonNode *mp_node;
+
+public:
+    class Iterator
+    {
+        const JsonNode *mp_node;
+    public:
+        explicit Iterator(const JsonNode *node) : mp_node(node) {}
+        JsonValue operator*() const { return JsonValue(mp_node); }
+        Iterator &operator++() { mp_node = mp_node->next; return *this; }
+        bool operator!=(const Iterator &other) const { return mp_node != other.mp_node; }
+        bool operator==(const Iterator &other) const { return mp_node == other.mp_node; }
+    };
+
+    explicit JsonValue(const JsonNode *node = nullptr) : mp_node(node) {}
+
+    JsonType type() const { return mp_node ? mp_node->type : JsonType::NULLVALUE; }
+    bool isNull() const { return type() == JsonType::NULLVALUE; }
+    bool isBool() const { return type() == JsonType::BOOL; }
+    bool isInt() const { return type() == JsonType::INT; }
+    bool isNumber() const { return type() == JsonType::INT || type() == JsonType::DOUBLE; }
+    bool isString() const { return type() == JsonType::STRING; }
+    bool isArray() const { return type() == JsonType::ARRAY; }
+    bool isObject() const { return type() == JsonType::OBJECT; }
+
+    // Members of an object or elements of an array; 0 for anything else.
+    size_t size() const { return (isObject() || isArray()) ? mp_node->count : 0; }
+    bool isMember(const char *key) const;
+    bool isMember(const std::string &key) const { return isMember(key.c_str()); }
+    // The last member named key, as jsoncpp resolves duplicates.
+    JsonValue operator[](const char *key) const;
+    JsonValue operator[](const std::string &key) const { return (*this)[key.c_str()]; }
+    JsonValue at(size_t index) const;
+    // Member name when this value sits inside an object.
+    JsonText key() const { return mp_node ? mp_node->key : JsonText{"", 0}; }
+
+    // Elements of an array or members of an object, in document order.
+    Iterator begin() const { return Iterator((isObject() || isArray()) ? mp_node->child : nullptr); }
+    Iterator end() const { return Iterator(nullptr); }
+
+    bool asBool() const;
+    int asInt() const;
+    int64_t asInt64() const;
+    double asDouble() const;
+    // Strings without copying; numbers, booleans and containers as their source text.
+    JsonText text() const;
+    // Copies strings, formats numbers and booleans; empty for null, arrays and objects.
+    std::string asString() const;
+    // The value exactly as it appeared in the frame; a string keeps its quotes and escapes.
+    std::string raw() const;
+};
+
+class JsonDocument
+{
+    static constexpr size_t INLINE_BYTES = 4096;
+    static constexpr size_t MIN_CHUNK_BYTES = 4096;
+    static constexpr int MAX_DEPTH = 64;
+
+    struct Chunk {
+        Chunk *next;
+    };
+
+    alignas(JsonNode) char m_inline[INLINE_BYTES];
+    char *mp_cursor;
+    char *mp_limit;
+    Chunk *mp_chunks;
+    size_t m_arenaBytes;
+
+    JsonNode *mp_root;
+    const char *mp_begin;
+    const char *mp_end;
+    const char *mp_error;
+    size_t m_errorOffset;
+
+    void *allocate(size_t bytes);
+    void release();
+    JsonNode *newNode(JsonType type);
+    bool fail(const char *error, const char *at);
+    bool parseValue(const char *&p, JsonNode *&node, int depth);
+    bool parseString(const char *&p, JsonText &out);
+    bool parseNumber(const char *&p, JsonNode *node);
+    bool parseContainer(const char *&p, JsonNode *node, int depth);
+
+public:
+    JsonDocument();
+    ~JsonDocument();
+
+    // Parses one JSON text. The frame is referenced, not copied, so it must outlive the
+    // document and every JsonValue taken from it. Reparsing discards the previous tree.
+    bool parse(const char *data, size_t size);
+    bool parse(const std::string &frame) { return parse(frame.data(), frame.size()); }
+    bool parse(std::string &&frame) = delete;
+
+    // Null until a parse succeeded.
+    JsonValue root() const { return JsonValue(mp_root); }
+    // Why and where (byte offset) the last parse failed.
+    const char *error() const { return mp_error; }
+    size_t errorOffset() const { return m_errorOffset; }
+    // Arena bytes taken by the tree and decoded strings.
+    size_t arenaBytes() const { return m_arenaBytes; }
+
+    // no copying allowed, values point into the arena
+    JsonDocument(const JsonDocument &) = delete;
+    JsonDocument &operator=(const JsonDocument &) = delete;
+};
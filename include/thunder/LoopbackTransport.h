@@ -0,0 +1,58 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2022 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <mutex>
+#include "Transport.h"
+
+/*
+ * In-process transport. A frame sent by the client is passed by reference to the peer on
+ * the sending thread, and frames the peer delivers go straight through processPayload on
+ * the peer's thread: no socket, no io thread and no copy of the payload. A peer that replies
+ * from inside its callback completes a request before sendMessage() returns.
+ */
+class LoopbackTransport : public Transport
+{
+public:
+    // Receives every frame the client sends; may call deliver() before returning.
+    using Peer = std::function<void(const std::string &frame)>;
+
+    explicit LoopbackTransport(Peer peer = nullptr) : m_peer(peer) {}
+
+    // Must be set before connect().
+    void setPeer(Peer peer)
+    {
+        m_peer = peer;
+    }
+    // Hands a reply or notification from the peer to the client; the string becomes the frame.
+    void deliver(std::string frame);
+
+    int initializeTransport() override { return 0; }
+    void setConnectURL(const std::string &) override {}
+    void connect() override;
+    int sendMessage(const std::string &message) override;
+    void disconnect() override;
+
+private:
+    Peer m_peer;
+    std::mutex m_stateMutex;
+    std::condition_variable m_stateChanged;
+};
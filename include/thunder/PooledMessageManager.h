@@ -0,0 +1,259 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2022 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <websocketpp/config/asio_no_tls_client.hpp>
+#include <cstddef>
+#include <mutex>
+#include <new>
+#include <vector>
+#include "Metrics.h"
+
+// Process wide accounting of the websocket message pools (there is one pool per connection).
+class MessagePoolStats
+{
+    static MessagePoolStats *mcp_INSTANCE;
+
+    Counter *mp_hits;
+    Counter *mp_misses;
+    Gauge *mp_hitPercent;
+    Gauge *mp_outstanding;
+
+    MessagePoolStats();
+    ~MessagePoolStats() {}
+
+public:
+    static MessagePoolStats *getInstance();
+
+    // A message was handed out, from the pool (hit) or newly made.
+    void acquired(bool hit);
+    // A message came back, to the pool or to the heap.
+    void released();
+
+    // no copying allowed
+    MessagePoolStats(const MessagePoolStats &) = delete;
+    MessagePoolStats &operator=(const MessagePoolStats &) = delete;
+};
+
+/*
+ * websocketpp message manager that recycles messages instead of allocating a message and a
+ * fresh payload string for every frame read or sent. Released messages go back to free lists
+ * by payload capacity (256 B to 64 KB) with their buffers intact, so a steady stream of small,
+ * similar frames runs without touching the heap; the shared_ptr control blocks are recycled
+ * too. Each list keeps at most MAX_IDLE messages and larger payloads are never kept.
+ *
+ * websocketpp creates one manager per connection. Messages may be released on any thread
+ * (see Frame.h); an outstanding message keeps its manager alive.
+ */
+template <typename message>
+class PooledMessageManager : public websocketpp::lib::enable_shared_from_this<PooledMessageManager<message>>
+{
+public:
+    typedef PooledMessageManager<message> type;
+    typedef websocketpp::lib::shared_ptr<type> ptr;
+    typedef websocketpp::lib::weak_ptr<type> weak_ptr;
+    typedef typename message::ptr message_ptr;
+
+    static constexpr size_t CLASSES = 5;
+    static constexpr size_t MAX_IDLE = 16;
+
+private:
+    // Hands out shared_ptr control blocks from the manager's free list.
+    template <typename T>
+    class BlockAllocator
+    {
+    public:
+        typedef T value_type;
+        template <typename U>
+        struct rebind {
+            typedef BlockAllocator<U> other;
+        };
+
+        ptr owner;
+
+        explicit BlockAllocator(ptr manager) : owner(std::move(manager)) {}
+        template <typename U>
+        BlockAllocator(const BlockAllocator<U> &other) : owner(other.owner) {}
+
+        T *allocate(size_t n) { return static_cast<T *>(owner->allocateBlock(n * sizeof(T))); }
+        void deallocate(T *p, size_t n) { owner->freeBlock(p, n * sizeof(T)); }
+
+        template <typename U>
+        bool operator==(const BlockAllocator<U> &other) const { return owner == other.owner; }
+        template <typename U>
+        bool operator!=(const BlockAllocator<U> &other) const { return owner != other.owner; }
+    };
+
+    // Runs while the control block, and with it the manager, is still alive.
+    struct Recycler {
+        type *manager;
+        void operator()(message *msg) const { manager->release(msg); }
+    };
+
+    static size_t classCapacity(size_t c) { return size_t(256) << (2 * c); }   // 256 B .. 64 KB
+    static size_t classFor(size_t size)
+    {
+        size_t c = 0;
+        while (c < CLASSES && classCapacity(c) < size)
+            c++;
+        return c;
+    }
+
+    std::mutex m_lock;
+    std::vector<message *> m_idle[CLASSES];
+    std::vector<void *> m_blocks;
+    size_t m_blockSize = 0;
+    MessagePoolStats *mp_stats = MessagePoolStats::getInstance();
+
+    message *acquire(size_t size)
+    {
+        message *msg = nullptr;
+        {
+            std::lock_guard<std::mutex> lock(m_lock);
+            for (size_t c = classFor(size); c < CLASSES && msg == nullptr; c++) {
+                if (!m_idle[c].empty()) {
+                    msg = m_idle[c].back();
+                    m_idle[c].pop_back();
+                }
+            }
+        }
+        mp_stats->acquired(msg != nullptr);
+        return msg;
+    }
+
+    message_ptr wrap(message *msg)
+    {
+        return message_ptr(msg, Recycler{this}, BlockAllocator<message>(this->shared_from_this()));
+    }
+
+    void release(message *msg)
+    {
+        std::string &payload = msg->get_raw_payload();
+        const size_t capacity = payload.capacity();
+        // A list holds messages with at least its capacity; anything past the largest is freed.
+        size_t c = classFor(capacity);
+        if (c < CLASSES && classCapacity(c) > capacity)
+            c = c == 0 ? CLASSES : c - 1;
+        bool pooled = false;
+        if (c < CLASSES) {
+            payload.clear();
+            msg->set_header("");
+            msg->set_prepared(false);
+            msg->set_fin(true);
+            msg->set_terminal(false);
+            msg->set_compressed(false);
+            std::lock_guard<std::mutex> lock(m_lock);
+            if (m_idle[c].size() < MAX_IDLE) {
+                m_idle[c].push_back(msg);
+                pooled = true;
+            }
+        }
+        mp_stats->released();
+        if (!pooled)
+            delete msg;
+    }
+
+    void *allocateBlock(size_t bytes)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_lock);
+            if (m_blockSize == 0)
+                m_blockSize = bytes;
+            if (bytes == m_blockSize && !m_blocks.empty()) {
+                void *block = m_blocks.back();
+                m_blocks.pop_back();
+                return block;
+            }
+        }
+        return ::operator new(bytes);
+    }
+
+    void freeBlock(void *block, size_t bytes)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_lock);
+            if (bytes == m_blockSize && m_blocks.size() < CLASSES * MAX_IDLE) {
+                m_blocks.push_back(block);
+                return;
+            }
+        }
+        ::operator delete(block);
+    }
+
+public:
+    PooledMessageManager()
+    {
+        for (auto &idle : m_idle)
+            idle.reserve(MAX_IDLE);
+        m_blocks.reserve(CLASSES * MAX_IDLE);
+    }
+
+    ~PooledMessageManager()
+    {
+        for (auto &idle : m_idle) {
+            for (message *msg : idle)
+                delete msg;
+        }
+        for (void *block : m_blocks)
+            ::operator delete(block);
+    }
+
+    // Frames websocketpp prepares for sending, and control frames.
+    message_ptr get_message()
+    {
+        message *msg = acquire(0);
+        if (msg == nullptr) {
+            msg = new message(this->shared_from_this());
+            msg->get_raw_payload().reserve(classCapacity(0));
+        }
+        return wrap(msg);
+    }
+
+    // Frames read off the socket and payloads queued for sending; size is a capacity hint.
+    message_ptr get_message(websocketpp::frame::opcode::value op, size_t size)
+    {
+        message *msg = acquire(size);
+        if (msg == nullptr) {
+            size_t c = classFor(size);
+            msg = new message(this->shared_from_this(), op, c < CLASSES ? classCapacity(c) : size);
+        } else {
+            msg->set_opcode(op);
+        }
+        return wrap(msg);
+    }
+
+    // Called by message::recycle(); recycling happens when the last message_ptr goes instead.
+    bool recycle(message *)
+    {
+        return false;
+    }
+
+    // no copying allowed
+    PooledMessageManager(const PooledMessageManager &) = delete;
+    PooledMessageManager &operator=(const PooledMessageManager &) = delete;
+};
+
+// websocketpp's asio client config with pooled message buffers.
+struct PooledAsioClientConfig : public websocketpp::config::asio_client {
+    typedef PooledAsioClientConfig type;
+    typedef websocketpp::message_buffer::message<PooledMessageManager> message_type;
+    typedef PooledMessageManager<message_type> con_msg_manager_type;
+    typedef websocketpp::message_buffer::alloc::endpoint_msg_manager<con_msg_manager_type> endpoint_msg_manager_type;
+};
@@ -24,6 +24,7 @@ using namespace std;
 
 #include "EventListener.h"
 #include "json/json.h"
+#include "JsonDocument.h"
 
 // Structure to hold app configuration data
 struct AppConfig {
@@ -32,9 +33,6 @@ struct AppConfig {
     std::string deeplinkmethod;
 };
 
-// Global app configuration list
-extern std::vector<AppConfig> g_appConfigList;
-
 string getSubscribeRequest(const string &callsignWithVer, const string &event, int &id);
 string getUnSubscribeRequest(const string &callsignWithVer, const string &event, int &id);
 string getMemoryLimitRequest(int lowMem, int criticalMem, int &id);
@@ -46,9 +44,12 @@ string isCastingEnabledToJson(int &);
 string setStandbyBehaviourToJson(int &id);
 bool parseJson(const string &jsonMsg, Json::Value &root);
 bool getParamObjectFromJsonString(const std::string &input, Json::Value &jObjOut);
+// Same without copying: params points into doc, which references input.
+bool getParamObjectFromJsonString(const std::string &input, JsonDocument &doc, JsonValue &params);
 bool convertResultStringToArray(const string &root, const string key, vector<string> &arr);
 bool convertResultStringToBool(const string &root, bool &);
 bool convertResultStringToBool(const string &jsonMsg, const string &key, bool &response);
+bool convertResultStringToInt64(const string &jsonMsg, const string &key, int64_t &value);
 bool isJsonRpcResultNull(const string &jsonMsg);
 bool checkForThunderErrorResponse(const string &jsonMsg);
 bool convertEventSubResponseToInt(const string &root, int &);
@@ -59,4 +60,4 @@ string setAppStateToJson(const string &appName, const string &appId, const strin
 string launchAppToJson(const string &appName, int &id);
 string suspendAppToJson(const string &appName, int &id);
 string shutdownAppToJson(const string &appName, int &id);
-string sendDeepLinkToJson(const DialParams &dialParams, int &id);
+string sendDeepLinkToJson(const DialParams &dialParams, const std::vector<AppConfig> &appConfigs, int &id);
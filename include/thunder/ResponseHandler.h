@@ -20,6 +20,7 @@
 #pragma once
 #include <string>
 #include <vector>
+#include <atomic>
 #include <mutex>
 #include <map>
 #include <unordered_map>
@@ -29,9 +30,16 @@
 #include <chrono>
 #include <future>
 #include <memory>
+#include <functional>
+#include <boost/asio/io_service.hpp>
+#include <boost/asio/io_context_strand.hpp>
+#include <boost/asio/steady_timer.hpp>
 
 #include "EventUtils.h"
 #include "EventListener.h"
+#include "Frame.h"
+#include "JsonDocument.h"
+#include "Metrics.h"
 
 // Request state tracking
 enum class RequestState {
@@ -44,23 +52,63 @@ enum class RequestState {
 // Request context for tracking individual requests
 struct RequestContext {
     int msgId;
-    std::string response;
+    Frame response;
     RequestState state;
     std::chrono::steady_clock::time_point createdAt;
-    std::promise<std::string> promise;
+    std::promise<Frame> promise;
+    // Set for a request nobody waits for; takes the reply instead of the promise.
+    std::function<void(Frame)> onReply;
+    // The pending count of the request's method, for requests registered with one.
+    unsigned *methodPending;
 
     RequestContext(int id) : msgId(id), state(RequestState::PENDING),
-                           createdAt(std::chrono::steady_clock::now()) {}
+                           createdAt(std::chrono::steady_clock::now()), methodPending(nullptr) {}
 };
 
+// A Thunder notification waiting for dispatch, stamped when it came off the socket. Move-only,
+// so a queued frame changes hands without touching its reference count.
+struct QueuedEvent {
+    Frame frame;
+    std::chrono::steady_clock::time_point arrival;
+    // The app an app state event is about, empty for every other event; see setEventCoalescing().
+    std::string stateKey;
+    // Set instead of frame for work the listener handed back to dispatch, see postTask().
+    std::function<void()> task;
+
+    QueuedEvent() = default;
+    QueuedEvent(Frame f, std::chrono::steady_clock::time_point at) : frame(std::move(f)), arrival(at) {}
+    QueuedEvent(QueuedEvent &&) = default;
+    QueuedEvent &operator=(QueuedEvent &&) = default;
+    QueuedEvent(const QueuedEvent &) = delete;
+    QueuedEvent &operator=(const QueuedEvent &) = delete;
+};
+
+// Event handlers that run longer than this are reported with the spans they spent their time
+// in, and while still running by the cleanup thread or timer; 0 disables the check.
+void setHandlerBudget(unsigned ms);
+// Bounds on the events of one session waiting for dispatch: past maxQueued (0 for no cap)
+// further events are dropped. The session counts as overloaded once half of maxQueued is
+// waiting, or once the event being dispatched waited maxLagMs (0 to ignore the wait).
+void setEventQueueLimits(unsigned maxQueued, unsigned maxLagMs);
+// Caps on the requests of one session in its pending request table: maxPending in total and
+// maxPerMethod per method, 0 for no cap. A request over a cap waits up to waitMs for a slot
+// and is then rejected as overloaded. Requests sent without waiting for their reply, and all
+// requests in single thread mode, are rejected at once.
+void setRequestLimits(unsigned maxPending, unsigned maxPerMethod, unsigned waitMs);
+
+// While on (the default), an app state event (RDKShell lifecycle or Controller statechange)
+// replaces the one for the same app queued since the last DIAL request, so only the latest
+// is dispatched. DIAL requests are never merged or moved.
+void setEventCoalescing(bool enable);
+
+// Pending request table and event queue of one Thunder session. Each device session owns
+// its own instance, so replies and events of different devices never share a lock.
 class ResponseHandler
 {
-    static ResponseHandler *mcp_INSTANCE;
-
     // Data structures
-    std::vector<std::string> m_eventQueue;
+    std::vector<QueuedEvent> m_eventQueue;
     std::unordered_map<int, std::unique_ptr<RequestContext>> m_pendingRequests;
-    std::unordered_set<int> m_completedRequests;
+    size_t m_completedCount;
 
     // Mutexes for thread safety
     mutable std::mutex m_requestMutex;     // For request/response operations (mutable for const methods)
@@ -69,46 +117,158 @@ class ResponseHandler
     // Condition variables
     std::condition_variable m_requestCV; // For request/response notifications
     std::condition_variable m_eventCV;   // For event notifications
+    std::condition_variable m_slotCV;    // For requests waiting for a slot in the pending table
+
+    // Entries of m_pendingRequests per method, guarded by m_requestMutex. Entries are never
+    // removed, so RequestContext::methodPending stays valid.
+    std::unordered_map<std::string, unsigned> m_pendingByMethod;
+
+    // Events queued or taken for dispatch and not dispatched yet; the queue itself only holds
+    // those that arrived since the dispatcher took the last batch.
+    std::atomic<size_t> m_backlog;
+    // steady_clock ticks of the arrival of the event being dispatched; 0 between events.
+    std::atomic<int64_t> m_dispatchArrival;
+    bool m_dropping;   // dropping events at the cap, guarded by m_eventMutex
+
+    // Requests in a row that got no reply; from STALL_TIMEOUTS on Thunder is taken as stalled.
+    std::atomic<unsigned> m_consecutiveTimeouts;
+    std::chrono::steady_clock::time_point m_lastProbe;   // guarded by m_requestMutex
 
     std::thread *mp_thandle;
     std::thread *mp_cleanupThread;
 
-    bool m_runLoop;
+    std::atomic<bool> m_runLoop;
     EventListener *mp_listener;
 
+    // Single thread mode: dispatch and cleanup run as handlers on mp_io, no threads of our own.
+    boost::asio::io_service *mp_io;
+    std::unique_ptr<boost::asio::io_service::strand> mp_strand;
+    std::unique_ptr<boost::asio::steady_timer> mp_cleanupTimer;
+    std::unique_ptr<boost::asio::steady_timer> mp_heartbeatTimer;
+    std::unique_ptr<boost::asio::steady_timer> mp_budgetTimer;
+    bool m_drainPosted;   // guarded by m_eventMutex
+    bool m_dispatching;   // only touched on the io thread
+
+    std::string m_device;
+    std::string m_deviceLabel;
+    Gauge *mp_eventQueueDepth;
+    Gauge *mp_pendingRequests;
+    Counter *mp_lateResponses;
+    Counter *mp_coalescedEvents;
+    Counter *mp_droppedEvents;
+    // Dispatch metrics of one event type, resolved on its first dispatch.
+    struct EventMetrics {
+        std::string type;
+        Counter *dispatched;
+        Histogram *queueWait;
+        Histogram *handler;
+        Counter *overBudget;
+    };
+    // By full event name; only touched by whichever thread dispatches events.
+    std::unordered_map<std::string, EventMetrics> m_eventMetrics;
+    // steady_clock ticks of the last pass of the dispatch loop, idle or not.
+    std::atomic<int64_t> m_heartbeat;
+
+    // The handler currently running on the dispatch thread, for the budget watchdog.
+    std::atomic<int64_t> m_handlerStart;   // steady_clock ticks; 0 while no handler runs
+    std::atomic<bool> m_handlerFlagged;    // already reported as over budget
+    std::mutex m_handlerMutex;
+    std::string m_handlerName;             // guarded by m_handlerMutex
+
     // Configuration
     static constexpr std::chrono::seconds CLEANUP_INTERVAL{30};
     static constexpr std::chrono::seconds MAX_REQUEST_AGE{300}; // 5 minutes
+    static constexpr std::chrono::seconds HEARTBEAT_INTERVAL{1};
+    static constexpr unsigned STALL_TIMEOUTS = 3;
+    static constexpr std::chrono::seconds STALL_PROBE_INTERVAL{1};
+
+    using PendingRequests = std::unordered_map<int, std::unique_ptr<RequestContext>>;
+    // Removes an entry and hands its slot to a request waiting for one; m_requestMutex held.
+    PendingRequests::iterator eraseRequest(PendingRequests::iterator it);
 
     void runEventLoop();
     void runCleanupLoop();
     void cleanupExpiredRequests();
-    void processEvent(const std::string& eventMsg);
+    // Fails the requests sent without waiting whose reply is REQUEST_TIMEOUT_IN_MS overdue.
+    void expireDetachedRequests();
+    // Counts a request that got no reply towards STALL_TIMEOUTS.
+    void noteTimeout();
+    void drainEvents();
+    // Gets the dispatcher to the queue; called with m_eventMutex held after queuing.
+    void wakeDispatch();
+    void scheduleCleanup();
+    void scheduleHeartbeat();
+    void beat();
+    void scheduleBudgetCheck();
+    // Reports the running handler once it has exceeded the handler budget.
+    void checkHandlerBudget();
+    const EventMetrics &eventMetrics(const std::string &eventName);
+    void dispatchToListener(const std::string &eventName, const std::string &eventMsg);
+    // Waits for the reply; in single thread mode by running the io service meanwhile.
+    std::future_status waitForReply(std::future<Frame> &future, int timeout);
     std::string extractParamsFromJsonRpc(const std::string& jsonRpcMsg);
 
-protected:
-    ResponseHandler() : mp_thandle(nullptr), mp_cleanupThread(nullptr), m_runLoop(true),
-                       mp_listener(nullptr) {}
-    ~ResponseHandler() {}
-
 public:
-    static ResponseHandler *getInstance();
+    // device labels this session's metrics; empty for the single device setup.
+    explicit ResponseHandler(const std::string &device = "");
+    ~ResponseHandler();
+
+    // Starts the event dispatch and cleanup threads.
     void initialize();
+    // Single thread mode: events are dispatched in order on a strand of io and cleanup is a
+    // timer on it. getRequestStatus() then runs io until the reply arrives, so requests may be
+    // made from event handlers and from the thread that runs io, but from no other thread.
+    void initialize(boost::asio::io_service &io);
     void shutdown();
 
     void handleEvent();
-    void addMessageToEventQueue(const std::string& msg);
+    // message is the parse the frame was routed by, if the caller has one; app state events
+    // without it are queued as is and never coalesced.
+    void addMessageToEventQueue(Frame frame,
+                                std::chrono::steady_clock::time_point arrival = std::chrono::steady_clock::now(),
+                                const JsonValue &message = JsonValue());
+    // Runs task where events are dispatched, after the events queued before it. Never dropped
+    // or coalesced; for a listener that has to put off part of its handling of an event.
+    void postTask(std::function<void()> task);
+    // On disconnect, fails every pending request at once.
     void connectionEvent(bool connected);
-    void addMessageToResponseQueue(int msgId, const std::string& msg);
-    std::string getRequestStatus(int msgId, int timeout = REQUEST_TIMEOUT_IN_MS);
+    void addMessageToResponseQueue(int msgId, Frame frame);
+    // Dispatches one event to the listener on the calling thread (normally the event thread),
+    // recording its queue wait and handler time per event type.
+    void processEvent(const QueuedEvent& event);
+    // Creates the pending entry for msgId so a reply that beats getRequestStatus() is kept.
+    // Not counted against the caps of setRequestLimits().
+    void registerRequest(int msgId);
+    // The same for a request to method, within the caps of setRequestLimits(). False, with
+    // nothing registered, when the session is at a cap and no slot frees up in time; the
+    // request must then not be sent.
+    bool registerRequest(int msgId, const std::string &method);
+    // For a request sent without waiting: onReply gets the reply on the thread that reads it,
+    // or null once the connection is lost or no reply came within REQUEST_TIMEOUT_IN_MS. It is
+    // not called for a request cancelled by cancelRequest() or at shutdown. Never waits for a
+    // slot.
+    bool registerRequest(int msgId, const std::string &method, std::function<void(Frame)> onReply);
+    // The reply, or null on timeout, cancellation or shutdown.
+    Frame getRequestStatus(int msgId, int timeout = REQUEST_TIMEOUT_IN_MS);
+
+    // False when the request must not be sent: Thunder has stopped answering and a request
+    // sent less than STALL_PROBE_INTERVAL ago is already probing whether it is back, so this
+    // one would only sit out its timeout.
+    bool admitRequest();
+    // True while Thunder is stalled or event dispatch is behind (see setEventQueueLimits());
+    // callers use it to skip optional requests.
+    bool overloaded() const;
 
     // Async operations
-    std::future<std::string> getRequestAsync(int msgId);
+    std::future<Frame> getRequestAsync(int msgId);
     bool cancelRequest(int msgId);
 
     // Statistics and monitoring
     size_t getPendingRequestCount() const;
     size_t getCompletedRequestCount() const;
+    // The dispatch loop beats at least every HEARTBEAT_INTERVAL while it is not stuck in a
+    // handler; an old heartbeat means event dispatch is wedged.
+    std::chrono::steady_clock::time_point lastHeartbeat() const;
     void clearCompletedRequests();
 
     void registerEventListener(EventListener *listener) {
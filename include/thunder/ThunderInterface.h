@@ -23,18 +23,48 @@
 #include <map>
 #include <mutex>
 #include <thread>
+#include <atomic>
+#include <chrono>
 #include "json/json.h"
 
 #include "EventUtils.h"
-#include "TransportHandler.h"
+#include "Transport.h"
 #include "EventListener.h"
 #include "ProtocolHandler.h"  // Include for AppConfig definition
 
+class ResponseHandler;
+class Gauge;
+class Counter;
+class Histogram;
+
+// Number of connections opened for requests besides the one carrying the event subscriptions,
+// so replies do not queue behind event bursts; 0 keeps everything on a single connection.
+void setRequestConnections(unsigned count);
+unsigned requestConnections();
+
+// Outcome of a request to Thunder. OVERLOADED requests were not sent: Thunder has stopped
+// answering and another request is probing whether it is back.
+enum class RequestResult
+{
+    OK,
+    SEND_FAILED,
+    TIMEOUT,
+    OVERLOADED
+};
+
 class ThunderInterface : public EventListener
 {
 public:
-    ThunderInterface();
+    // Takes ownership of transport. Defaults to the websocket transport (WebSocketTransport.h) and a
+    // ResponseHandler of its own; a caller supplied ResponseHandler must be initialized and
+    // outlive this object. device labels the request metrics of this session.
+    explicit ThunderInterface(Transport *transport = nullptr, ResponseHandler *responses = nullptr,
+                              const std::string &device = "");
     virtual ~ThunderInterface();
+    // Takes ownership of transport and uses it for requests only; call before initialize().
+    // With one request connection it takes every request, with more the first is reserved for
+    // latency critical requests (launch, deeplink, app state) and bulk requests share the rest.
+    void addRequestConnection(Transport *transport);
     int initialize();
 
     void setThunderConnectionURL(const std::string &wsurl);
@@ -42,6 +72,22 @@ public:
 
     void shutdown();
 
+    bool startCapture(const std::string &path, size_t maxBytes = FrameRecorder::DEFAULT_MAX_BYTES);
+    void stopCapture();
+    // Feeds a captured inbound frame through the transport as if it came from Thunder.
+    void injectFrame(std::string payload);
+    // Last sign of life of this session's event dispatch, see ResponseHandler::lastHeartbeat().
+    std::chrono::steady_clock::time_point lastDispatchHeartbeat() const;
+    // True while Thunder is stalled or event dispatch is behind (see setEventQueueLimits());
+    // optional requests are better skipped meanwhile.
+    bool isOverloaded() const;
+    // Runs task on the event dispatch thread after the events already queued, see
+    // ResponseHandler::postTask().
+    void postToDispatch(std::function<void()> task);
+    // Outcome of the last request made on the calling thread, so the callers of the requests
+    // below can tell a request rejected as overloaded from one that timed out.
+    RequestResult lastRequestResult() const;
+
     // no copying allowed
     ThunderInterface(const ThunderInterface &) = delete;
     ThunderInterface &operator=(const ThunderInterface &) = delete;
@@ -58,6 +104,11 @@ public:
     void removeDialListener() override;
     void removeRDKShellListener() override;
 	void removeControllerStateChangeListener() override;
+    // Drops all listeners and sends the unsubscribe of every event in one batch, without
+    // waiting for replies. Returns the request ids to hand to awaitReplies().
+    std::vector<int> unsubscribeAll();
+    // Collects the replies to ids until deadline; returns how many were acknowledged.
+    size_t awaitReplies(const std::vector<int> &ids, std::chrono::steady_clock::time_point deadline);
     bool enableCasting(bool enable = true);
     bool isCastingEnabled(std::string &result);
     bool getFriendlyName(std::string &name);
@@ -68,27 +119,88 @@ public:
     std::vector<string> & getActiveApplications(int timeout = RDKSHELL_TIMEOUT_IN_MS);
     bool setAppState( const std::string &appName, const std::string &appId, const std::string &state, int timeout = REQUEST_TIMEOUT_IN_MS);
     bool reportDIALAppState(const std::string &appName, const std::string &appId, const std::string &state);
+    // Sends a DIAL state (running, stopped, hidden or suspended) to Xcast without waiting for the
+    // reply. onResult learns whether Xcast took it, on the thread the reply or the failure turns
+    // up on. False when it was not sent; onResult is then not called.
+    bool pushDIALAppState(const std::string &appName, const std::string &appId, const std::string &state,
+                          std::function<void(bool)> onResult);
     bool launchPremiumApp(const std::string &appName, int timeout = RDKSHELL_TIMEOUT_IN_MS);
     bool shutdownPremiumApp(const std::string &appName, int timeout = RDKSHELL_TIMEOUT_IN_MS);
     bool suspendPremiumApp(const std::string &appName, int timeout = RDKSHELL_TIMEOUT_IN_MS);
     bool sendDeepLinkRequest(const DialParams &dialParams);
+    // Free RAM of the device in KB, as RDKShell reports it.
+    bool getSystemFreeMemory(int64_t &freeKb);
 
 private:
-    TransportHandler *mp_handler;
+    // One websocket to Thunder. The first is the event connection: it carries the subscriptions,
+    // so Thunder sends the events there, and every request while it is the only one.
+    struct Connection
+    {
+        Transport *transport;
+        std::thread *thread;   // services a transport that does not connect asynchronously
+        bool up;               // guarded by m_connMutex
+        Gauge *inflight;
+        Counter *requests;
+    };
+
+    // Request metrics of one method, resolved from the registry once per session.
+    struct MethodMetrics
+    {
+        std::string method;
+        Histogram *rtt;
+        Counter *timeouts;
+        Counter *sendFailures;
+        Counter *rejected;
+    };
+
+    // A request method, declared function-local static where the request is made so that its
+    // metrics are found by index, without locks or lookups by name.
+    struct ThunderMethod
+    {
+        const char *name;
+        size_t index;
+
+        explicit ThunderMethod(const char *methodName);
+    };
+    // Bound on the ThunderMethod call sites; raise it when adding more.
+    static constexpr size_t MAX_METHODS = 32;
+
+    std::vector<Connection> m_connections;
+    std::mutex m_connMutex;
+    std::atomic<unsigned> m_nextBulk;
+    ResponseHandler *mp_responses;
+    bool m_ownsResponses;
     bool m_isInitialized;
     std::vector<std::string> m_appList;
+    std::vector<AppConfig> m_appConfigList;
+    std::string m_deviceLabel;
+    // Indexed by ThunderMethod::index and filled in on the first request of each method.
+    std::atomic<const MethodMetrics *> m_methodMetrics[MAX_METHODS];
+    // Deeplink methods come from appConfig.json, so these are labelled deeplink@<app> and kept
+    // in the order of m_appConfigList.
+    std::vector<MethodMetrics> m_deeplinkMetrics;
 
     std::function<void(bool)> m_connListener;
 
-    std::thread *mp_thThread;
-
-    void connected(bool connected);
-    void onMsgReceived(const std::string message);
-    void onEventReceived(const Json::Value& event);
+    void connected(size_t index, bool connected);
+    // The connection that carries method.
+    Connection &route(const char *method);
+    MethodMetrics resolveMethodMetrics(const std::string &method) const;
+    const MethodMetrics &methodMetrics(const ThunderMethod &method);
+    void connect(Connection &conn);
+    void onMsgReceived(Frame frame);
+    void onEventReceived(Frame frame, std::chrono::steady_clock::time_point arrival, const JsonValue &message);
     void registerEvent(const std::string &event, bool isBinding);
     void registerEvent(const std::string &callsignWithVersion, const std::string &event, bool isBinding);
-    bool sendMessage(const std::string jsonmsg, int msgId, int timeout = REQUEST_TIMEOUT_IN_MS);
-    bool sendSubscriptionMessage(const std::string jsonmsg, int msgId, int timeout = REQUEST_TIMEOUT_IN_MS);
+    // Sends a request and waits for the reply, recording per-method latency, timeout and
+    // send-failure metrics. The reply is null unless the result is OK.
+    RequestResult invoke(const MethodMetrics &metrics, const std::string &jsonmsg, int msgId, int timeout, Frame &reply);
+    RequestResult invoke(const ThunderMethod &method, const std::string &jsonmsg, int msgId, int timeout, Frame &reply)
+    {
+        return invoke(methodMetrics(method), jsonmsg, msgId, timeout, reply);
+    }
+    bool sendMessage(const ThunderMethod &method, const std::string jsonmsg, int msgId, int timeout = REQUEST_TIMEOUT_IN_MS);
+    bool sendSubscriptionMessage(const ThunderMethod &method, const std::string jsonmsg, int msgId, int timeout = REQUEST_TIMEOUT_IN_MS);
 
     void onDialEvents(DIALEVENTS dialEvent, const DialParams &dialParams) override;
 	void onRDKShellEvents(const std::string &event, const std::string &params) override;
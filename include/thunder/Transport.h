@@ -0,0 +1,104 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2022 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <string>
+#include "Frame.h"
+#include "FrameRecorder.h"
+#include "JsonDocument.h"
+
+enum class ConnectionState {
+    DISCONNECTED,
+    CONNECTING,
+    CONNECTED,
+    DISCONNECTING,
+    ERROR_STATE
+};
+
+// Replies (and frames that are not valid JSON) go to the message callback, notifications to the
+// event callback; arrival is when the frame came off the connection. Both take the frame by
+// value so it can be moved on into a queue. message is the parse the frame was routed by,
+// valid only during the call, so event receivers need not parse it again.
+using MessageCallback = std::function<void(Frame frame)>;
+using EventCallback = std::function<void(Frame frame, std::chrono::steady_clock::time_point arrival,
+                                         const JsonValue &message)>;
+
+/*
+ * Carries JSON-RPC frames between ThunderInterface and Thunder. Implementations own the
+ * connection; routing of inbound frames to the message and event handlers and frame
+ * capture are shared here, so every transport delivers replies and events the same way.
+ */
+class Transport
+{
+protected:
+    std::atomic<ConnectionState> m_connectionState{ConnectionState::DISCONNECTED};
+
+    std::function<void(bool)> m_conHandler;
+    MessageCallback m_msgHandler;
+    EventCallback m_eventHandler;
+
+    FrameRecorder m_recorder;
+
+public:
+    Transport() : m_conHandler(nullptr), m_msgHandler(nullptr), m_eventHandler(nullptr) {}
+    virtual ~Transport() = default;
+
+    virtual int initializeTransport() = 0;
+    virtual void setConnectURL(const std::string &url) = 0;
+    // Connects and services the connection until disconnect(); runs on a dedicated thread.
+    // Transports driven by a shared io pool return as soon as the connect is issued.
+    virtual void connect() = 0;
+    // True when connect() only issues the connect, so it needs no thread of its own.
+    virtual bool connectsAsynchronously() const
+    {
+        return false;
+    }
+    // Returns 1 when the frame was handed to the connection, -1 when not connected.
+    virtual int sendMessage(const std::string &message) = 0;
+    virtual void disconnect() = 0;
+
+    bool isConnected()
+    {
+        return m_connectionState.load() == ConnectionState::CONNECTED;
+    }
+    ConnectionState getConnectionState() const
+    {
+        return m_connectionState.load();
+    }
+
+    void registerConnectionHandler(std::function<void(bool)> callback);
+    void registerMessageHandler(MessageCallback callback);
+    void registerEventHandler(EventCallback callback);
+
+    // Records every frame sent and received to an mmap'd capture file (see FrameRecorder.h).
+    bool startCapture(const std::string &path, size_t maxBytes = FrameRecorder::DEFAULT_MAX_BYTES);
+    void stopCapture();
+
+    // Routes one inbound frame to the message or event handler, as if received on the socket.
+    // Transports pass the time the frame was read so queueing delay is measured from there.
+    void processPayload(Frame frame, std::chrono::steady_clock::time_point arrival = std::chrono::steady_clock::now());
+
+    // no copying allowed
+    Transport(const Transport &) = delete;
+    Transport &operator=(const Transport &) = delete;
+};
@@ -21,52 +21,53 @@
 
 #include <websocketpp/config/asio_no_tls_client.hpp>
 #include <websocketpp/client.hpp>
-#include <functional>
 #include <string>
 #include <atomic>
 #include <mutex>
 #include <condition_variable>
 #include <chrono>
-#include "json/json.h"
-
-// Our websocket client
-typedef websocketpp::client<websocketpp::config::asio_client> wsclient;
+#include <memory>
+#include <boost/asio/steady_timer.hpp>
+#include "Transport.h"
+#include "Heartbeat.h"
+#include "IoServicePool.h"
+#include "PooledMessageManager.h"
+#include "Metrics.h"
+
+// Our websocket client, reusing message buffers across frames
+typedef websocketpp::client<PooledAsioClientConfig> wsclient;
 // Pointer to response
-typedef websocketpp::config::asio_client::message_type::ptr message_ptr;
-
-enum class ConnectionState {
-    DISCONNECTED,
-    CONNECTING,
-    CONNECTED,
-    DISCONNECTING,
-    ERROR_STATE
-};
+typedef PooledAsioClientConfig::message_type::ptr message_ptr;
 
-// Event callback type for notifications
-using EventCallback = std::function<void(const Json::Value&)>;
-
-class TransportHandler
+// Transport to a Thunder JSON-RPC endpoint over websocketpp/asio.
+class TransportHandler : public Transport
 {
     std::string m_wsUrl = "ws://127.0.0.1:9998/jsonrpc";
     websocketpp::connection_hdl m_wsHdl;
     wsclient m_client;
+    IoServicePool *mp_pool;
+
+    Counter *mp_framesOut;
+    Counter *mp_bytesOut;
+    Counter *mp_framesIn;
+    Counter *mp_bytesIn;
 
-    std::atomic<ConnectionState> m_connectionState{ConnectionState::DISCONNECTED};
     std::mutex m_stateMutex;
     std::condition_variable m_stateChanged;
 
-    std::atomic<uint32_t> m_requestIdCounter{1};
+    Heartbeat m_heartbeat;
+    std::mutex m_heartbeatMutex;   // the timer is armed and cancelled from different io threads
+    std::unique_ptr<boost::asio::steady_timer> mp_heartbeatTimer;
 
-    std::function<void(bool)> m_conHandler;
-    std::function<void(std::string)> m_msgHandler;
-    EventCallback m_eventHandler;
+    std::atomic<uint32_t> m_requestIdCounter{1};
 
 public:
-    TransportHandler() : m_conHandler(nullptr), m_msgHandler(nullptr), m_eventHandler(nullptr)
-    {
-    }
+    // Without a pool the connection runs its own io loop on the connect() thread. With one,
+    // connect() only starts the handshake and the pool's threads service the socket.
+    // device labels the ws_* metrics; empty for the single device setup.
+    explicit TransportHandler(IoServicePool *pool = nullptr, const std::string &device = "");
 
-    void setConnectURL(const std::string &url)
+    void setConnectURL(const std::string &url) override
     {
         m_wsUrl = url;
     }
@@ -75,16 +76,6 @@ public:
         return m_wsUrl;
     }
 
-    bool isConnected()
-    {
-        return m_connectionState.load() == ConnectionState::CONNECTED;
-    }
-
-    ConnectionState getConnectionState() const
-    {
-        return m_connectionState.load();
-    }
-
     std::string generateRequestId()
     {
         return std::to_string(m_requestIdCounter.fetch_add(1));
@@ -92,17 +83,22 @@ public:
 
     bool waitForConnection(std::chrono::milliseconds timeout);
 
-    int initializeTransport();
-    void registerConnectionHandler(std::function<void(bool)> callback);
-    void registerMessageHandler(std::function<void(const std::string)> callback);
-    void registerEventHandler(EventCallback callback);
-    void connect();
-    int sendMessage(std::string message);
-    void disconnect();
+    int initializeTransport() override;
+    void connect() override;
+    bool connectsAsynchronously() const override
+    {
+        return mp_pool != nullptr;
+    }
+    int sendMessage(const std::string &message) override;
+    void disconnect() override;
 
 private:
     void connected(websocketpp::connection_hdl hdl);
     void connectFailed(websocketpp::connection_hdl hdl);
     void processResponse(websocketpp::connection_hdl hdl, message_ptr msg);
     void disconnected(websocketpp::connection_hdl hdl);
+    void scheduleHeartbeat();
+    void cancelHeartbeat();
+    // Pings Thunder, or drops the connection once too many pings went unanswered.
+    void sendHeartbeat();
 };
@@ -0,0 +1,30 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2022 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+// The transport for ws:// Thunder endpoints, chosen at build time: websocketpp by default,
+// the in-tree epoll client with -DEPOLL_WEBSOCKET=ON. Both take (IoServicePool *, device).
+#ifdef XDIAL_EPOLL_WEBSOCKET
+#include "EpollTransport.h"
+typedef EpollTransport WebSocketTransport;
+#else
+#include "TransportHandler.h"
+typedef TransportHandler WebSocketTransport;
+#endif
@@ -0,0 +1,783 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2022 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <strings.h>
+#include <cstdint>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include "Logger.h"
+
+Logger *Logger::mcp_INSTANCE{nullptr};
+
+std::atomic<int> g_logLevels[LOG_MODULE_COUNT] = {
+    {LOG_LEVEL_INFO}, {LOG_LEVEL_INFO}, {LOG_LEVEL_INFO}, {LOG_LEVEL_INFO}
+};
+
+static std::atomic<size_t> s_payloadMaxBytes{256};
+static std::atomic<unsigned> s_payloadEveryNth{1};
+
+constexpr size_t Logger::DEFAULT_RING_SIZE;
+constexpr size_t Logger::MAX_STRING_BYTES;
+
+namespace {
+
+constexpr uint32_t RECORD_WRAP = 1;
+constexpr size_t RECORD_ALIGN = 8;
+constexpr std::chrono::milliseconds WRITER_IDLE_WAIT{10};
+
+inline size_t alignRecord(size_t n)
+{
+    return (n + RECORD_ALIGN - 1) & ~(RECORD_ALIGN - 1);
+}
+
+struct RecordHeader
+{
+    uint32_t size;   // bytes including this header, multiple of RECORD_ALIGN
+    uint32_t flags;
+    uint64_t seq;
+    const char *fmt;
+};
+
+constexpr size_t HEADER_SIZE = (sizeof(RecordHeader) + RECORD_ALIGN - 1) & ~(RECORD_ALIGN - 1);
+
+enum LengthModifier { LEN_NONE, LEN_HH, LEN_H, LEN_L, LEN_LL, LEN_J, LEN_Z, LEN_T, LEN_BIGL };
+
+// One printf conversion, "%-08.*zu" style, as written in the format string.
+struct FormatSpec
+{
+    const char *begin;
+    size_t length;
+    char conv;
+    LengthModifier lenMod;
+    bool starWidth;
+    bool starPrecision;
+};
+
+// p points just past '%'. Returns the character following the conversion.
+const char *parseSpec(const char *p, FormatSpec &spec)
+{
+    spec.begin = p - 1;
+    spec.starWidth = false;
+    spec.starPrecision = false;
+    spec.lenMod = LEN_NONE;
+
+    while (*p && strchr("-+ #0'I", *p))
+        p++;
+    if (*p == '*') {
+        spec.starWidth = true;
+        p++;
+    } else {
+        while (*p >= '0' && *p <= '9')
+            p++;
+    }
+    if (*p == '.') {
+        p++;
+        if (*p == '*') {
+            spec.starPrecision = true;
+            p++;
+        } else {
+            while (*p >= '0' && *p <= '9')
+                p++;
+        }
+    }
+    switch (*p) {
+    case 'h':
+        spec.lenMod = (p[1] == 'h') ? LEN_HH : LEN_H;
+        p += (p[1] == 'h') ? 2 : 1;
+        break;
+    case 'l':
+        spec.lenMod = (p[1] == 'l') ? LEN_LL : LEN_L;
+        p += (p[1] == 'l') ? 2 : 1;
+        break;
+    case 'q': spec.lenMod = LEN_LL; p++; break;
+    case 'j': spec.lenMod = LEN_J; p++; break;
+    case 'z':
+    case 'Z': spec.lenMod = LEN_Z; p++; break;
+    case 't': spec.lenMod = LEN_T; p++; break;
+    case 'L': spec.lenMod = LEN_BIGL; p++; break;
+    default: break;
+    }
+    spec.conv = *p;
+    if (*p)
+        p++;
+    spec.length = p - spec.begin;
+    return p;
+}
+
+inline bool isSignedConv(char c) { return c == 'd' || c == 'i'; }
+inline bool isUnsignedConv(char c) { return c == 'o' || c == 'u' || c == 'x' || c == 'X' || c == 'c'; }
+inline bool isFloatConv(char c) { return strchr("fFeEgGaA", c) != nullptr && c != '\0'; }
+
+int64_t readSigned(va_list &ap, LengthModifier len)
+{
+    switch (len) {
+    case LEN_L: return va_arg(ap, long);
+    case LEN_LL: return va_arg(ap, long long);
+    case LEN_J: return va_arg(ap, intmax_t);
+    case LEN_Z: return va_arg(ap, ssize_t);
+    case LEN_T: return va_arg(ap, ptrdiff_t);
+    default: return va_arg(ap, int);
+    }
+}
+
+uint64_t readUnsigned(va_list &ap, LengthModifier len)
+{
+    switch (len) {
+    case LEN_L: return va_arg(ap, unsigned long);
+    case LEN_LL: return va_arg(ap, unsigned long long);
+    case LEN_J: return va_arg(ap, uintmax_t);
+    case LEN_Z: return va_arg(ap, size_t);
+    case LEN_T: return static_cast<uint64_t>(va_arg(ap, ptrdiff_t));
+    default: return va_arg(ap, unsigned int);
+    }
+}
+
+/*
+ * Copies the arguments consumed by fmt into out, or only measures them when out is null.
+ * Every scalar takes an aligned 8 byte slot (long double takes as many as it needs);
+ * strings are stored as a 32 bit length followed by the NUL terminated bytes.
+ */
+size_t encodeArgs(const char *fmt, va_list args, char *out)
+{
+    va_list ap;
+    va_copy(ap, args);
+    size_t pos = 0;
+    auto put = [&](const void *src, size_t n) {
+        if (out)
+            memcpy(out + pos, src, n);
+        pos += alignRecord(n);
+    };
+
+    for (const char *p = fmt; *p;) {
+        if (*p++ != '%')
+            continue;
+        if (*p == '%') {
+            p++;
+            continue;
+        }
+        FormatSpec spec;
+        p = parseSpec(p, spec);
+        int precision = -1;
+        if (spec.starWidth) {
+            int64_t v = va_arg(ap, int);
+            put(&v, sizeof(v));
+        }
+        if (spec.starPrecision) {
+            precision = va_arg(ap, int);
+            int64_t v = precision;
+            put(&v, sizeof(v));
+        }
+
+        if (isSignedConv(spec.conv)) {
+            int64_t v = readSigned(ap, spec.lenMod);
+            put(&v, sizeof(v));
+        } else if (isUnsignedConv(spec.conv)) {
+            uint64_t v = (spec.conv == 'c') ? static_cast<uint64_t>(va_arg(ap, int)) : readUnsigned(ap, spec.lenMod);
+            put(&v, sizeof(v));
+        } else if (isFloatConv(spec.conv)) {
+            if (spec.lenMod == LEN_BIGL) {
+                long double v = va_arg(ap, long double);
+                put(&v, sizeof(v));
+            } else {
+                double v = va_arg(ap, double);
+                put(&v, sizeof(v));
+            }
+        } else if (spec.conv == 's') {
+            const char *s = va_arg(ap, const char *);
+            if (s == nullptr)
+                s = "(null)";
+            size_t limit = Logger::MAX_STRING_BYTES;
+            if (!spec.starPrecision) {
+                const char *dot = static_cast<const char *>(memchr(spec.begin, '.', spec.length));
+                if (dot)
+                    precision = atoi(dot + 1);
+            }
+            if (precision >= 0 && static_cast<size_t>(precision) < limit)
+                limit = precision;
+            uint32_t len = static_cast<uint32_t>(strnlen(s, limit));
+            if (out) {
+                memcpy(out + pos, &len, sizeof(len));
+                memcpy(out + pos + sizeof(len), s, len);
+                out[pos + sizeof(len) + len] = '\0';
+            }
+            pos += alignRecord(sizeof(len) + len + 1);
+        } else if (spec.conv == 'p') {
+            uint64_t v = reinterpret_cast<uintptr_t>(va_arg(ap, void *));
+            put(&v, sizeof(v));
+        } else if (spec.conv == 'n') {
+            (void)va_arg(ap, void *);
+        }
+    }
+    va_end(ap);
+    return pos;
+}
+
+template <typename T>
+void appendFormatted(std::string &out, const char *spec, int stars, int s0, int s1, T value)
+{
+    char buf[256];
+    int n;
+    switch (stars) {
+    case 2: n = snprintf(buf, sizeof(buf), spec, s0, s1, value); break;
+    case 1: n = snprintf(buf, sizeof(buf), spec, s0, value); break;
+    default: n = snprintf(buf, sizeof(buf), spec, value); break;
+    }
+    if (n < 0)
+        return;
+    if (static_cast<size_t>(n) < sizeof(buf)) {
+        out.append(buf, n);
+        return;
+    }
+    size_t offset = out.size();
+    out.resize(offset + n + 1);
+    switch (stars) {
+    case 2: snprintf(&out[offset], n + 1, spec, s0, s1, value); break;
+    case 1: snprintf(&out[offset], n + 1, spec, s0, value); break;
+    default: snprintf(&out[offset], n + 1, spec, value); break;
+    }
+    out.resize(offset + n);
+}
+
+// Formats one record previously written by encodeArgs and appends it to out.
+void formatRecord(const char *fmt, const char *args, std::string &out)
+{
+    size_t pos = 0;
+    auto take = [&](void *dst, size_t n) {
+        memcpy(dst, args + pos, n);
+        pos += alignRecord(n);
+    };
+
+    const char *literal = fmt;
+    for (const char *p = fmt; *p;) {
+        if (*p != '%') {
+            p++;
+            continue;
+        }
+        out.append(literal, p - literal);
+        p++;
+        if (*p == '%') {
+            out.push_back('%');
+            literal = ++p;
+            continue;
+        }
+        FormatSpec spec;
+        p = parseSpec(p, spec);
+        literal = p;
+
+        char specText[32];
+        if (spec.length >= sizeof(specText)) {
+            out.append(spec.begin, spec.length);
+            continue;
+        }
+        memcpy(specText, spec.begin, spec.length);
+        specText[spec.length] = '\0';
+
+        int stars = 0;
+        int starArgs[2] = {0, 0};
+        if (spec.starWidth) {
+            int64_t v;
+            take(&v, sizeof(v));
+            starArgs[stars++] = static_cast<int>(v);
+        }
+        if (spec.starPrecision) {
+            int64_t v;
+            take(&v, sizeof(v));
+            starArgs[stars++] = static_cast<int>(v);
+        }
+
+        if (isSignedConv(spec.conv)) {
+            int64_t v;
+            take(&v, sizeof(v));
+            switch (spec.lenMod) {
+            case LEN_L: appendFormatted(out, specText, stars, starArgs[0], starArgs[1], static_cast<long>(v)); break;
+            case LEN_LL: appendFormatted(out, specText, stars, starArgs[0], starArgs[1], static_cast<long long>(v)); break;
+            case LEN_J: appendFormatted(out, specText, stars, starArgs[0], starArgs[1], static_cast<intmax_t>(v)); break;
+            case LEN_Z: appendFormatted(out, specText, stars, starArgs[0], starArgs[1], static_cast<ssize_t>(v)); break;
+            case LEN_T: appendFormatted(out, specText, stars, starArgs[0], starArgs[1], static_cast<ptrdiff_t>(v)); break;
+            default: appendFormatted(out, specText, stars, starArgs[0], starArgs[1], static_cast<int>(v)); break;
+            }
+        } else if (isUnsignedConv(spec.conv)) {
+            uint64_t v;
+            take(&v, sizeof(v));
+            if (spec.conv == 'c') {
+                appendFormatted(out, specText, stars, starArgs[0], starArgs[1], static_cast<int>(v));
+                continue;
+            }
+            switch (spec.lenMod) {
+            case LEN_L: appendFormatted(out, specText, stars, starArgs[0], starArgs[1], static_cast<unsigned long>(v)); break;
+            case LEN_LL: appendFormatted(out, specText, stars, starArgs[0], starArgs[1], static_cast<unsigned long long>(v)); break;
+            case LEN_J: appendFormatted(out, specText, stars, starArgs[0], starArgs[1], static_cast<uintmax_t>(v)); break;
+            case LEN_Z: appendFormatted(out, specText, stars, starArgs[0], starArgs[1], static_cast<size_t>(v)); break;
+            case LEN_T: appendFormatted(out, specText, stars, starArgs[0], starArgs[1], static_cast<ptrdiff_t>(v)); break;
+            default: appendFormatted(out, specText, stars, starArgs[0], starArgs[1], static_cast<unsigned int>(v)); break;
+            }
+        } else if (isFloatConv(spec.conv)) {
+            if (spec.lenMod == LEN_BIGL) {
+                long double v;
+                take(&v, sizeof(v));
+                appendFormatted(out, specText, stars, starArgs[0], starArgs[1], v);
+            } else {
+                double v;
+                take(&v, sizeof(v));
+                appendFormatted(out, specText, stars, starArgs[0], starArgs[1], v);
+            }
+        } else if (spec.conv == 's') {
+            uint32_t len;
+            memcpy(&len, args + pos, sizeof(len));
+            const char *s = args + pos + sizeof(len);
+            pos += alignRecord(sizeof(len) + len + 1);
+            if (spec.length == 2)
+                out.append(s, len); // plain "%s", the common case
+            else
+                appendFormatted(out, specText, stars, starArgs[0], starArgs[1], s);
+        } else if (spec.conv == 'p') {
+            uint64_t v;
+            take(&v, sizeof(v));
+            appendFormatted(out, specText, stars, starArgs[0], starArgs[1], reinterpret_cast<void *>(static_cast<uintptr_t>(v)));
+        }
+    }
+    out.append(literal);
+}
+
+} // namespace
+
+// Single producer (the owning thread), single consumer (the writer thread).
+struct LogRing
+{
+    char *buffer;
+    size_t size;
+    size_t mask;
+    std::atomic<uint64_t> head;     // written by the producer
+    std::atomic<uint64_t> tail;     // written by the writer
+    std::atomic<uint64_t> dropped;
+    std::atomic<bool> retired;      // owning thread has exited
+
+    explicit LogRing(size_t capacity) : buffer(new char[capacity]), size(capacity), mask(capacity - 1),
+                                        head(0), tail(0), dropped(0), retired(false) {}
+    ~LogRing() { delete[] buffer; }
+
+    // Reserves a contiguous record of recordSize bytes, writing a wrap marker when
+    // the record would straddle the end of the buffer. Returns null when full.
+    char *reserve(size_t recordSize, uint64_t &newHead)
+    {
+        uint64_t h = head.load(std::memory_order_relaxed);
+        uint64_t t = tail.load(std::memory_order_acquire);
+        size_t offset = h & mask;
+        size_t pad = (offset + recordSize > size) ? size - offset : 0;
+        if ((h - t) + pad + recordSize > size)
+            return nullptr;
+        if (pad) {
+            RecordHeader marker;
+            marker.size = static_cast<uint32_t>(pad);
+            marker.flags = RECORD_WRAP;
+            memcpy(buffer + offset, &marker, 2 * sizeof(uint32_t));
+            h += pad;
+            offset = 0;
+        }
+        newHead = h + recordSize;
+        return buffer + offset;
+    }
+};
+
+namespace {
+
+struct ThreadRingHolder
+{
+    LogRing *ring = nullptr;
+    ~ThreadRingHolder()
+    {
+        if (ring)
+            ring->retired.store(true, std::memory_order_release);
+    }
+};
+
+thread_local ThreadRingHolder t_ringHolder;
+thread_local bool t_inWrite = false;
+
+// A ring is a power of two so positions can be masked.
+size_t roundUpPow2(size_t n)
+{
+    size_t v = 1024;
+    while (v < n)
+        v <<= 1;
+    return v;
+}
+
+} // namespace
+
+Logger::Logger() : m_running(false), m_policy(LogOverflowPolicy::DROP), m_ringSize(DEFAULT_RING_SIZE),
+                   m_sequence(0), m_writerSleeping(false), m_dropped(0), mp_writer(nullptr)
+{
+}
+
+Logger *Logger::getInstance()
+{
+    if (Logger::mcp_INSTANCE == nullptr)
+    {
+        Logger::mcp_INSTANCE = new Logger();
+    }
+    return Logger::mcp_INSTANCE;
+}
+
+bool parseLogOverflowPolicy(const char *name, LogOverflowPolicy &policy)
+{
+    if (strcmp(name, "drop") == 0) {
+        policy = LogOverflowPolicy::DROP;
+        return true;
+    } else if (strcmp(name, "block") == 0) {
+        policy = LogOverflowPolicy::BLOCK;
+        return true;
+    }
+    return false;
+}
+
+void Logger::start(LogOverflowPolicy policy, size_t ringSize)
+{
+    if (m_running.load())
+        return;
+    m_policy = policy;
+    m_ringSize = roundUpPow2(ringSize < 4 * MAX_STRING_BYTES ? 4 * MAX_STRING_BYTES : ringSize);
+    m_running.store(true, std::memory_order_release);
+    mp_writer = new std::thread([this] { runWriterLoop(); });
+}
+
+void Logger::stop()
+{
+    if (!m_running.exchange(false))
+        return;
+    wakeWriter();
+    if (mp_writer && mp_writer->joinable()) {
+        mp_writer->join();
+        delete mp_writer;
+        mp_writer = nullptr;
+    }
+
+    // Pick up anything logged while the writer was exiting.
+    std::string out;
+    drainRings(out);
+    if (!out.empty()) {
+        fwrite(out.data(), 1, out.size(), stderr);
+        fflush(stderr);
+    }
+}
+
+LogRing *Logger::getThreadRing()
+{
+    if (t_ringHolder.ring == nullptr) {
+        LogRing *ring = new LogRing(m_ringSize);
+        {
+            std::lock_guard<std::mutex> lock(m_ringsMutex);
+            m_rings.push_back(ring);
+        }
+        t_ringHolder.ring = ring;
+    }
+    return t_ringHolder.ring;
+}
+
+void Logger::wakeWriter()
+{
+    if (m_writerSleeping.load(std::memory_order_acquire))
+        m_wakeCV.notify_one();
+}
+
+void Logger::vwrite(const char *fmt, va_list args)
+{
+    // Synchronous until started, and when re-entered from a signal handler on this thread.
+    if (!isAsync() || t_inWrite) {
+        vfprintf(stderr, fmt, args);
+        fflush(stderr);
+        return;
+    }
+    t_inWrite = true;
+
+    size_t recordSize = alignRecord(HEADER_SIZE + encodeArgs(fmt, args, nullptr));
+
+    LogRing *ring = getThreadRing();
+    if (recordSize > ring->size / 2) {
+        // Too big to queue; rare enough to write in place.
+        vfprintf(stderr, fmt, args);
+        fflush(stderr);
+        t_inWrite = false;
+        return;
+    }
+
+    uint64_t newHead = 0;
+    char *slot = nullptr;
+    while ((slot = ring->reserve(recordSize, newHead)) == nullptr) {
+        if (m_policy == LogOverflowPolicy::DROP || !isAsync())
+            break;
+        wakeWriter();
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+
+    if (slot == nullptr) {
+        ring->dropped.fetch_add(1, std::memory_order_relaxed);
+        t_inWrite = false;
+        return;
+    }
+
+    RecordHeader header;
+    header.size = static_cast<uint32_t>(recordSize);
+    header.flags = 0;
+    header.seq = m_sequence.fetch_add(1, std::memory_order_relaxed);
+    header.fmt = fmt;
+    memcpy(slot, &header, sizeof(header));
+    encodeArgs(fmt, args, slot + HEADER_SIZE);
+
+    ring->head.store(newHead, std::memory_order_release);
+    wakeWriter();
+    t_inWrite = false;
+}
+
+bool Logger::drainRings(std::string &out)
+{
+    struct Cursor
+    {
+        LogRing *ring;
+        uint64_t pos;
+        uint64_t end;
+    };
+
+    std::lock_guard<std::mutex> lock(m_ringsMutex);
+    std::vector<Cursor> cursors;
+    cursors.reserve(m_rings.size());
+    for (LogRing *ring : m_rings)
+        cursors.push_back({ring, ring->tail.load(std::memory_order_relaxed), ring->head.load(std::memory_order_acquire)});
+
+    auto front = [](Cursor &c) -> const RecordHeader * {
+        while (c.pos < c.end) {
+            const char *p = c.ring->buffer + (c.pos & c.ring->mask);
+            uint32_t size, flags;
+            memcpy(&size, p, sizeof(size));
+            memcpy(&flags, p + sizeof(size), sizeof(flags));
+            if (!(flags & RECORD_WRAP))
+                return reinterpret_cast<const RecordHeader *>(p);
+            c.pos += size;
+        }
+        return nullptr;
+    };
+
+    bool any = false;
+    // Merge the per-thread streams back into global call order.
+    for (;;) {
+        Cursor *next = nullptr;
+        const RecordHeader *nextHeader = nullptr;
+        for (Cursor &c : cursors) {
+            const RecordHeader *h = front(c);
+            if (h && (nextHeader == nullptr || h->seq < nextHeader->seq)) {
+                next = &c;
+                nextHeader = h;
+            }
+        }
+        if (next == nullptr)
+            break;
+        formatRecord(nextHeader->fmt, reinterpret_cast<const char *>(nextHeader) + HEADER_SIZE, out);
+        next->pos += nextHeader->size;
+        any = true;
+    }
+
+    uint64_t dropped = 0;
+    for (Cursor &c : cursors) {
+        c.ring->tail.store(c.pos, std::memory_order_release);
+        dropped += c.ring->dropped.exchange(0, std::memory_order_relaxed);
+    }
+    if (dropped) {
+        m_dropped += dropped;
+        char buf[128];
+        snprintf(buf, sizeof(buf), "\033[33mWARN [Logger] %llu log messages dropped (ring buffer full)\033[0m\n",
+                 static_cast<unsigned long long>(dropped));
+        out.append(buf);
+    }
+
+    // Rings of exited threads go once they are empty.
+    for (auto it = m_rings.begin(); it != m_rings.end();) {
+        LogRing *ring = *it;
+        if (ring->retired.load(std::memory_order_acquire) &&
+            ring->tail.load(std::memory_order_relaxed) == ring->head.load(std::memory_order_acquire)) {
+            delete ring;
+            it = m_rings.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    return any;
+}
+
+void Logger::runWriterLoop()
+{
+    std::string out;
+    out.reserve(16 * 1024);
+
+    while (m_running.load(std::memory_order_acquire)) {
+        out.clear();
+        bool any = drainRings(out);
+        if (!out.empty()) {
+            fwrite(out.data(), 1, out.size(), stderr);
+            fflush(stderr);
+        }
+        if (!any) {
+            std::unique_lock<std::mutex> lock(m_wakeMutex);
+            m_writerSleeping.store(true, std::memory_order_release);
+            m_wakeCV.wait_for(lock, WRITER_IDLE_WAIT);
+            m_writerSleeping.store(false, std::memory_order_release);
+        }
+    }
+}
+
+uint64_t Logger::getDroppedCount()
+{
+    std::lock_guard<std::mutex> lock(m_ringsMutex);
+    uint64_t pending = 0;
+    for (LogRing *ring : m_rings)
+        pending += ring->dropped.load(std::memory_order_relaxed);
+    return m_dropped + pending;
+}
+
+void logPrintf(const char *fmt, ...)
+{
+    va_list args;
+    va_start(args, fmt);
+    Logger::getInstance()->vwrite(fmt, args);
+    va_end(args);
+}
+
+void setLogLevel(int module, LogLevel level)
+{
+    if (module >= 0 && module < LOG_MODULE_COUNT)
+        g_logLevels[module].store(level, std::memory_order_relaxed);
+}
+
+void setAllLogLevels(LogLevel level)
+{
+    for (int i = 0; i < LOG_MODULE_COUNT; i++)
+        setLogLevel(i, level);
+}
+
+namespace {
+
+bool tokenEquals(const char *begin, const char *end, const char *word)
+{
+    size_t len = end - begin;
+    return strlen(word) == len && strncasecmp(begin, word, len) == 0;
+}
+
+bool parseLevelToken(const char *begin, const char *end, LogLevel &level)
+{
+    if (tokenEquals(begin, end, "error"))
+        level = LOG_LEVEL_ERROR;
+    else if (tokenEquals(begin, end, "warn"))
+        level = LOG_LEVEL_WARN;
+    else if (tokenEquals(begin, end, "info"))
+        level = LOG_LEVEL_INFO;
+    else if (tokenEquals(begin, end, "trace"))
+        level = LOG_LEVEL_TRACE;
+    else
+        return false;
+    return true;
+}
+
+// -1 selects every module.
+bool parseModuleToken(const char *begin, const char *end, int &module)
+{
+    static const char *const names[LOG_MODULE_COUNT] = {"transport", "response", "protocol", "monitor"};
+    if (tokenEquals(begin, end, "all")) {
+        module = -1;
+        return true;
+    }
+    for (int i = 0; i < LOG_MODULE_COUNT; i++) {
+        if (tokenEquals(begin, end, names[i])) {
+            module = i;
+            return true;
+        }
+    }
+    return false;
+}
+
+} // namespace
+
+bool applyLogLevelSpec(const char *spec)
+{
+    bool ok = true;
+    const char *p = spec;
+    while (*p) {
+        while (*p == ' ' || *p == ',' || *p == '\n' || *p == '\r' || *p == '\t')
+            p++;
+        if (!*p)
+            break;
+        const char *entry = p;
+        while (*p && *p != ',' && *p != '\n' && *p != '\r' && *p != ' ' && *p != '\t')
+            p++;
+        const char *colon = static_cast<const char *>(memchr(entry, ':', p - entry));
+
+        int module = -1;
+        LogLevel level;
+        if (colon) {
+            if (!parseModuleToken(entry, colon, module) || !parseLevelToken(colon + 1, p, level)) {
+                ok = false;
+                continue;
+            }
+        } else if (!parseLevelToken(entry, p, level)) {
+            ok = false;
+            continue;
+        }
+        if (module < 0)
+            setAllLogLevels(level);
+        else
+            setLogLevel(module, level);
+    }
+    return ok;
+}
+
+bool reloadLogLevelsFromFile(const char *path)
+{
+    char buf[512];
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return false;
+    ssize_t n = read(fd, buf, sizeof(buf) - 1);
+    close(fd);
+    if (n <= 0)
+        return false;
+    buf[n] = '\0';
+    return applyLogLevelSpec(buf);
+}
+
+void setPayloadLogging(size_t maxBytes, unsigned everyNth)
+{
+    s_payloadMaxBytes.store(maxBytes, std::memory_order_relaxed);
+    s_payloadEveryNth.store(everyNth ? everyNth : 1, std::memory_order_relaxed);
+}
+
+int logPayloadShownBytes(int module, size_t payloadSize, std::atomic<unsigned> &callCount)
+{
+    size_t limit = Logger::MAX_STRING_BYTES;
+    if (!logLevelEnabled(module, LOG_LEVEL_TRACE)) {
+        unsigned every = s_payloadEveryNth.load(std::memory_order_relaxed);
+        if (every > 1 && (callCount.fetch_add(1, std::memory_order_relaxed) % every) != 0)
+            return -1;
+        limit = s_payloadMaxBytes.load(std::memory_order_relaxed);
+    }
+    return static_cast<int>(payloadSize < limit ? payloadSize : limit);
+}
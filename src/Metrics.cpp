@@ -0,0 +1,286 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2022 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <dirent.h>
+#include <functional>
+#include <malloc.h>
+#include <unistd.h>
+#include <vector>
+
+#include "Metrics.h"
+#include "EventUtils.h"
+
+MetricsRegistry *MetricsRegistry::mcp_INSTANCE{nullptr};
+
+constexpr int Histogram::BUCKETS;
+constexpr size_t MetricsRegistry::CAPACITY;
+
+Histogram::Histogram(const std::string &name, const std::string &labels) : Metric(name, labels, MetricType::HISTOGRAM)
+{
+    for (auto &b : m_buckets)
+        b.store(0, std::memory_order_relaxed);
+}
+
+uint64_t Histogram::quantile(double q) const
+{
+    uint64_t total = count();
+    if (total == 0)
+        return 0;
+    uint64_t target = static_cast<uint64_t>(q * total + 0.5);
+    if (target == 0)
+        target = 1;
+    uint64_t seen = 0;
+    for (int b = 0; b < BUCKETS; b++) {
+        seen += bucketCount(b);
+        if (seen >= target)
+            return bucketBound(b);
+    }
+    return bucketBound(BUCKETS - 1);
+}
+
+MetricsRegistry::MetricsRegistry()
+{
+    for (auto &slot : m_slots)
+        slot.store(nullptr, std::memory_order_relaxed);
+}
+
+MetricsRegistry *MetricsRegistry::getInstance()
+{
+    if (MetricsRegistry::mcp_INSTANCE == nullptr)
+    {
+        MetricsRegistry::mcp_INSTANCE = new MetricsRegistry();
+    }
+    return MetricsRegistry::mcp_INSTANCE;
+}
+
+Metric *MetricsRegistry::findOrCreate(const std::string &name, const std::string &labels, MetricType type)
+{
+    size_t hash = std::hash<std::string>()(name) ^ (std::hash<std::string>()(labels) * 31);
+    Metric *created = nullptr;
+
+    for (size_t i = 0; i < CAPACITY; i++) {
+        std::atomic<Metric *> &slot = m_slots[(hash + i) % CAPACITY];
+        Metric *existing = slot.load(std::memory_order_acquire);
+        if (existing == nullptr) {
+            if (created == nullptr) {
+                switch (type) {
+                case MetricType::COUNTER: created = new Counter(name, labels); break;
+                case MetricType::GAUGE: created = new Gauge(name, labels); break;
+                case MetricType::HISTOGRAM: created = new Histogram(name, labels); break;
+                }
+            }
+            if (slot.compare_exchange_strong(existing, created, std::memory_order_acq_rel))
+                return created;
+            // Lost the race for this slot; existing now holds the winner.
+        }
+        if (existing->getName() == name && existing->getLabels() == labels) {
+            delete created;
+            if (existing->getType() != type) {
+                LOGERR("Metric %s{%s} already registered with another type", name.c_str(), labels.c_str());
+                return nullptr;
+            }
+            return existing;
+        }
+    }
+    delete created;
+    LOGERR("Metrics registry full, %s{%s} not registered", name.c_str(), labels.c_str());
+    return nullptr;
+}
+
+Counter *MetricsRegistry::counter(const std::string &name, const std::string &labels)
+{
+    Metric *m = findOrCreate(name, labels, MetricType::COUNTER);
+    if (m == nullptr) {
+        static Counter unregistered("unregistered", "");
+        return &unregistered;
+    }
+    return static_cast<Counter *>(m);
+}
+
+Gauge *MetricsRegistry::gauge(const std::string &name, const std::string &labels)
+{
+    Metric *m = findOrCreate(name, labels, MetricType::GAUGE);
+    if (m == nullptr) {
+        static Gauge unregistered("unregistered", "");
+        return &unregistered;
+    }
+    return static_cast<Gauge *>(m);
+}
+
+Histogram *MetricsRegistry::histogram(const std::string &name, const std::string &labels)
+{
+    Metric *m = findOrCreate(name, labels, MetricType::HISTOGRAM);
+    if (m == nullptr) {
+        static Histogram unregistered("unregistered", "");
+        return &unregistered;
+    }
+    return static_cast<Histogram *>(m);
+}
+
+namespace {
+
+const char *typeName(MetricType type)
+{
+    switch (type) {
+    case MetricType::COUNTER: return "counter";
+    case MetricType::GAUGE: return "gauge";
+    case MetricType::HISTOGRAM: return "histogram";
+    }
+    return "untyped";
+}
+
+void appendSample(std::string &out, const std::string &name, const char *suffix,
+                  const std::string &labels, const std::string &extraLabel, const std::string &value)
+{
+    out += name;
+    out += suffix;
+    if (!labels.empty() || !extraLabel.empty()) {
+        out += '{';
+        out += labels;
+        if (!labels.empty() && !extraLabel.empty())
+            out += ',';
+        out += extraLabel;
+        out += '}';
+    }
+    out += ' ';
+    out += value;
+    out += '\n';
+}
+
+} // namespace
+
+std::string MetricsRegistry::renderPrometheus()
+{
+    updateProcessMetrics();
+
+    std::vector<Metric *> metrics;
+    for (auto &slot : m_slots) {
+        Metric *m = slot.load(std::memory_order_acquire);
+        if (m)
+            metrics.push_back(m);
+    }
+    std::sort(metrics.begin(), metrics.end(), [](const Metric *a, const Metric *b) {
+        return a->getName() != b->getName() ? a->getName() < b->getName() : a->getLabels() < b->getLabels();
+    });
+
+    std::string out;
+    out.reserve(metrics.size() * 128);
+    const std::string *lastName = nullptr;
+    for (Metric *m : metrics) {
+        if (lastName == nullptr || *lastName != m->getName()) {
+            out += "# TYPE " + m->getName() + " " + typeName(m->getType()) + "\n";
+            lastName = &m->getName();
+        }
+        switch (m->getType()) {
+        case MetricType::COUNTER:
+            appendSample(out, m->getName(), "", m->getLabels(), "", std::to_string(static_cast<Counter *>(m)->value()));
+            break;
+        case MetricType::GAUGE:
+            appendSample(out, m->getName(), "", m->getLabels(), "", std::to_string(static_cast<Gauge *>(m)->value()));
+            break;
+        case MetricType::HISTOGRAM: {
+            Histogram *h = static_cast<Histogram *>(m);
+            int last = Histogram::BUCKETS - 1;
+            while (last > 0 && h->bucketCount(last) == 0)
+                last--;
+            uint64_t cumulative = 0;
+            for (int b = 0; b <= last; b++) {
+                cumulative += h->bucketCount(b);
+                appendSample(out, m->getName(), "_bucket", m->getLabels(),
+                             "le=\"" + std::to_string(Histogram::bucketBound(b)) + "\"", std::to_string(cumulative));
+            }
+            // Buckets and count are updated independently; keep the exposition monotonic.
+            uint64_t total = std::max(cumulative, h->count());
+            appendSample(out, m->getName(), "_bucket", m->getLabels(), "le=\"+Inf\"", std::to_string(total));
+            appendSample(out, m->getName(), "_sum", m->getLabels(), "", std::to_string(h->sum()));
+            appendSample(out, m->getName(), "_count", m->getLabels(), "", std::to_string(total));
+            break;
+        }
+        }
+    }
+    return out;
+}
+
+std::string metricLabel(const char *key, const std::string &value)
+{
+    std::string out(key);
+    out += "=\"";
+    for (char c : value) {
+        if (c == '\\' || c == '"')
+            out += '\\';
+        if (c == '\n') {
+            out += "\\n";
+            continue;
+        }
+        out += c;
+    }
+    out += '"';
+    return out;
+}
+
+std::string joinLabels(const std::string &first, const std::string &second)
+{
+    if (first.empty())
+        return second;
+    if (second.empty())
+        return first;
+    return first + "," + second;
+}
+
+void updateProcessMetrics()
+{
+    static Gauge *resident = MetricsRegistry::getInstance()->gauge("process_resident_bytes");
+    static Gauge *heap = MetricsRegistry::getInstance()->gauge("process_heap_inuse_bytes");
+    static Gauge *fds = MetricsRegistry::getInstance()->gauge("process_open_fds");
+    static Gauge *threads = MetricsRegistry::getInstance()->gauge("process_threads");
+
+    FILE *status = fopen("/proc/self/status", "r");
+    if (status != nullptr) {
+        char line[128];
+        long value = 0;
+        while (fgets(line, sizeof(line), status) != nullptr) {
+            if (sscanf(line, "VmRSS: %ld kB", &value) == 1)
+                resident->set(static_cast<int64_t>(value) * 1024);
+            else if (sscanf(line, "Threads: %ld", &value) == 1)
+                threads->set(value);
+        }
+        fclose(status);
+    }
+
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+    heap->set(static_cast<int64_t>(mallinfo2().uordblks));
+#else
+    // mallinfo() wraps at 2 GiB, which is far above anything this process should reach.
+    heap->set(static_cast<int64_t>(static_cast<unsigned>(mallinfo().uordblks)));
+#endif
+
+    DIR *dir = opendir("/proc/self/fd");
+    if (dir != nullptr) {
+        int64_t count = 0;
+        while (struct dirent *entry = readdir(dir)) {
+            if (entry->d_name[0] != '.')
+                count++;
+        }
+        closedir(dir);
+        fds->set(count - 1); // minus the descriptor opendir() itself holds
+    }
+}
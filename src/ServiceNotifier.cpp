@@ -0,0 +1,125 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2022 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cstdarg>
+#include <cstdio>
+#include <systemd/sd-daemon.h>
+
+#include "ServiceNotifier.h"
+#include "EventUtils.h"
+
+ServiceNotifier *ServiceNotifier::mcp_INSTANCE{nullptr};
+
+ServiceNotifier::ServiceNotifier() : m_interval(0), m_running(false), mp_thread(nullptr)
+{
+}
+
+ServiceNotifier *ServiceNotifier::getInstance()
+{
+    if (ServiceNotifier::mcp_INSTANCE == nullptr)
+    {
+        ServiceNotifier::mcp_INSTANCE = new ServiceNotifier();
+    }
+    return ServiceNotifier::mcp_INSTANCE;
+}
+
+void ServiceNotifier::status(const char *format, ...)
+{
+    char text[256];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(text, sizeof(text), format, args);
+    va_end(args);
+    LOGTRACE("STATUS=%s", text);
+    sd_notifyf(0, "STATUS=%s", text);
+}
+
+void ServiceNotifier::ready(const std::string &status)
+{
+    LOGINFO("Ready: %s", status.c_str());
+    sd_notifyf(0, "READY=1\nSTATUS=%s", status.c_str());
+}
+
+void ServiceNotifier::stopping()
+{
+    sd_notify(0, "STOPPING=1\nSTATUS=Shutting down");
+}
+
+bool ServiceNotifier::startWatchdog(HealthCheck healthy, boost::asio::io_service *io)
+{
+    uint64_t usec = 0;
+    if (m_running.load() || sd_watchdog_enabled(0, &usec) <= 0)
+        return false;
+
+    m_healthy = healthy;
+    m_interval = std::chrono::microseconds(usec / 2);
+    m_running = true;
+    LOGINFO("Watchdog enabled, pinging every %lld ms", static_cast<long long>(m_interval.count() / 1000));
+    if (io != nullptr) {
+        mp_timer.reset(new boost::asio::steady_timer(*io));
+        armTimer();
+    } else {
+        mp_thread = new std::thread([this] { runLoop(); });
+    }
+    return true;
+}
+
+void ServiceNotifier::stopWatchdog()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        if (!m_running.exchange(false))
+            return;
+    }
+    m_cv.notify_all();
+    if (mp_timer)
+        mp_timer->cancel();
+    if (mp_thread != nullptr) {
+        mp_thread->join();
+        delete mp_thread;
+        mp_thread = nullptr;
+    }
+}
+
+void ServiceNotifier::runLoop()
+{
+    std::unique_lock<std::mutex> lock(m_lock);
+    while (!m_cv.wait_for(lock, m_interval, [this] { return !m_running.load(); }))
+        ping();
+    LOGTRACE("Exit");
+}
+
+void ServiceNotifier::armTimer()
+{
+    mp_timer->expires_after(m_interval);
+    mp_timer->async_wait([this](const boost::system::error_code &ec) {
+        if (ec || !m_running.load())
+            return;
+        ping();
+        armTimer();
+    });
+}
+
+void ServiceNotifier::ping()
+{
+    // A ping is skipped rather than sent late; systemd restarts us after WatchdogSec without one.
+    if (m_healthy && !m_healthy(m_interval))
+        return;
+    sd_notify(0, "WATCHDOG=1");
+}
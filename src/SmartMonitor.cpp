@@ -17,19 +17,25 @@
  * limitations under the License.
  */
 
+#define LOG_MODULE LOG_MODULE_MONITOR
+
 #include "SmartMonitor.h"
 #include "EventUtils.h"
+#include "Tracer.h"
+#include "Metrics.h"
 #include "thunder/ProtocolHandler.h"
-#include <csignal>
+#include "thunder/JsonDocument.h"
+#include "thunder/WebSocketTransport.h"
+#include "thunder/ResponseHandler.h"
 #include <set>
+#include <sstream>
+#include <algorithm>
 #include <thread>
 #include "json/json.h"
 
 using namespace std;
 using std::string;
 
-SmartMonitor *SmartMonitor::_instance = nullptr;
-
 inline const char* dialEventToString(DIALEVENTS event) {
     switch (event) {
         case APP_LAUNCH_REQUEST_EVENT: return "APP_LAUNCH_REQUEST_EVENT";
@@ -41,53 +47,122 @@ inline const char* dialEventToString(DIALEVENTS event) {
     }
 }
 
-void SmartMonitor::handleTermSignal(int _signal)
+static std::atomic<unsigned> s_dialDedupWindowMs{1000};
+static std::atomic<bool> s_pushDialState{true};
+
+void setDialStatePush(bool enable)
+{
+    s_pushDialState = enable;
+}
+
+void setDialDedupWindow(unsigned ms)
 {
-    (void)_signal;
+    s_dialDedupWindowMs = ms;
+}
 
-    LOGINFO("Exiting from app..");
+// Identifies a DIAL request by what it asks for, so a sender's retry maps to the same key.
+static std::string dialRequestKey(DIALEVENTS dialEvent, const DialParams &dialParams)
+{
+    size_t payloadHash = std::hash<std::string>()(dialParams.strPayLoad + '\n' + dialParams.strQuery + '\n' +
+                                                  dialParams.strAddDataUrl);
+    return std::to_string(dialEvent) + '\n' + dialParams.appName + '\n' + dialParams.appId + '\n' +
+           std::to_string(payloadHash);
+}
 
-    unique_lock<std::mutex> ulock(m_lock);
+void SmartMonitor::stop()
+{
+    beginStop();
+    finishStop(std::chrono::steady_clock::now() + std::chrono::milliseconds(SHUTDOWN_UNSUBSCRIBE_DEADLINE_IN_MS));
+}
+
+void SmartMonitor::beginStop()
+{
+    if (m_stopping.exchange(true))
+        return;
+    LOGINFO("Exiting from app%s%s..", m_device.empty() ? "" : " for ", m_device.c_str());
+    {
+        lock_guard<mutex> lkgd(m_lock);
+        m_act_cv.notify_all();
+    }
+    m_unsubscribeIds = tiface->unsubscribeAll();
+}
+
+void SmartMonitor::finishStop(std::chrono::steady_clock::time_point deadline)
+{
+    if (!m_unsubscribeIds.empty())
+    {
+        size_t acked = tiface->awaitReplies(m_unsubscribeIds, deadline);
+        LOGINFO("%zu of %zu unsubscribes acknowledged", acked, m_unsubscribeIds.size());
+        m_unsubscribeIds.clear();
+    }
+    lock_guard<mutex> lkgd(m_lock);
     m_isActive = false;
-    unRegisterForEvents();
-    m_act_cv.notify_one();
+    m_act_cv.notify_all();
 }
 
-void SmartMonitor::waitForTermSignal()
+void SmartMonitor::shutdown()
 {
-    LOGTRACE("Waiting for term signal.. ");
-    thread termThread([&, this]()
-                      {
-    while (m_isActive)
+    if (tiface != nullptr)
+        tiface->shutdown();
+}
+
+bool SmartMonitor::settle(int ms, const std::atomic<bool> *cancelled)
+{
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(ms);
+    auto cutShort = [this, cancelled] { return m_stopping || (cancelled != nullptr && *cancelled); };
+    if (mp_responses != nullptr)
     {
-        unique_lock<std::mutex> ulock(m_lock);
-        m_act_cv.wait(ulock);
+        // Single thread mode: sleeping here would stall every device, so keep the io running.
+        boost::asio::io_service &io = mp_pool->ioService();
+        while (!cutShort() && !io.stopped() && std::chrono::steady_clock::now() < deadline)
+            io.run_one_until(deadline);
+        return !m_stopping;
     }
+    unique_lock<mutex> ulock(m_lock);
+    m_act_cv.wait_until(ulock, deadline, cutShort);
+    return !m_stopping;
+}
 
-    LOGTRACE("[SmartMonitor::waitForTermSignal] Received term signal."); });
-    termThread.join();
+void SmartMonitor::waitForTermSignal()
+{
+    LOGTRACE("Waiting for term signal.. ");
+    unique_lock<std::mutex> ulock(m_lock);
+    m_act_cv.wait(ulock, [this] { return !m_isActive; });
+    LOGTRACE("[SmartMonitor::waitForTermSignal] Received term signal.");
 }
-SmartMonitor::SmartMonitor() : m_isActive(false), isConnected(false)
+SmartMonitor::SmartMonitor(const string &device, IoServicePool *pool)
+    : m_isActive(false), isConnected(false), m_stopping(false), m_device(device),
+      m_deviceLabel(device.empty() ? "" : metricLabel("device", device)), m_warmBudgetKb(0), mp_responses(nullptr),
+      mp_pool(pool)
 {
     LOGTRACE("Constructor.. ");
-    tiface = new ThunderInterface();
+    for (int i = YOUTUBE; i < APPLIMIT; i++)
+    {
+        m_warmApps[i] = false;
+        m_warmDue[i] = 0;
+        m_warmCancelled[i] = false;
+        m_poolHeld[i] = false;
+        m_warmed[i] = false;
+        m_warmFootprintKb[i] = 0;
+        m_pushFailed[i] = false;
+    }
+    if (pool != nullptr && pool->runsOnCaller())
+    {
+        mp_responses = new ResponseHandler(device);
+        mp_responses->initialize(pool->ioService());
+    }
+    tiface = new ThunderInterface(new WebSocketTransport(pool, device), mp_responses, device);
+    for (unsigned i = 0; i < requestConnections(); i++)
+        tiface->addRequestConnection(new WebSocketTransport(pool, device));
 }
 SmartMonitor::~SmartMonitor()
 {
     LOGTRACE("Destructor.. ");
 
-    tiface->shutdown();
+    shutdown();
     delete tiface;
     tiface = nullptr;
-}
-SmartMonitor *SmartMonitor::getInstance()
-{
-    LOGTRACE("Getting instance.. ");
-    if (nullptr == _instance)
-    {
-        _instance = new SmartMonitor();
-    }
-    return _instance;
+    delete mp_responses;
 }
 int SmartMonitor::initialize()
 {
@@ -99,8 +174,6 @@ int SmartMonitor::initialize()
         lock_guard<mutex> lkgd(m_lock);
         m_isActive = true;
     }
-    signal(SIGTERM, [](int x)
-           { SmartMonitor::getInstance()->handleTermSignal(x); });
     tiface->registerConnectStatusListener([&, this](bool connectionStatus)
                                           { isConnected = connectionStatus; });
     tiface->initialize();
@@ -113,6 +186,24 @@ int SmartMonitor::initialize()
     return status;
 }
 
+void SmartMonitor::setThunderConnectionURL(const string &wsurl)
+{
+    LOGTRACE("Thunder URL %s.. ", wsurl.c_str());
+    tiface->setThunderConnectionURL(wsurl);
+}
+
+bool SmartMonitor::startCapture(const string &path, size_t maxBytes)
+{
+    LOGTRACE("Capture to %s.. ", path.c_str());
+    return tiface->startCapture(path, maxBytes);
+}
+
+void SmartMonitor::stopCapture()
+{
+    LOGTRACE("Stopping capture.. ");
+    tiface->stopCapture();
+}
+
 void SmartMonitor::connectToThunder()
 {
     LOGTRACE("Connecting to thunder.. ");
@@ -132,16 +223,18 @@ void SmartMonitor::registerForEvents()
 
 void SmartMonitor::onControllerStateChangeEvent(const std::string &event, const std::string &params)
 {
-	LOGINFO("Received Controller State Change Event: %s with params: %s", event.c_str(), params.c_str());
+	LOGINFO("Received Controller State Change Event: %s", event.c_str());
+	LOGPAYLOAD("Controller State Change params: ", params);
 	// INFO [SmartMonitor.cpp:124] onControllerStateChangeEvent: Received Controller State Change Event: 1030.statechange with params: {"jsonrpc":"2.0","method":"1030.statechange","params":{"callsign":"Cobalt","reason":"Requested","state":"Activated"}}
 	std::string callsign, state;
 
-	Json::Value jParams;
-	if (!getParamObjectFromJsonString(params, jParams)) {
+	JsonDocument doc;
+	JsonValue jParams;
+	if (!getParamObjectFromJsonString(params, doc, jParams)) {
 		return;
 	}
 
-	callsign = jParams.get("callsign", "").asString();
+	callsign = jParams["callsign"].asString();
 	if (callsign.empty()) {
 		LOGERR("Failed to extract callsign from nested params: %s", params.c_str());
 		return;
@@ -149,7 +242,7 @@ void SmartMonitor::onControllerStateChangeEvent(const std::string &event, const
 		LOGTRACE("Extracted callsign: %s", callsign.c_str());
 	}
 
-	state = jParams.get("state", "").asString();
+	state = jParams["state"].asString();
 	if (state.empty()) {
 		LOGERR("Failed to extract state from nested params: %s", params.c_str());
 		return;
@@ -162,6 +255,12 @@ void SmartMonitor::onControllerStateChangeEvent(const std::string &event, const
 		callsign = "YouTube";
 	}
 
+	// Thunder says why a plugin went down: Requested for a stop, Crash, MemoryExceeded or
+	// WatchdogExpired when it was not asked to.
+	std::string reason = jParams["reason"].asString();
+	std::transform(reason.begin(), reason.end(), reason.begin(), ::tolower);
+	bool crashed = reason == "crash" || reason == "memoryexceeded" || reason == "watchdogexpired";
+
 	std::string dialState = "unknown";
 	std::transform(state.begin(), state.end(), state.begin(), ::tolower);
 	if (convertPluginStateToDIALState(state, dialState)) {
@@ -172,6 +271,7 @@ void SmartMonitor::onControllerStateChangeEvent(const std::string &event, const
 				m_dialApps[i].dialState = dialState;
 				LOGINFO("Update App State Cache %s: pluginState=%s, dialState=%s",
 					m_dialApps[i].appName.c_str(), m_dialApps[i].pluginState.c_str(), m_dialApps[i].dialState.c_str());
+				onAppStateChanged(i, crashed);
 				break;
 			}
 		}
@@ -182,7 +282,8 @@ void SmartMonitor::onControllerStateChangeEvent(const std::string &event, const
 
 void SmartMonitor::onRDKShellEvent(const std::string &event, const std::string &params)
 {
-	LOGINFO("Received RDKShell Event: %s with params: %s", event.c_str(), params.c_str());
+	LOGINFO("Received RDKShell Event: %s", event.c_str());
+	LOGPAYLOAD("RDKShell Event params: ", params);
 	// INFO [SmartMonitor.cpp:174] onRDKShellEvent: Received RDKShell Event: 1024.onLaunched with params: {"jsonrpc":"2.0","method":"1024.onLaunched","params":{"client":"Cobalt","launchType":"activate"}}
 	std::string actualEvent = event;
 	size_t dotPos = event.find('.');
@@ -206,13 +307,14 @@ void SmartMonitor::onRDKShellEvent(const std::string &event, const std::string &
 	if (validEvents.find(actualEvent) != validEvents.end()) {
 		LOGINFO("Event %s is a valid RDKShell event.", actualEvent.c_str());
 
-		Json::Value jParams;
-		if (!getParamObjectFromJsonString(params, jParams)) {
+		JsonDocument doc;
+		JsonValue jParams;
+		if (!getParamObjectFromJsonString(params, doc, jParams)) {
 			return;
 		}
 
-		std::string client = jParams.get("client", "").asString();
-		std::string launchType = jParams.get("launchType", "").asString();
+		std::string client = jParams["client"].asString();
+		std::string launchType = jParams["launchType"].asString();
 
 		if (client.empty()) {
 			LOGERR("Failed to extract client from nested params: %s", params.c_str());
@@ -250,6 +352,7 @@ void SmartMonitor::onRDKShellEvent(const std::string &event, const std::string &
 					m_dialApps[i].dialState = dialState;
 					LOGINFO("Update App State Cache %s: pluginState=%s, dialState=%s",
 						m_dialApps[i].appName.c_str(), m_dialApps[i].pluginState.c_str(), m_dialApps[i].dialState.c_str());
+					onAppStateChanged(i);
 				}
 				break;
 			}
@@ -285,39 +388,388 @@ void SmartMonitor::onDialEvent(DIALEVENTS dialEvent, const DialParams &dialParam
 	LOGINFO("Received Dial Event: %s (%d) for app: %s with id: %s",
 			dialEventToString(dialEvent), dialEvent,
 			dialParams.appName.c_str(), dialParams.appId.c_str());
+	ScopedSpan span("onDialEvent", std::string(dialEventToString(dialEvent)) + " " + dialParams.appName);
 
-	std::string state = "unknown", dialState = "unknown";
-	if (!getPluginState(dialParams.appName, state)) {
-		LOGERR("Failed to get plugin state for app %s", dialParams.appName.c_str());
+	int app = findApp(dialParams.appName);
+	if (app != APPLIMIT && !dialParams.appId.empty())
+		m_dialAppIds[app] = dialParams.appId;
+
+	unsigned window = s_dialDedupWindowMs.load(std::memory_order_relaxed);
+	if (window == 0) {
+		handleDialEvent(dialEvent, dialParams);
+		return;
+	}
+
+	auto now = std::chrono::steady_clock::now();
+	for (auto it = m_recentDialRequests.begin(); it != m_recentDialRequests.end();) {
+		if (now - it->second.handled >= std::chrono::milliseconds(window))
+			it = m_recentDialRequests.erase(it);
+		else
+			++it;
+	}
+	// State requests do not change the app, so they only repeat each other. Launch, hide, stop
+	// and resume share one slot: LAUNCH, STOP, LAUNCH is a relaunch, not a repeat.
+	const std::string slot = dialParams.appName + (APP_STATE_REQUEST_EVENT == dialEvent ? "\nstate" : "\naction");
+	const std::string key = dialRequestKey(dialEvent, dialParams);
+	auto recent = m_recentDialRequests.find(slot);
+	if (recent != m_recentDialRequests.end() && recent->second.key == key) {
+		// A state request is answered again only when the state changed since the last answer.
+		bool answered = APP_STATE_REQUEST_EVENT != dialEvent ||
+			(app != APPLIMIT && m_dialApps[app].pluginState != "unknown" &&
+			 reportedDialState(app) == m_dialApps[app].dialState);
+		if (answered) {
+			LOGINFO("Repeated %s for app %s within %u ms, already handled",
+					dialEventToString(dialEvent), dialParams.appName.c_str(), window);
+			MetricsRegistry::getInstance()->counter("dial_requests_deduplicated_total",
+				joinLabels(m_deviceLabel, metricLabel("event", dialEventToString(dialEvent))))->inc();
+			return;
+		}
+	}
+	// Any other request for the app ends the one before, whether it succeeds or not.
+	if (recent != m_recentDialRequests.end())
+		m_recentDialRequests.erase(recent);
+	// Timed from the end, so a repeat queued while a launch was running joins that launch. A
+	// request that failed is not remembered; the sender's retry gets another go.
+	if (handleDialEvent(dialEvent, dialParams))
+		m_recentDialRequests[slot] = {key, std::chrono::steady_clock::now()};
+}
+
+void SmartMonitor::onAppStateChanged(int app, bool crashed)
+{
+	bool stopped = m_dialApps[app].dialState == "stopped";
+	// Once it exits the pool no longer holds it, whatever Xcast was last told.
+	if (stopped)
+		m_poolHeld[app] = false;
+	pushDialState(app);
+	// A sender or the user stopping the app is not undone. After a crash it is warmed again,
+	// but not at once, so an app that keeps crashing is not relaunched in a loop.
+	if (m_warmApps[app] && stopped && crashed) {
+		LOGINFO("App %s crashed, warming it again in %d ms", m_dialApps[app].appName.c_str(),
+				WARM_RETRY_INTERVAL_IN_MS);
+		scheduleWarmUp(app, WARM_RETRY_INTERVAL_IN_MS);
+	}
+}
+
+void SmartMonitor::scheduleWarmUp(int app, int delayMs)
+{
+	m_warmDue[app] = (std::chrono::steady_clock::now() + std::chrono::milliseconds(delayMs)).time_since_epoch().count();
+}
+
+const string &SmartMonitor::reportedDialState(int app)
+{
+	if (m_pushFailed[app].exchange(false))
+		m_reportedDialState[app].clear();
+	return m_reportedDialState[app];
+}
+
+void SmartMonitor::pushDialState(int app)
+{
+	const std::string &dialState = m_dialApps[app].dialState;
+	// Xcast files the state under the application id, which only a DIAL request tells us.
+	// The pool launching and suspending an app is of no concern to a sender.
+	if (!s_pushDialState.load(std::memory_order_relaxed) || dialState == "unknown" ||
+		m_dialAppIds[app].empty() || m_poolHeld[app] || dialState == reportedDialState(app))
+		return;
+	ScopedSpan span("pushDialState", m_dialApps[app].appName);
+	// Sent without waiting for the reply, so queued DIAL requests do not wait behind it. A push
+	// Xcast does not take is forgotten again, so the next state event or request reports it.
+	const std::string appName = m_dialApps[app].appName;
+	if (tiface->pushDIALAppState(appName, m_dialAppIds[app], dialState, [this, app, appName](bool taken) {
+			if (taken)
+				return;
+			LOGWARN("Xcast did not take the pushed DIAL state of app %s", appName.c_str());
+			m_pushFailed[app] = true;
+		})) {
+		LOGINFO("Pushed DIAL state %s of app %s to Xcast", dialState.c_str(), appName.c_str());
+		m_reportedDialState[app] = dialState;
+		MetricsRegistry::getInstance()->counter("dial_state_pushes_total", m_deviceLabel)->inc();
+	}
+}
+
+void SmartMonitor::setWarmPool(const string &appCallsigns, unsigned budgetMb)
+{
+	m_warmBudgetKb = static_cast<int64_t>(budgetMb) * 1024;
+	std::stringstream apps(appCallsigns);
+	std::string appName;
+	while (std::getline(apps, appName, ',')) {
+		int app = findApp(appName);
+		if (app == APPLIMIT) {
+			LOGWARN("Unknown app %s in the warm pool, ignored", appName.c_str());
+			continue;
+		}
+		m_warmApps[app] = true;
+		scheduleWarmUp(app, 0);
+	}
+}
+
+void SmartMonitor::maintainWarmPool()
+{
+	if (m_stopping || !isConnected)
+		return;
+	int64_t now = std::chrono::steady_clock::now().time_since_epoch().count();
+	for (int i = YOUTUBE; i < APPLIMIT; i++) {
+		int64_t due = m_warmDue[i];
+		if (!m_warmApps[i] || due == 0 || now < due)
+			continue;
+		m_warmDue[i] = 0;
+		// The state cache belongs to the event thread; ask Thunder instead.
+		std::string state, dialState;
+		if (!tiface->getPluginState(m_dialApps[i].appName, state)) {
+			scheduleWarmUp(i, WARM_RETRY_INTERVAL_IN_MS);
+			continue;
+		}
+		std::transform(state.begin(), state.end(), state.begin(), ::tolower);
+		if (!convertPluginStateToDIALState(state, dialState) || dialState != "stopped")
+			continue;
+		// It exited, so whatever the pool had warmed is gone.
+		m_warmed[i] = false;
+		warmApp(i);
+	}
+}
+
+void SmartMonitor::warmApp(int app)
+{
+	{
+		// A request for the app being handled or waiting means the sender is taking it over.
+		std::lock_guard<std::mutex> lock(m_deferLock);
+		if (!m_deferredDialRequests[app].empty() || !m_warmLock[app].try_lock())
+			return;
+		m_warmCancelled[app] = false;
+	}
+	warmUp(app);
+	bool deferred;
+	{
+		std::lock_guard<std::mutex> lock(m_deferLock);
+		m_warmLock[app].unlock();
+		deferred = !m_deferredDialRequests[app].empty();
+	}
+	if (deferred)
+		tiface->postToDispatch([this, app] { runDeferredDialRequests(app); });
+}
+
+void SmartMonitor::runDeferredDialRequests(int app)
+{
+	std::vector<std::pair<DIALEVENTS, DialParams>> requests;
+	{
+		std::lock_guard<std::mutex> lock(m_deferLock);
+		requests.swap(m_deferredDialRequests[app]);
+	}
+	for (const auto &request : requests) {
+		if (m_stopping)
+			return;
+		onDialEvent(request.first, request.second);
+	}
+}
+
+void SmartMonitor::warmUp(int app)
+{
+	const std::string &appName = m_dialApps[app].appName;
+	auto retryLater = [this, app] { scheduleWarmUp(app, WARM_RETRY_INTERVAL_IN_MS); };
+	auto cancelled = [this, app, &appName] {
+		if (!m_warmCancelled[app])
+			return false;
+		LOGINFO("Warm-up of %s cancelled by a DIAL request", appName.c_str());
+		return true;
+	};
+
+	int64_t freeBefore = 0;
+	if (m_warmBudgetKb != 0) {
+		if (warmPoolKb() + m_warmFootprintKb[app] > m_warmBudgetKb) {
+			LOGINFO("Not warming %s: the warm pool holds %lld of its %lld KB", appName.c_str(),
+					static_cast<long long>(warmPoolKb()), static_cast<long long>(m_warmBudgetKb));
+			retryLater();
+			return;
+		}
+		if (!tiface->getSystemFreeMemory(freeBefore)) {
+			LOGWARN("Not warming %s: free memory unknown", appName.c_str());
+			retryLater();
+			return;
+		}
+	}
+
+	if (cancelled())
+		return;
+	ScopedSpan span("warmApp", appName);
+	auto start = std::chrono::steady_clock::now();
+	m_poolHeld[app] = true;
+	if (!tiface->launchPremiumApp(appName)) {
+		LOGERR("Failed to launch app %s for the warm pool", appName.c_str());
+		m_poolHeld[app] = false;
+		retryLater();
+		return;
+	}
+	m_warmed[app] = true;
+	// Let it come up, as a cast does, before sending it to the background. A request that
+	// came in meanwhile gets the app as it is; the pool no longer counts it as its own.
+	if (!settle(WARM_SETTLE_IN_MS, &m_warmCancelled[app]))
+		return;
+	if (cancelled()) {
+		m_warmed[app] = false;
 		return;
 	}
+	if (!tiface->suspendPremiumApp(appName)) {
+		// Not left running in the foreground with nobody casting to it.
+		LOGERR("Failed to suspend app %s for the warm pool; stopping it", appName.c_str());
+		tiface->shutdownPremiumApp(appName);
+		m_warmed[app] = false;
+		m_poolHeld[app] = false;
+		retryLater();
+		return;
+	}
+
+	if (m_warmBudgetKb != 0) {
+		int64_t freeAfter = 0;
+		if (tiface->getSystemFreeMemory(freeAfter))
+			m_warmFootprintKb[app] = std::max<int64_t>(freeBefore - freeAfter, 0);
+		if (warmPoolKb() > m_warmBudgetKb) {
+			LOGWARN("Warming %s took %lld KB, over the warm pool budget of %lld KB; stopping it", appName.c_str(),
+					static_cast<long long>(m_warmFootprintKb[app]), static_cast<long long>(m_warmBudgetKb));
+			tiface->shutdownPremiumApp(appName);
+			m_warmed[app] = false;
+			m_poolHeld[app] = false;
+			retryLater();
+			return;
+		}
+	}
+	MetricsRegistry *metrics = MetricsRegistry::getInstance();
+	metrics->counter("warm_pool_warmups_total", joinLabels(m_deviceLabel, metricLabel("app", appName)))->inc();
+	metrics->gauge("warm_pool_kb", m_deviceLabel)->set(warmPoolKb());
+	LOGINFO("Warmed %s in %lld ms, footprint %lld KB", appName.c_str(),
+			static_cast<long long>(std::chrono::duration_cast<std::chrono::milliseconds>(
+				std::chrono::steady_clock::now() - start).count()),
+			static_cast<long long>(m_warmFootprintKb[app]));
+}
+
+int64_t SmartMonitor::warmPoolKb() const
+{
+	int64_t total = 0;
+	for (int i = YOUTUBE; i < APPLIMIT; i++) {
+		if (m_warmed[i])
+			total += m_warmFootprintKb[i];
+	}
+	return total;
+}
+
+int SmartMonitor::findApp(const string &appName) const
+{
+	for (int i = YOUTUBE; i < APPLIMIT; i++) {
+		if (m_dialApps[i].appName == appName)
+			return i;
+	}
+	return APPLIMIT;
+}
+
+void SmartMonitor::shed(DIALEVENTS dialEvent, const DialParams &dialParams)
+{
+	LOGWARN("Overloaded, dropping %s for app %s", dialEventToString(dialEvent), dialParams.appName.c_str());
+	MetricsRegistry::getInstance()->counter("dial_requests_shed_total",
+		joinLabels(m_deviceLabel, metricLabel("event", dialEventToString(dialEvent))))->inc();
+}
+
+bool SmartMonitor::shedIfRejected(DIALEVENTS dialEvent, const DialParams &dialParams)
+{
+	if (tiface->lastRequestResult() != RequestResult::OVERLOADED)
+		return false;
+	shed(dialEvent, dialParams);
+	return true;
+}
+
+bool SmartMonitor::handleDialEvent(DIALEVENTS dialEvent, const DialParams &dialParams)
+{
+	auto handlerStart = std::chrono::steady_clock::now();
+	// A state request only refreshes what the receiver reports and the sender asks again;
+	// while Thunder or dispatch is not keeping up it is dropped so launch, hide and stop go first.
+	if (APP_STATE_REQUEST_EVENT == dialEvent && tiface->isOverloaded()) {
+		shed(dialEvent, dialParams);
+		return false;
+	}
+
+	// A request acts on the app while no warm-up of it runs, and from then on the sender owns
+	// the app again. One that comes in during a warm-up cancels it and is handled once the
+	// warm-up has stopped, so dispatch does not wait meanwhile.
+	int app = findApp(dialParams.appName);
+	std::unique_lock<std::mutex> warmLock;
+	bool poolLaunched = false;
+	if (APP_STATE_REQUEST_EVENT != dialEvent && app != APPLIMIT) {
+		{
+			std::lock_guard<std::mutex> lock(m_deferLock);
+			// Behind the requests already waiting, to keep them in order.
+			if (m_deferredDialRequests[app].empty())
+				warmLock = std::unique_lock<std::mutex>(m_warmLock[app], std::try_to_lock);
+			if (!warmLock.owns_lock()) {
+				m_warmCancelled[app] = true;
+				m_deferredDialRequests[app].emplace_back(dialEvent, dialParams);
+			}
+		}
+		if (!warmLock.owns_lock()) {
+			// Taking m_lock orders this after the check of a settle about to wait.
+			{ std::lock_guard<std::mutex> lock(m_lock); }
+			m_act_cv.notify_all();
+			LOGINFO("%s for app %s waits for its warm-up to stop", dialEventToString(dialEvent),
+					dialParams.appName.c_str());
+			return false;
+		}
+		poolLaunched = m_poolHeld[app].exchange(false);
+	}
+
+	std::string state = "unknown", dialState = "unknown";
+	bool gotState;
+	{
+		ScopedSpan stateSpan("getPluginState", dialParams.appName);
+		gotState = getPluginState(dialParams.appName, state);
+	}
+	if (!gotState) {
+		if (!shedIfRejected(dialEvent, dialParams))
+			LOGERR("Failed to get plugin state for app %s", dialParams.appName.c_str());
+		return false;
+	}
 	if (!convertPluginStateToDIALState(state, dialState)) {
 		LOGERR("Failed to convert plugin state %s to DIAL state, set as UNKNOWN", state.c_str());
 		dialState = "unknown";
 	}
 
 	if (APP_STATE_REQUEST_EVENT == dialEvent) {
-		tiface->reportDIALAppState(dialParams.appName, dialParams.appId, dialState);
+		if (!tiface->reportDIALAppState(dialParams.appName, dialParams.appId, dialState)) {
+			shedIfRejected(dialEvent, dialParams);
+			return false;
+		}
+		if (app != APPLIMIT) {
+			m_pushFailed[app] = false;
+			m_reportedDialState[app] = dialState;
+		}
 	} else if (APP_LAUNCH_REQUEST_EVENT == dialEvent) {
+		// Launching a suspended app resumes it, which is what the warm pool is for; only the
+		// apps the pool suspended count as warm.
+		bool suspended = dialState == "suspended" || dialState == "hidden";
+		const char *start = dialState == "running" ? "running"
+			: suspended ? (poolLaunched ? "warm" : "resumed") : "cold";
 		if (dialState != "running") {
 			if (!tiface->launchPremiumApp(dialParams.appName)) {
-				LOGERR("Failed to launch app %s", dialParams.appName.c_str());
-				return;
+				if (!shedIfRejected(dialEvent, dialParams))
+					LOGERR("Failed to launch app %s", dialParams.appName.c_str());
+				return false;
 			}
-			std::this_thread::sleep_for(std::chrono::milliseconds(500));
+			ScopedSpan sleepSpan("settle_sleep");
+			if (!settle(500))
+				return false;
 		} else {
 			LOGINFO("App %s is already running, sending deep link request directly.", dialParams.appName.c_str());
 		}
 		if (!tiface->sendDeepLinkRequest(dialParams)) {
-			LOGERR("Failed to send deep link request for app %s", dialParams.appName.c_str());
-			return;
+			if (!shedIfRejected(dialEvent, dialParams))
+				LOGERR("Failed to send deep link request for app %s", dialParams.appName.c_str());
+			return false;
 		}
-		std::this_thread::sleep_for(std::chrono::milliseconds(500));
+		MetricsRegistry::getInstance()->histogram("dial_launch_us",
+			joinLabels(m_deviceLabel, metricLabel("start", start)))->observeSince(handlerStart);
+		ScopedSpan sleepSpan("settle_sleep");
+		settle(500);
 	} else if (APP_HIDE_REQUEST_EVENT == dialEvent) {
 		if (dialState != "suspended") {
 			if (!tiface->suspendPremiumApp(dialParams.appName)) {
-				LOGERR("Failed to suspend app %s", dialParams.appName.c_str());
-				return;
+				if (!shedIfRejected(dialEvent, dialParams))
+					LOGERR("Failed to suspend app %s", dialParams.appName.c_str());
+				return false;
 			}
 		} else {
 			LOGINFO("App %s is already suspended.", dialParams.appName.c_str());
@@ -325,8 +777,9 @@ void SmartMonitor::onDialEvent(DIALEVENTS dialEvent, const DialParams &dialParam
 	} else if (APP_STOP_REQUEST_EVENT == dialEvent) {
 		if (dialState != "stopped") {
 			if (!tiface->shutdownPremiumApp(dialParams.appName)) {
-				LOGERR("Failed to stop app %s", dialParams.appName.c_str());
-				return;
+				if (!shedIfRejected(dialEvent, dialParams))
+					LOGERR("Failed to stop app %s", dialParams.appName.c_str());
+				return false;
 			}
 		} else {
 			LOGINFO("App %s is already stopped.", dialParams.appName.c_str());
@@ -334,14 +787,18 @@ void SmartMonitor::onDialEvent(DIALEVENTS dialEvent, const DialParams &dialParam
 	} else if (APP_RESUME_REQUEST_EVENT == dialEvent) {
 		if (dialState != "running") {
 			if (!tiface->launchPremiumApp(dialParams.appName)) {
-				LOGERR("Failed to launch app %s", dialParams.appName.c_str());
-				return;
+				if (!shedIfRejected(dialEvent, dialParams))
+					LOGERR("Failed to launch app %s", dialParams.appName.c_str());
+				return false;
 			}
-			std::this_thread::sleep_for(std::chrono::milliseconds(500));
+			ScopedSpan sleepSpan("settle_sleep");
+			settle(500);
 		}
 	} else {
 		LOGERR("Unknown event %s (%d)", dialEventToString(dialEvent), dialEvent);
+		return false;
 	}
+	return true;
 }
 
 bool SmartMonitor::getPluginState(const string &myapp, string &state)
@@ -0,0 +1,334 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2022 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <poll.h>
+#include <sstream>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <boost/asio/steady_timer.hpp>
+#include <boost/asio/write.hpp>
+
+#include "StatsServer.h"
+#include "Metrics.h"
+#include "EventUtils.h"
+
+StatsServer *StatsServer::mcp_INSTANCE{nullptr};
+
+static constexpr int CLIENT_READ_TIMEOUT_MS = 200;
+// A client that does not take its reply within this long is dropped.
+static constexpr int CLIENT_WRITE_TIMEOUT_MS = 2000;
+static constexpr size_t MAX_REQUEST_BYTES = 4096;
+
+struct StatsServer::AsyncClient
+{
+    boost::asio::posix::stream_descriptor socket;  // owns the fd
+    boost::asio::steady_timer deadline;
+    std::string request;
+    std::string response;
+    char buf[256];
+
+    AsyncClient(boost::asio::io_service &io, int fd) : socket(io, fd), deadline(io) {}
+
+    // Cancels the pending read or write once timeoutMs passes; rearming replaces the deadline.
+    static void armDeadline(const std::shared_ptr<AsyncClient> &client, int timeoutMs)
+    {
+        client->deadline.expires_from_now(std::chrono::milliseconds(timeoutMs));
+        client->deadline.async_wait([client](const boost::system::error_code &ec) {
+            boost::system::error_code ignored;
+            if (!ec)
+                client->socket.cancel(ignored);
+        });
+    }
+};
+
+StatsServer::StatsServer() : m_listenFd(-1), m_running(false), mp_thread(nullptr), mp_io(nullptr)
+{
+    m_wakePipe[0] = m_wakePipe[1] = -1;
+}
+
+StatsServer *StatsServer::getInstance()
+{
+    if (StatsServer::mcp_INSTANCE == nullptr)
+    {
+        StatsServer::mcp_INSTANCE = new StatsServer();
+    }
+    return StatsServer::mcp_INSTANCE;
+}
+
+bool StatsServer::start(const std::string &socketPath, boost::asio::io_service *io)
+{
+    if (m_running.load())
+        return true;
+
+    if (pipe2(m_wakePipe, O_CLOEXEC | O_NONBLOCK) != 0) {
+        LOGERR("Failed to create wake pipe: %s", strerror(errno));
+        return false;
+    }
+
+    m_socketPath = socketPath;
+    if (!m_socketPath.empty()) {
+        struct sockaddr_un addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        if (m_socketPath.size() >= sizeof(addr.sun_path)) {
+            LOGERR("Stats socket path too long: %s", m_socketPath.c_str());
+            return false;
+        }
+        strncpy(addr.sun_path, m_socketPath.c_str(), sizeof(addr.sun_path) - 1);
+
+        m_listenFd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        unlink(m_socketPath.c_str());
+        if (m_listenFd < 0 || bind(m_listenFd, reinterpret_cast<struct sockaddr *>(&addr), sizeof(addr)) != 0 ||
+            listen(m_listenFd, 4) != 0) {
+            LOGERR("Failed to open stats socket %s: %s", m_socketPath.c_str(), strerror(errno));
+            if (m_listenFd >= 0)
+                close(m_listenFd);
+            m_listenFd = -1;
+        } else {
+            LOGINFO("Stats available on unix socket %s", m_socketPath.c_str());
+        }
+    }
+
+    m_running = true;
+    if (io != nullptr) {
+        mp_io = io;
+        // The descriptors are only borrowed; stop() releases them before closing the fds itself.
+        mp_wakeDescriptor.reset(new boost::asio::posix::stream_descriptor(*io, m_wakePipe[0]));
+        armWake();
+        if (m_listenFd >= 0) {
+            mp_listenDescriptor.reset(new boost::asio::posix::stream_descriptor(*io, m_listenFd));
+            armAccept();
+        }
+    } else {
+        mp_thread = new std::thread([this] { runLoop(); });
+    }
+    return true;
+}
+
+void StatsServer::armWake()
+{
+    mp_wakeDescriptor->async_wait(boost::asio::posix::stream_descriptor::wait_read,
+                                  [this](const boost::system::error_code &ec) {
+                                      if (ec || !m_running.load())
+                                          return;
+                                      handleWake();
+                                      armWake();
+                                  });
+}
+
+void StatsServer::armAccept()
+{
+    mp_listenDescriptor->async_wait(boost::asio::posix::stream_descriptor::wait_read,
+                                    [this](const boost::system::error_code &ec) {
+                                        if (ec || !m_running.load())
+                                            return;
+                                        handleAccept();
+                                        armAccept();
+                                    });
+}
+
+void StatsServer::stop()
+{
+    if (!m_running.exchange(false))
+        return;
+    requestDump();
+    if (mp_thread && mp_thread->joinable()) {
+        mp_thread->join();
+        delete mp_thread;
+        mp_thread = nullptr;
+    }
+    for (auto *descriptor : {&mp_wakeDescriptor, &mp_listenDescriptor}) {
+        if (*descriptor) {
+            boost::system::error_code ec;
+            (*descriptor)->cancel(ec);
+            (*descriptor)->release();
+            descriptor->reset();
+        }
+    }
+    if (m_listenFd >= 0) {
+        close(m_listenFd);
+        unlink(m_socketPath.c_str());
+        m_listenFd = -1;
+    }
+    close(m_wakePipe[0]);
+    close(m_wakePipe[1]);
+    m_wakePipe[0] = m_wakePipe[1] = -1;
+}
+
+void StatsServer::registerCommand(const std::string &name, CommandHandler handler)
+{
+    std::lock_guard<std::mutex> lock(m_commandMutex);
+    m_commands[name] = handler;
+}
+
+void StatsServer::requestDump()
+{
+    if (m_wakePipe[1] >= 0) {
+        char c = 'd';
+        ssize_t ret = write(m_wakePipe[1], &c, 1);
+        (void)ret;
+    }
+}
+
+void StatsServer::runLoop()
+{
+    while (m_running.load()) {
+        struct pollfd fds[2];
+        fds[0] = {m_wakePipe[0], POLLIN, 0};
+        fds[1] = {m_listenFd, POLLIN, 0};
+        int nfds = (m_listenFd >= 0) ? 2 : 1;
+
+        if (poll(fds, nfds, -1) < 0) {
+            if (errno == EINTR)
+                continue;
+            LOGERR("poll failed: %s", strerror(errno));
+            break;
+        }
+
+        if (fds[0].revents & POLLIN)
+            handleWake();
+        if (nfds > 1 && (fds[1].revents & POLLIN))
+            handleAccept();
+    }
+    LOGTRACE("Exit");
+}
+
+void StatsServer::handleWake()
+{
+    char buf[16];
+    bool dump = false;
+    while (read(m_wakePipe[0], buf, sizeof(buf)) > 0)
+        dump = true;
+    if (dump && m_running.load())
+        logMetricsDump();
+}
+
+void StatsServer::handleAccept()
+{
+    if (mp_listenDescriptor) {
+        int client = accept4(m_listenFd, nullptr, nullptr, SOCK_CLOEXEC | SOCK_NONBLOCK);
+        if (client >= 0)
+            serveClientAsync(client);
+        return;
+    }
+    int client = accept4(m_listenFd, nullptr, nullptr, SOCK_CLOEXEC);
+    if (client >= 0) {
+        serveClient(client);
+        close(client);
+    }
+}
+
+void StatsServer::serveClient(int fd)
+{
+    std::string request;
+    char buf[256];
+    struct pollfd pfd = {fd, POLLIN, 0};
+    // A client that only connects (e.g. a scraper) gets the default command.
+    while (request.find('\n') == std::string::npos && poll(&pfd, 1, CLIENT_READ_TIMEOUT_MS) > 0) {
+        ssize_t n = read(fd, buf, sizeof(buf));
+        if (n <= 0)
+            break;
+        request.append(buf, n);
+        if (request.size() > MAX_REQUEST_BYTES)
+            break;
+    }
+
+    std::string response = runCommand(request);
+    size_t off = 0;
+    while (off < response.size()) {
+        ssize_t n = send(fd, response.data() + off, response.size() - off, MSG_NOSIGNAL);
+        if (n <= 0)
+            break;
+        off += n;
+    }
+}
+
+void StatsServer::serveClientAsync(int fd)
+{
+    readRequest(std::make_shared<AsyncClient>(*mp_io, fd));
+}
+
+void StatsServer::readRequest(const std::shared_ptr<AsyncClient> &client)
+{
+    // As in serveClient(), a client that goes quiet gets the command it has sent so far.
+    AsyncClient::armDeadline(client, CLIENT_READ_TIMEOUT_MS);
+    client->socket.async_read_some(boost::asio::buffer(client->buf),
+                                   [this, client](const boost::system::error_code &ec, size_t n) {
+        client->request.append(client->buf, n);
+        if (!ec && client->request.find('\n') == std::string::npos && client->request.size() <= MAX_REQUEST_BYTES) {
+            readRequest(client);
+            return;
+        }
+        if (!m_running.load())
+            return;
+        client->response = runCommand(client->request);
+        AsyncClient::armDeadline(client, CLIENT_WRITE_TIMEOUT_MS);
+        boost::asio::async_write(client->socket, boost::asio::buffer(client->response),
+                                 [client](const boost::system::error_code &, size_t) {
+            boost::system::error_code ignored;
+            client->deadline.cancel(ignored);
+        });
+    });
+}
+
+std::string StatsServer::runCommand(const std::string &request)
+{
+    std::string line = request.substr(0, request.find('\n'));
+    while (!line.empty() && (line.back() == '\r' || line.back() == ' '))
+        line.pop_back();
+    size_t space = line.find(' ');
+    std::string command = line.substr(0, space);
+    std::string args = (space == std::string::npos) ? "" : line.substr(space + 1);
+
+    if (command.empty() || command == "metrics")
+        return MetricsRegistry::getInstance()->renderPrometheus();
+
+    CommandHandler handler;
+    {
+        std::lock_guard<std::mutex> lock(m_commandMutex);
+        auto it = m_commands.find(command);
+        if (it != m_commands.end())
+            handler = it->second;
+    }
+    if (handler)
+        return handler(args);
+
+    std::string help = "unknown command '" + command + "'; available: metrics";
+    std::lock_guard<std::mutex> lock(m_commandMutex);
+    for (const auto &c : m_commands)
+        help += " " + c.first;
+    return help + "\n";
+}
+
+void StatsServer::logMetricsDump()
+{
+    std::istringstream metrics(MetricsRegistry::getInstance()->renderPrometheus());
+    std::string line;
+    LOGINFO("---- metrics dump ----");
+    while (std::getline(metrics, line)) {
+        if (!line.empty() && line[0] != '#')
+            LOGINFO("%s", line.c_str());
+    }
+    LOGINFO("---- end of metrics dump ----");
+}
@@ -0,0 +1,185 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2022 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <memory>
+#include <sstream>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include "json/json.h"
+
+#include "Tracer.h"
+
+Tracer *Tracer::mcp_INSTANCE{nullptr};
+
+constexpr size_t Tracer::DEFAULT_CAPACITY;
+
+static uint32_t currentTid()
+{
+    static thread_local uint32_t tid = static_cast<uint32_t>(syscall(SYS_gettid));
+    return tid;
+}
+
+TraceContext &currentTraceContext()
+{
+    static thread_local TraceContext context = {0, 0};
+    return context;
+}
+
+int64_t traceTimestampUs(std::chrono::steady_clock::time_point tp)
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(tp.time_since_epoch()).count();
+}
+
+Tracer::Tracer() : m_ring(DEFAULT_CAPACITY), m_next(0), m_recorded(0), m_enabled(true), m_nextId(1)
+{
+}
+
+Tracer *Tracer::getInstance()
+{
+    if (Tracer::mcp_INSTANCE == nullptr)
+    {
+        Tracer::mcp_INSTANCE = new Tracer();
+    }
+    return Tracer::mcp_INSTANCE;
+}
+
+void Tracer::setCapacity(size_t capacity)
+{
+    std::lock_guard<std::mutex> lock(m_ringMutex);
+    m_ring.assign(capacity, TraceSpan());
+    m_next = 0;
+    m_recorded = 0;
+    m_enabled = (capacity > 0);
+}
+
+void Tracer::record(TraceSpan &&span)
+{
+    std::lock_guard<std::mutex> lock(m_ringMutex);
+    if (m_ring.empty())
+        return;
+    m_ring[m_next] = std::move(span);
+    m_next = (m_next + 1) % m_ring.size();
+    m_recorded++;
+}
+
+void Tracer::clear()
+{
+    std::lock_guard<std::mutex> lock(m_ringMutex);
+    m_next = 0;
+    m_recorded = 0;
+}
+
+std::vector<TraceSpan> Tracer::snapshot()
+{
+    std::vector<TraceSpan> spans;
+    std::lock_guard<std::mutex> lock(m_ringMutex);
+    size_t count = std::min<uint64_t>(m_recorded, m_ring.size());
+    size_t first = (m_next + m_ring.size() - count) % (m_ring.empty() ? 1 : m_ring.size());
+    spans.reserve(count);
+    for (size_t i = 0; i < count; i++)
+        spans.push_back(m_ring[(first + i) % m_ring.size()]);
+    return spans;
+}
+
+std::string Tracer::exportChromeTrace()
+{
+    std::vector<TraceSpan> spans = snapshot();
+
+    Json::Value events(Json::arrayValue);
+    Json::Int pid = static_cast<Json::Int>(getpid());
+    for (const TraceSpan &span : spans) {
+        Json::Value event;
+        event["name"] = span.name;
+        event["cat"] = "xdial";
+        event["ph"] = "X";
+        event["ts"] = static_cast<Json::Int64>(span.startUs);
+        event["dur"] = static_cast<Json::Int64>(span.durationUs);
+        event["pid"] = pid;
+        event["tid"] = static_cast<Json::UInt>(span.tid);
+        event["args"]["trace_id"] = static_cast<Json::UInt64>(span.traceId);
+        event["args"]["span_id"] = static_cast<Json::UInt64>(span.spanId);
+        event["args"]["parent_id"] = static_cast<Json::UInt64>(span.parentId);
+        if (!span.detail.empty())
+            event["args"]["detail"] = span.detail;
+        events.append(event);
+    }
+
+    Json::Value root;
+    root["traceEvents"] = events;
+    root["displayTimeUnit"] = "ms";
+
+    Json::StreamWriterBuilder builder;
+    builder["indentation"] = "";
+    std::ostringstream os;
+    std::unique_ptr<Json::StreamWriter> writer(builder.newStreamWriter());
+    writer->write(root, &os);
+    os << "\n";
+    return os.str();
+}
+
+void recordSpan(const std::string &name, std::chrono::steady_clock::time_point start,
+                std::chrono::steady_clock::time_point end, const std::string &detail)
+{
+    Tracer *tracer = Tracer::getInstance();
+    if (!tracer->isEnabled())
+        return;
+    const TraceContext &context = currentTraceContext();
+    TraceSpan span;
+    span.traceId = context.traceId ? context.traceId : tracer->newId();
+    span.spanId = tracer->newId();
+    span.parentId = context.spanId;
+    span.name = name;
+    span.detail = detail;
+    span.startUs = traceTimestampUs(start);
+    span.durationUs = traceTimestampUs(end) - span.startUs;
+    span.tid = currentTid();
+    tracer->record(std::move(span));
+}
+
+ScopedSpan::ScopedSpan(const char *name, const std::string &detail, std::chrono::steady_clock::time_point start)
+    : m_saved{0, 0}, m_active(Tracer::getInstance()->isEnabled())
+{
+    if (!m_active)
+        return;
+    Tracer *tracer = Tracer::getInstance();
+    TraceContext &context = currentTraceContext();
+    m_saved = context;
+
+    m_span.traceId = context.traceId ? context.traceId : tracer->newId();
+    m_span.spanId = tracer->newId();
+    m_span.parentId = context.spanId;
+    m_span.name = name;
+    m_span.detail = detail;
+    m_span.startUs = traceTimestampUs(start);
+    m_span.durationUs = 0;
+    m_span.tid = currentTid();
+
+    context.traceId = m_span.traceId;
+    context.spanId = m_span.spanId;
+}
+
+ScopedSpan::~ScopedSpan()
+{
+    if (!m_active)
+        return;
+    m_span.durationUs = traceTimestampUs() - m_span.startUs;
+    currentTraceContext() = m_saved;
+    Tracer::getInstance()->record(std::move(m_span));
+}
@@ -20,15 +20,39 @@
 #include <iostream>
 #include <chrono>
 #include <random>
-#include <systemd/sd-daemon.h>
+#include <csignal>
+#include <cstdlib>
+#include <sstream>
+#include <thread>
+#include <vector>
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <condition_variable>
+#include <cerrno>
+#include <cstring>
+#include <climits>
+#include <unistd.h>
+#include <boost/asio/signal_set.hpp>
+#include <boost/asio/steady_timer.hpp>
 
 #include "SmartMonitor.h"
+#include "StatsServer.h"
+#include "ServiceNotifier.h"
+#include "Metrics.h"
+#include "Tracer.h"
+#include "ResponseHandler.h"
+#include "FrameRecorder.h"
+#include "Heartbeat.h"
 #include "EventUtils.h"
 
-// Global debug variables - check environment variable or command line flag
-bool debug = (getenv("SMDEBUG") != NULL);
-bool tdebug = (getenv("SMDEBUG") != NULL);
-bool traceEnabled = (getenv("SMDEBUG") != NULL && std::string(getenv("SMDEBUG")) == "TRACE");
+// Written as "trace" or "transport:trace,monitor:warn"; re-read on SIGHUP.
+static const char *LOG_LEVEL_FILE = "/opt/xdialtester_loglevel";
+
+static const char *DEFAULT_STATS_SOCKET = "/tmp/xdialtester.sock";
+
+// How often a device that lost its Thunder connection is noticed and brought back.
+static const int RECONNECT_CHECK_INTERVAL_IN_MS = 1000;
 
 static const char *VERSION = "2.0.0";
 
@@ -36,6 +60,226 @@ static const char *VERSION = "2.0.0";
 #define GIT_SHORT_SHA "unknown"
 #endif
 
+struct DeviceSpec {
+    string name;
+    string url;
+};
+
+// Every device session in the process; SIGTERM stops all of them.
+static std::vector<SmartMonitor *> s_monitors;
+static std::atomic<bool> s_terminating{false};
+static std::mutex s_terminateLock;
+static std::condition_variable s_terminateCV;
+
+// Signals are only written to this pipe; the main thread reads it and does the real work,
+// so nothing that takes a lock or logs ever runs in a signal handler.
+static int s_signalPipe[2] = {-1, -1};
+
+static void onSignal(int signo)
+{
+    int savedErrno = errno;
+    unsigned char sig = static_cast<unsigned char>(signo);
+    (void)!write(s_signalPipe[1], &sig, 1);
+    errno = savedErrno;
+}
+
+// Blocks until a signal arrives; returns its number, or 0 if the pipe is gone.
+static int waitForSignal()
+{
+    unsigned char sig = 0;
+    ssize_t n;
+    do {
+        n = read(s_signalPipe[0], &sig, 1);
+    } while (n < 0 && errno == EINTR);
+    return n == 1 ? sig : 0;
+}
+
+// Sleeps ms unless termination starts meanwhile; returns false in that case.
+static bool waitUnlessTerminating(int ms)
+{
+    std::unique_lock<std::mutex> lock(s_terminateLock);
+    return !s_terminateCV.wait_for(lock, std::chrono::milliseconds(ms), [] { return s_terminating.load(); });
+}
+
+// Sends every device's unsubscribes first and then waits once, so the whole process spends
+// at most SHUTDOWN_UNSUBSCRIBE_DEADLINE_IN_MS on them however many devices there are.
+static void stopAllDevices()
+{
+    ServiceNotifier::getInstance()->stopping();
+    ServiceNotifier::getInstance()->stopWatchdog();
+    {
+        std::lock_guard<std::mutex> lock(s_terminateLock);
+        s_terminating = true;
+    }
+    s_terminateCV.notify_all();
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(SHUTDOWN_UNSUBSCRIBE_DEADLINE_IN_MS);
+    for (SmartMonitor *smon : s_monitors)
+        smon->beginStop();
+    for (SmartMonitor *smon : s_monitors)
+        smon->finishStop(deadline);
+}
+
+// Parses the N of an --option=N; false for anything but a whole number that fits.
+static bool parseCount(const string &arg, unsigned &count)
+{
+    const char *value = arg.c_str() + arg.find("=") + 1;
+    char *end = nullptr;
+    errno = 0;
+    unsigned long parsed = strtoul(value, &end, 10);
+    if (*value < '0' || *value > '9' || *end != '\0' || errno != 0 || parsed > UINT_MAX)
+        return false;
+    count = static_cast<unsigned>(parsed);
+    return true;
+}
+
+// Parses name=ws://host:port/jsonrpc,name2=ws://... as given to --devices.
+static bool parseDeviceList(const string &list, std::vector<DeviceSpec> &devices)
+{
+    std::stringstream ss(list);
+    string item;
+    while (std::getline(ss, item, ',')) {
+        size_t eq = item.find('=');
+        if (eq == 0 || eq == string::npos || eq + 1 == item.size())
+            return false;
+        devices.push_back({item.substr(0, eq), item.substr(eq + 1)});
+    }
+    return !devices.empty();
+}
+
+// Times the startup phases of one device. Each phase is announced in the service status,
+// exported as startup_phase_ms and summarised in one log line once the device is up. A
+// reconnect goes through the same phases but is only logged.
+class StartupTimer
+{
+    string m_device;
+    string m_labels;
+    bool m_reconnect;
+    string m_report;
+    const char *mp_phase;
+    std::chrono::steady_clock::time_point m_start;
+    std::chrono::steady_clock::time_point m_phaseStart;
+
+    void endPhase(std::chrono::steady_clock::time_point now)
+    {
+        if (mp_phase == nullptr)
+            return;
+        auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(now - m_phaseStart).count();
+        if (!m_reconnect)
+            MetricsRegistry::getInstance()->gauge("startup_phase_ms", joinLabels(m_labels, metricLabel("phase", mp_phase)))->set(ms);
+        m_report += (m_report.empty() ? "" : ", ") + string(mp_phase) + " " + std::to_string(ms) + " ms";
+    }
+
+public:
+    StartupTimer(const string &device, bool reconnect)
+        : m_device(device), m_labels(device.empty() ? "" : metricLabel("device", device)), m_reconnect(reconnect),
+          mp_phase(nullptr), m_start(std::chrono::steady_clock::now())
+    {
+    }
+
+    void phase(const char *name, const char *status)
+    {
+        auto now = std::chrono::steady_clock::now();
+        endPhase(now);
+        mp_phase = name;
+        m_phaseStart = now;
+        ServiceNotifier::getInstance()->status("%s%s%s", m_device.c_str(), m_device.empty() ? "" : ": ", status);
+    }
+
+    void finish()
+    {
+        auto now = std::chrono::steady_clock::now();
+        endPhase(now);
+        mp_phase = nullptr;
+        auto total = std::chrono::duration_cast<std::chrono::milliseconds>(now - m_start).count();
+        if (!m_reconnect)
+            MetricsRegistry::getInstance()->gauge("startup_total_ms", m_labels)->set(total);
+        LOGINFO("%s%s%s took %lld ms: %s", m_reconnect ? "Reconnect" : "Startup", m_device.empty() ? "" : " of ",
+                m_device.c_str(), static_cast<long long>(total), m_report.c_str());
+    }
+};
+
+static std::atomic<size_t> s_devicesReady{0};
+
+// Brings one device up the same way the single device client always has: connect, retrying
+// every 5 s, then subscribe and register the DIAL apps. In single thread mode the wait runs
+// the io loop, which is what completes the connect. systemd is told we are ready once the
+// last device has registered its apps. A reconnect repeats all of it but leaves systemd alone.
+static void startDevice(SmartMonitor *smon, IoServicePool *ioPool, const string &friendlyname,
+                        const string &appCallsigns, bool reconnect = false)
+{
+    StartupTimer timer(smon->getDeviceName(), reconnect);
+    timer.phase("connect", "Connecting to Thunder");
+    do
+    {
+        if (s_terminating)
+            return;
+        smon->connectToThunder();
+         LOGINFO("Waiting for connection status %s", smon->getDeviceName().c_str());
+        if (ioPool != nullptr && ioPool->runsOnCaller())
+            ioPool->ioService().run_for(std::chrono::milliseconds(5000));
+        else if (!waitUnlessTerminating(5000))
+            return;
+    } while (!smon->getConnectStatus());
+    if (s_terminating)
+        return;
+    timer.phase("subscribe", "Subscribing to Thunder events");
+    smon->registerForEvents();
+    timer.phase("standby", "Setting standby behaviour");
+    smon->setStandbyBehaviour();
+    timer.phase("casting", "Enabling casting");
+    smon->checkAndEnableCasting(friendlyname);
+    timer.phase("registration", "Registering DIAL apps");
+	LOGINFO("Enabling DIAL apps: %s", appCallsigns.c_str());
+    smon->registerDIALApps(appCallsigns);
+    timer.finish();
+
+    if (!reconnect && ++s_devicesReady == s_monitors.size() && !s_terminating)
+        ServiceNotifier::getInstance()->ready("Casting registered for " + std::to_string(s_monitors.size()) +
+                                              (s_monitors.size() == 1 ? " device" : " devices"));
+}
+
+// Brings a device back up if its connection was lost, closed by Thunder or dropped as stalled
+// by the heartbeat: Thunder forgets the subscriptions and app registrations with it.
+static void recoverDevice(SmartMonitor *smon, IoServicePool *ioPool, const string &friendlyname,
+                          const string &appCallsigns)
+{
+    if (s_terminating || smon->getConnectStatus())
+        return;
+    LOGWARN("Connection to Thunder%s%s lost, reconnecting", smon->getDeviceName().empty() ? "" : " of ",
+            smon->getDeviceName().c_str());
+    const string &device = smon->getDeviceName();
+    MetricsRegistry::getInstance()->counter("thunder_reconnects_total", device.empty() ? "" : metricLabel("device", device))->inc();
+    startDevice(smon, ioPool, friendlyname, appCallsigns, true);
+}
+
+// Starts a device and then keeps it connected until shutdown; one thread per device.
+static void runDevice(SmartMonitor *smon, IoServicePool *ioPool, const string &friendlyname,
+                      const string &appCallsigns)
+{
+    startDevice(smon, ioPool, friendlyname, appCallsigns);
+    while (waitUnlessTerminating(RECONNECT_CHECK_INTERVAL_IN_MS)) {
+        recoverDevice(smon, ioPool, friendlyname, appCallsigns);
+        smon->maintainWarmPool();
+    }
+}
+
+// Watchdog health: every device's event dispatch has beaten within maxAge.
+static bool devicesHealthy(std::chrono::steady_clock::duration maxAge)
+{
+    auto now = std::chrono::steady_clock::now();
+    bool healthy = true;
+    for (SmartMonitor *smon : s_monitors) {
+        auto age = now - smon->lastDispatchHeartbeat();
+        if (age > maxAge) {
+            LOGWARN("Event dispatch%s%s stalled for %lld ms, withholding watchdog ping",
+                    smon->getDeviceName().empty() ? "" : " of ", smon->getDeviceName().c_str(),
+                    static_cast<long long>(std::chrono::duration_cast<std::chrono::milliseconds>(age).count()));
+            healthy = false;
+        }
+    }
+    return healthy;
+}
+
 // Generate 8-digit random number for default friendly name
 std::string generateDefaultFriendlyName() {
     std::random_device rd;
@@ -47,12 +291,51 @@ std::string generateDefaultFriendlyName() {
 /***
  * Main entry point for the application
  * Usage: xdialtester --enable-apps=app1,app2,app3 [--enable-debug] [--enable-trace] [--friendlyname=myDevice12345]
+ *                    [--log-overflow=drop|block] [--log-sync] [--log-level=<spec>]
+ *                    [--log-payload-bytes=N] [--log-payload-every=N] [--stats-socket=<path>]
+ *                    [--trace-spans=N] [--handler-budget-ms=N] [--heartbeat-ms=N] [--heartbeat-misses=N]
+ *                    [--no-event-coalescing] [--dial-dedup-ms=N] [--no-dial-state-push] [--max-queued-events=N] [--max-event-lag-ms=N]
+ *                    [--max-inflight=N] [--max-inflight-per-method=N] [--admission-wait-ms=N]
+ *                    [--warm-apps=app1,app2] [--warm-budget-mb=N]
+ *                    [--thunder-url=ws://host:port/jsonrpc] [--request-connections=N]
+ *                    [--capture=<path>] [--capture-max-mb=N]
+ *                    [--devices=name=ws://host:port/jsonrpc,...] [--io-threads=N] [--single-thread]
  */
 int main(int argc, char *argv[])
 {
     LOGINFO("Smart Monitor: %s (%s)" , VERSION, GIT_SHORT_SHA);
     string appCallsigns = "YouTube,Netflix,Amazon";
     string friendlyname = generateDefaultFriendlyName();
+    LogOverflowPolicy logOverflow = LogOverflowPolicy::DROP;
+    bool asyncLogging = true;
+    unsigned payloadBytes = 256;
+    unsigned payloadEvery = 1;
+    string statsSocket = DEFAULT_STATS_SOCKET;
+    size_t traceSpans = Tracer::DEFAULT_CAPACITY;
+    unsigned handlerBudgetMs = 250;
+    unsigned heartbeatMs = 2000;
+    unsigned heartbeatMisses = 3;
+    unsigned requestConns = 0;
+    bool coalesceEvents = true;
+    unsigned dialDedupMs = 1000;
+    bool pushDialState = true;
+    unsigned maxQueuedEvents = 256;
+    unsigned maxEventLagMs = 2000;
+    unsigned maxInFlight = 64;
+    unsigned maxInFlightPerMethod = 16;
+    unsigned admissionWaitMs = 0;
+    string warmApps;
+    unsigned warmBudgetMb = 0;
+    string thunderUrl;
+    string capturePath;
+    size_t captureMaxMb = FrameRecorder::DEFAULT_MAX_BYTES / (1024 * 1024);
+    std::vector<DeviceSpec> devices;
+    size_t ioThreads = 0;
+    bool singleThread = false;
+    if (getenv("SMDEBUG") != NULL && std::string(getenv("SMDEBUG")) == "TRACE")
+        setAllLogLevels(LOG_LEVEL_TRACE);
+    // The level file is what SIGHUP applies; at startup the command line still has the last word.
+    reloadLogLevelsFromFile(LOG_LEVEL_FILE);
     if (argc > 1) {
 		for (int i = 1; i < argc; i++) {
 		    string arg = argv[i];
@@ -64,32 +347,248 @@ int main(int argc, char *argv[])
 			    tdebug = true;
 			    LOGINFO("Debug mode enabled");
 		    } else if (arg == "--enable-trace") {
-			    traceEnabled = true;
+			    setAllLogLevels(LOG_LEVEL_TRACE);
 			    LOGINFO("Trace logging enabled");
 			} else if (arg.find("--friendlyname=") != string::npos) {
 				friendlyname = arg.substr(arg.find("=") + 1);
+			} else if (arg.find("--log-overflow=") != string::npos) {
+				if (!parseLogOverflowPolicy(arg.substr(arg.find("=") + 1).c_str(), logOverflow)) {
+					LOGERR("Invalid log overflow policy %s. Use drop or block", arg.c_str());
+					return -1;
+				}
+			} else if (arg == "--log-sync") {
+				asyncLogging = false;
+			} else if (arg.find("--log-level=") != string::npos) {
+				if (!applyLogLevelSpec(arg.substr(arg.find("=") + 1).c_str())) {
+					LOGERR("Invalid log level spec %s. Use <level> or <module>:<level>,... with modules transport, response, protocol, monitor, all", arg.c_str());
+					return -1;
+				}
+			} else if (arg.find("--log-payload-bytes=") != string::npos) {
+				if (!parseCount(arg, payloadBytes)) {
+					LOGERR("Invalid payload log size %s. Use a number of bytes", arg.c_str());
+					return -1;
+				}
+			} else if (arg.find("--log-payload-every=") != string::npos) {
+				if (!parseCount(arg, payloadEvery)) {
+					LOGERR("Invalid payload log rate %s. Use a number of frames", arg.c_str());
+					return -1;
+				}
+			} else if (arg.find("--stats-socket=") != string::npos) {
+				statsSocket = arg.substr(arg.find("=") + 1);
+			} else if (arg.find("--thunder-url=") != string::npos) {
+				thunderUrl = arg.substr(arg.find("=") + 1);
+			} else if (arg.find("--trace-spans=") != string::npos) {
+				traceSpans = strtoul(arg.substr(arg.find("=") + 1).c_str(), nullptr, 10);
+			} else if (arg.find("--handler-budget-ms=") != string::npos) {
+				handlerBudgetMs = strtoul(arg.substr(arg.find("=") + 1).c_str(), nullptr, 10);
+			} else if (arg.find("--heartbeat-ms=") != string::npos) {
+				heartbeatMs = strtoul(arg.substr(arg.find("=") + 1).c_str(), nullptr, 10);
+			} else if (arg.find("--heartbeat-misses=") != string::npos) {
+				heartbeatMisses = strtoul(arg.substr(arg.find("=") + 1).c_str(), nullptr, 10);
+			} else if (arg == "--no-event-coalescing") {
+				coalesceEvents = false;
+			} else if (arg.find("--dial-dedup-ms=") != string::npos) {
+				dialDedupMs = strtoul(arg.substr(arg.find("=") + 1).c_str(), nullptr, 10);
+			} else if (arg == "--no-dial-state-push") {
+				pushDialState = false;
+			} else if (arg.find("--max-queued-events=") != string::npos) {
+				if (!parseCount(arg, maxQueuedEvents)) {
+					LOGERR("Invalid event queue cap %s. Use a number of events, 0 for no cap", arg.c_str());
+					return -1;
+				}
+			} else if (arg.find("--max-event-lag-ms=") != string::npos) {
+				if (!parseCount(arg, maxEventLagMs)) {
+					LOGERR("Invalid event lag %s. Use a number of milliseconds, 0 to ignore the lag", arg.c_str());
+					return -1;
+				}
+			} else if (arg.find("--max-inflight=") != string::npos) {
+				if (!parseCount(arg, maxInFlight)) {
+					LOGERR("Invalid in-flight cap %s. Use a number of requests, 0 for no cap", arg.c_str());
+					return -1;
+				}
+			} else if (arg.find("--max-inflight-per-method=") != string::npos) {
+				if (!parseCount(arg, maxInFlightPerMethod)) {
+					LOGERR("Invalid in-flight cap %s. Use a number of requests, 0 for no cap", arg.c_str());
+					return -1;
+				}
+			} else if (arg.find("--admission-wait-ms=") != string::npos) {
+				if (!parseCount(arg, admissionWaitMs)) {
+					LOGERR("Invalid admission wait %s. Use a number of milliseconds, 0 to reject at once", arg.c_str());
+					return -1;
+				}
+			} else if (arg.find("--warm-apps=") != string::npos) {
+				warmApps = arg.substr(arg.find("=") + 1);
+			} else if (arg.find("--warm-budget-mb=") != string::npos) {
+				warmBudgetMb = strtoul(arg.substr(arg.find("=") + 1).c_str(), nullptr, 10);
+			} else if (arg.find("--request-connections=") != string::npos) {
+				requestConns = strtoul(arg.substr(arg.find("=") + 1).c_str(), nullptr, 10);
+			} else if (arg.find("--capture=") != string::npos) {
+				capturePath = arg.substr(arg.find("=") + 1);
+			} else if (arg.find("--capture-max-mb=") != string::npos) {
+				captureMaxMb = strtoul(arg.substr(arg.find("=") + 1).c_str(), nullptr, 10);
+			} else if (arg.find("--devices=") != string::npos) {
+				if (!parseDeviceList(arg.substr(arg.find("=") + 1), devices)) {
+					LOGERR("Invalid device list %s. Use name=ws://host:port/jsonrpc,...", arg.c_str());
+					return -1;
+				}
+			} else if (arg.find("--io-threads=") != string::npos) {
+				ioThreads = strtoul(arg.substr(arg.find("=") + 1).c_str(), nullptr, 10);
+			} else if (arg == "--single-thread") {
+				singleThread = true;
 		    } else {
-			    LOGERR("Invalid argument %s. Usage: xdialtester --enable-apps=app1,app2,app3 [--enable-debug] [--enable-trace] [--friendlyname=myDevice12345]", arg.c_str());
+			    LOGERR("Invalid argument %s. Usage: xdialtester --enable-apps=app1,app2,app3 [--enable-debug] [--enable-trace] [--friendlyname=myDevice12345] [--log-overflow=drop|block] [--log-sync] [--log-level=<spec>] [--log-payload-bytes=N] [--log-payload-every=N] [--stats-socket=<path>] [--trace-spans=N] [--handler-budget-ms=N] [--heartbeat-ms=N] [--heartbeat-misses=N] [--no-event-coalescing] [--dial-dedup-ms=N] [--no-dial-state-push] [--max-queued-events=N] [--max-event-lag-ms=N] [--max-inflight=N] [--max-inflight-per-method=N] [--admission-wait-ms=N] [--warm-apps=app1,app2] [--warm-budget-mb=N] [--thunder-url=ws://host:port/jsonrpc] [--request-connections=N] [--capture=<path>] [--capture-max-mb=N] [--devices=name=url,...] [--io-threads=N] [--single-thread]", arg.c_str());
 			    return -1;
 		    }
 		}
     }
+    setPayloadLogging(payloadBytes, payloadEvery);
+    // Single thread mode handles signals on the io loop and logs from the calling thread.
+    if (singleThread) {
+        asyncLogging = false;
+    } else {
+        if (pipe(s_signalPipe) != 0) {
+            LOGERR("Failed to create the signal pipe: %s", strerror(errno));
+            return -1;
+        }
+        signal(SIGTERM, onSignal);
+        signal(SIGHUP, onSignal);
+        signal(SIGUSR1, onSignal);
+    }
+    if (asyncLogging)
+        Logger::getInstance()->start(logOverflow);
 
-    SmartMonitor *smon = SmartMonitor::getInstance();
-    smon->initialize();
+    Tracer::getInstance()->setCapacity(traceSpans);
+    setHandlerBudget(handlerBudgetMs);
+    setHeartbeat(heartbeatMs, heartbeatMisses);
+    setRequestConnections(requestConns);
+    setEventCoalescing(coalesceEvents);
+    setDialDedupWindow(dialDedupMs);
+    setDialStatePush(pushDialState);
+    setEventQueueLimits(maxQueuedEvents, maxEventLagMs);
+    setRequestLimits(maxInFlight, maxInFlightPerMethod, admissionWaitMs);
+    StatsServer::getInstance()->registerCommand("trace", [](const std::string &args) {
+        if (args == "clear") {
+            Tracer::getInstance()->clear();
+            return std::string("trace buffer cleared\n");
+        }
+        return Tracer::getInstance()->exportChromeTrace();
+    });
+    // Without --devices there is one unlabelled device running its own io thread, as before.
+    // With it, every device gets its own session and all sockets share one io pool. With
+    // --single-thread the pool has no threads: the main thread runs it and everything else.
+    IoServicePool *ioPool = nullptr;
+    if (devices.empty()) {
+        devices.push_back({"", thunderUrl});
+    } else {
+        if (!thunderUrl.empty())
+            LOGWARN("--thunder-url is ignored when --devices is given");
+        if (ioThreads == 0)
+            ioThreads = std::min<size_t>(devices.size(), std::max(1u, std::thread::hardware_concurrency()));
+    }
+    // A warm-up blocks DIAL requests for its app, which would stall the only thread.
+    if (singleThread && !warmApps.empty()) {
+        LOGWARN("--warm-apps is ignored with --single-thread");
+        warmApps.clear();
+    }
+    if (singleThread)
+        ioPool = new IoServicePool(0);
+    else if (ioThreads != 0)
+        ioPool = new IoServicePool(ioThreads);
 
-    do
-    {
-        smon->connectToThunder();
-         LOGINFO("Waiting for connection status ");
-        std::this_thread::sleep_for(std::chrono::milliseconds(5000));
-    } while (!smon->getConnectStatus());
-    smon->registerForEvents();
-    smon->setStandbyBehaviour();
-    smon->checkAndEnableCasting(friendlyname);
-	LOGINFO("Enabling DIAL apps: %s", appCallsigns.c_str());
-    smon->registerDIALApps(appCallsigns);
-    smon->waitForTermSignal();
+    StatsServer::getInstance()->start(statsSocket, singleThread ? &ioPool->ioService() : nullptr);
+
+    for (const auto &device : devices) {
+        SmartMonitor *smon = new SmartMonitor(device.name, ioPool);
+        smon->initialize();
+        if (!warmApps.empty())
+            smon->setWarmPool(warmApps, warmBudgetMb);
+        if (!device.url.empty())
+            smon->setThunderConnectionURL(device.url);
+        if (!capturePath.empty())
+            smon->startCapture(device.name.empty() ? capturePath : capturePath + "." + device.name,
+                               captureMaxMb * 1024 * 1024);
+        s_monitors.push_back(smon);
+    }
+    ServiceNotifier::getInstance()->startWatchdog(devicesHealthy, singleThread ? &ioPool->ioService() : nullptr);
+    std::chrono::steady_clock::time_point termStart = std::chrono::steady_clock::now();
+    if (singleThread) {
+        boost::asio::io_service &io = ioPool->ioService();
+        boost::asio::signal_set signals(io, SIGTERM, SIGHUP, SIGUSR1);
+        std::function<void(const boost::system::error_code &, int)> onSignal;
+        onSignal = [&](const boost::system::error_code &ec, int signo) {
+            if (ec)
+                return;
+            if (signo == SIGTERM) {
+                termStart = std::chrono::steady_clock::now();
+                stopAllDevices();
+                io.stop();
+                return;
+            }
+            if (signo == SIGHUP)
+                reloadLogLevelsFromFile(LOG_LEVEL_FILE);
+            else
+                StatsServer::getInstance()->requestDump();
+            signals.async_wait(onSignal);
+        };
+        signals.async_wait(onSignal);
+
+        for (SmartMonitor *smon : s_monitors)
+            startDevice(smon, ioPool, s_monitors.size() == 1 ? friendlyname : friendlyname + "-" + smon->getDeviceName(),
+                        appCallsigns);
+        boost::asio::steady_timer reconnectTimer(io);
+        std::function<void(const boost::system::error_code &)> onReconnectCheck;
+        onReconnectCheck = [&](const boost::system::error_code &ec) {
+            if (ec || s_terminating)
+                return;
+            for (SmartMonitor *smon : s_monitors)
+                recoverDevice(smon, ioPool,
+                              s_monitors.size() == 1 ? friendlyname : friendlyname + "-" + smon->getDeviceName(),
+                              appCallsigns);
+            reconnectTimer.expires_after(std::chrono::milliseconds(RECONNECT_CHECK_INTERVAL_IN_MS));
+            reconnectTimer.async_wait(onReconnectCheck);
+        };
+        reconnectTimer.expires_after(std::chrono::milliseconds(RECONNECT_CHECK_INTERVAL_IN_MS));
+        reconnectTimer.async_wait(onReconnectCheck);
+        if (!io.stopped())
+            io.run();
+        for (SmartMonitor *smon : s_monitors)
+            smon->stopCapture();
+    } else {
+        // Startup and reconnects run on their own threads so a SIGTERM during a connect retry
+        // or a slow subscribe is handled at once; shutting the sessions down releases them.
+        std::vector<std::thread> startup;
+        for (SmartMonitor *smon : s_monitors)
+            startup.emplace_back(runDevice, smon, ioPool,
+                                 s_monitors.size() == 1 ? friendlyname : friendlyname + "-" + smon->getDeviceName(),
+                                 appCallsigns);
+        int signo;
+        while ((signo = waitForSignal()) != 0 && signo != SIGTERM) {
+            if (signo == SIGHUP)
+                reloadLogLevelsFromFile(LOG_LEVEL_FILE);
+            else if (signo == SIGUSR1)
+                StatsServer::getInstance()->requestDump();
+        }
+        termStart = std::chrono::steady_clock::now();
+        stopAllDevices();
+        for (SmartMonitor *smon : s_monitors) {
+            smon->stopCapture();
+            smon->shutdown();
+        }
+        for (auto &thread : startup)
+            thread.join();
+    }
+
+    // The pool's threads run the transports' handlers; stop them before the sessions go.
+    if (ioPool != nullptr)
+        ioPool->stop();
+    for (SmartMonitor *smon : s_monitors)
+        delete smon;
+    s_monitors.clear();
+    StatsServer::getInstance()->stop();
+    delete ioPool;
 
+    LOGINFO("Shutdown took %lld ms", static_cast<long long>(std::chrono::duration_cast<std::chrono::milliseconds>(
+                                         std::chrono::steady_clock::now() - termStart).count()));
+    Logger::getInstance()->stop();
     return 0;
 }
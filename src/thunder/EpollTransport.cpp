@@ -0,0 +1,742 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2022 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_MODULE LOG_MODULE_TRANSPORT
+
+#include "EpollTransport.h"
+#include "EventUtils.h"
+
+#include <cerrno>
+#include <cstring>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <strings.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using Clock = std::chrono::steady_clock;
+
+// RFC 6455 opcodes
+static constexpr uint8_t OP_CONTINUATION = 0x0;
+static constexpr uint8_t OP_TEXT = 0x1;
+static constexpr uint8_t OP_BINARY = 0x2;
+static constexpr uint8_t OP_CLOSE = 0x8;
+static constexpr uint8_t OP_PING = 0x9;
+static constexpr uint8_t OP_PONG = 0xA;
+
+// Close status codes
+static constexpr uint16_t CLOSE_NORMAL = 1000;
+static constexpr uint16_t CLOSE_GOING_AWAY = 1001;
+static constexpr uint16_t CLOSE_PROTOCOL_ERROR = 1002;
+static constexpr uint16_t CLOSE_TOO_BIG = 1009;
+
+// The same limits websocketpp's asio client applies.
+static constexpr int OPEN_HANDSHAKE_TIMEOUT_IN_MS = 5000;
+static constexpr size_t MAX_MESSAGE_BYTES = 32 * 1024 * 1024;
+static constexpr size_t MAX_RESPONSE_HEADER_BYTES = 8192;
+static constexpr size_t READ_CHUNK_BYTES = 64 * 1024;
+
+static const char s_acceptGuid[] = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+
+// SHA-1 of data, only needed to check Sec-WebSocket-Accept.
+static void sha1(const std::string &data, uint8_t digest[20])
+{
+    uint32_t h[5] = {0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0};
+    std::string msg = data;
+    uint64_t bits = static_cast<uint64_t>(data.size()) * 8;
+    msg.push_back(static_cast<char>(0x80));
+    while (msg.size() % 64 != 56)
+        msg.push_back('\0');
+    for (int i = 7; i >= 0; i--)
+        msg.push_back(static_cast<char>(bits >> (i * 8)));
+
+    auto rol = [](uint32_t v, int n) { return (v << n) | (v >> (32 - n)); };
+    for (size_t block = 0; block < msg.size(); block += 64) {
+        uint32_t w[80];
+        for (int i = 0; i < 16; i++) {
+            const uint8_t *p = reinterpret_cast<const uint8_t *>(msg.data()) + block + i * 4;
+            w[i] = (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) | (uint32_t(p[2]) << 8) | p[3];
+        }
+        for (int i = 16; i < 80; i++)
+            w[i] = rol(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+        uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+        for (int i = 0; i < 80; i++) {
+            uint32_t f, k;
+            if (i < 20) {
+                f = (b & c) | (~b & d);
+                k = 0x5A827999;
+            } else if (i < 40) {
+                f = b ^ c ^ d;
+                k = 0x6ED9EBA1;
+            } else if (i < 60) {
+                f = (b & c) | (b & d) | (c & d);
+                k = 0x8F1BBCDC;
+            } else {
+                f = b ^ c ^ d;
+                k = 0xCA62C1D6;
+            }
+            uint32_t t = rol(a, 5) + f + e + k + w[i];
+            e = d;
+            d = c;
+            c = rol(b, 30);
+            b = a;
+            a = t;
+        }
+        h[0] += a;
+        h[1] += b;
+        h[2] += c;
+        h[3] += d;
+        h[4] += e;
+    }
+    for (int i = 0; i < 20; i++)
+        digest[i] = static_cast<uint8_t>(h[i / 4] >> (24 - (i % 4) * 8));
+}
+
+static std::string base64(const uint8_t *data, size_t size)
+{
+    static const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    std::string out;
+    for (size_t i = 0; i < size; i += 3) {
+        uint32_t v = uint32_t(data[i]) << 16;
+        if (i + 1 < size)
+            v |= uint32_t(data[i + 1]) << 8;
+        if (i + 2 < size)
+            v |= data[i + 2];
+        out.push_back(alphabet[(v >> 18) & 0x3F]);
+        out.push_back(alphabet[(v >> 12) & 0x3F]);
+        out.push_back(i + 1 < size ? alphabet[(v >> 6) & 0x3F] : '=');
+        out.push_back(i + 2 < size ? alphabet[v & 0x3F] : '=');
+    }
+    return out;
+}
+
+// Splits ws://host[:port][/path]; IPv6 hosts are given in brackets.
+static bool parseUrl(const std::string &url, std::string &host, std::string &port, std::string &path)
+{
+    const std::string scheme = "ws://";
+    if (url.compare(0, scheme.size(), scheme) != 0)
+        return false;
+    size_t hostStart = scheme.size();
+    size_t pathStart = url.find('/', hostStart);
+    std::string authority = url.substr(hostStart, pathStart == std::string::npos ? std::string::npos : pathStart - hostStart);
+    path = pathStart == std::string::npos ? "/" : url.substr(pathStart);
+
+    size_t portSep = authority.rfind(':');
+    size_t bracket = authority.rfind(']');
+    if (portSep != std::string::npos && (bracket == std::string::npos || portSep > bracket)) {
+        host = authority.substr(0, portSep);
+        port = authority.substr(portSep + 1);
+    } else {
+        host = authority;
+        port = "80";
+    }
+    if (host.size() >= 2 && host.front() == '[' && host.back() == ']')
+        host = host.substr(1, host.size() - 2);
+    return !host.empty() && !port.empty();
+}
+
+static int remainingMs(Clock::time_point deadline)
+{
+    auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - Clock::now()).count();
+    return left > 0 ? static_cast<int>(left) : 0;
+}
+
+EpollTransport::EpollTransport(IoServicePool *pool, const std::string &device)
+    : mp_pool(pool), m_heartbeat(device.empty() ? "" : metricLabel("device", device)), m_random(std::random_device{}())
+{
+    MetricsRegistry *metrics = MetricsRegistry::getInstance();
+    const std::string label = device.empty() ? "" : metricLabel("device", device);
+    mp_framesOut = metrics->counter("ws_frames_out_total", label);
+    mp_bytesOut = metrics->counter("ws_bytes_out_total", label);
+    mp_framesIn = metrics->counter("ws_frames_in_total", label);
+    mp_bytesIn = metrics->counter("ws_bytes_in_total", label);
+
+    m_epollFd = epoll_create1(EPOLL_CLOEXEC);
+    m_wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+}
+
+EpollTransport::~EpollTransport()
+{
+    closeSocket();
+    if (m_wakeFd >= 0)
+        close(m_wakeFd);
+    if (m_epollFd >= 0)
+        close(m_epollFd);
+}
+
+int EpollTransport::initializeTransport()
+{
+    if (m_epollFd < 0 || m_wakeFd < 0) {
+        LOGERR("[EpollTransport::initialize] %s", strerror(errno));
+        return -1;
+    }
+    epoll_event ev{};
+    ev.events = EPOLLIN;
+    ev.data.fd = m_wakeFd;
+    if (epoll_ctl(m_epollFd, EPOLL_CTL_ADD, m_wakeFd, &ev) < 0 && errno != EEXIST) {
+        LOGERR("[EpollTransport::initialize] %s", strerror(errno));
+        return -1;
+    }
+    LOGTRACE("[EpollTransport::initialize] Connecting to %s", m_wsUrl.c_str());
+    return 0;
+}
+
+void EpollTransport::setState(ConnectionState state)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_stateMutex);
+        m_connectionState.store(state);
+    }
+    m_stateChanged.notify_all();
+}
+
+void EpollTransport::runOnIo(std::function<void()> fn)
+{
+    if (mp_pool != nullptr && mp_pool->runsOnCaller())
+        mp_pool->ioService().post(std::move(fn));
+    else
+        fn();
+}
+
+void EpollTransport::connect()
+{
+    setState(ConnectionState::CONNECTING);
+    // A disconnect() of an earlier connection must not abort this one.
+    m_closeRequested.store(false);
+    uint64_t wakes;
+    while (read(m_wakeFd, &wakes, sizeof(wakes)) > 0)
+        ;
+
+    std::string host, port, path;
+    if (!parseUrl(m_wsUrl, host, port, path)) {
+        LOGERR("[EpollTransport::connect] %s: not a ws:// URL", m_wsUrl.c_str());
+        setState(ConnectionState::ERROR_STATE);
+        return;
+    }
+
+    auto deadline = Clock::now() + std::chrono::milliseconds(OPEN_HANDSHAKE_TIMEOUT_IN_MS);
+    int fd = openSocket(host, port, deadline);
+    if (fd >= 0) {
+        std::lock_guard<std::mutex> lock(m_sendMutex);
+        m_fd = fd;
+    }
+    if (fd < 0 || !handshake(host, port, path, deadline)) {
+        closeSocket();
+        if (m_closeRequested.load()) {
+            // Given up on purpose, like TransportHandler stopping a pending connect.
+            setState(ConnectionState::DISCONNECTED);
+            return;
+        }
+        if (tdebug)
+            LOGERR("[EpollTransport::connect] Connection failed...");
+        setState(ConnectionState::ERROR_STATE);
+        if (nullptr != m_conHandler)
+            runOnIo([this] { m_conHandler(false); });
+        return;
+    }
+
+    if (tdebug)
+        LOGTRACE("[EpollTransport::connect] Connected. Ready to send message");
+    setState(ConnectionState::CONNECTED);
+    m_heartbeat.reset();
+    if (nullptr != m_conHandler)
+        runOnIo([this] { m_conHandler(true); });
+
+    serviceConnection();
+
+    closeSocket();
+    setState(ConnectionState::DISCONNECTED);
+    if (tdebug)
+        LOGTRACE("[EpollTransport::connect] Connection closed");
+    if (nullptr != m_conHandler)
+        runOnIo([this] { m_conHandler(false); });
+}
+
+int EpollTransport::openSocket(const std::string &host, const std::string &port, Clock::time_point deadline)
+{
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo *addresses = nullptr;
+    int rc = getaddrinfo(host.c_str(), port.c_str(), &hints, &addresses);
+    if (rc != 0) {
+        LOGERR("[EpollTransport::connect] %s: %s", host.c_str(), gai_strerror(rc));
+        return -1;
+    }
+
+    int fd = -1;
+    for (addrinfo *ai = addresses; ai != nullptr && fd < 0 && !m_closeRequested.load(); ai = ai->ai_next) {
+        fd = socket(ai->ai_family, ai->ai_socktype | SOCK_NONBLOCK | SOCK_CLOEXEC, ai->ai_protocol);
+        if (fd < 0)
+            continue;
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+        epoll_event ev{};
+        ev.events = EPOLLOUT;
+        ev.data.fd = fd;
+        bool ok = epoll_ctl(m_epollFd, EPOLL_CTL_ADD, fd, &ev) == 0;
+        if (ok && ::connect(fd, ai->ai_addr, ai->ai_addrlen) < 0) {
+            ok = errno == EINPROGRESS;
+            if (ok) {
+                ok = waitReady(fd, EPOLLOUT, deadline);
+                int error = 0;
+                socklen_t len = sizeof(error);
+                ok = ok && getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &len) == 0 && error == 0;
+            }
+        }
+        if (!ok) {
+            epoll_ctl(m_epollFd, EPOLL_CTL_DEL, fd, nullptr);
+            close(fd);
+            fd = -1;
+        }
+    }
+    freeaddrinfo(addresses);
+    return fd;
+}
+
+bool EpollTransport::waitReady(int fd, uint32_t events, Clock::time_point deadline)
+{
+    epoll_event ev{};
+    ev.events = events;
+    ev.data.fd = fd;
+    if (epoll_ctl(m_epollFd, EPOLL_CTL_MOD, fd, &ev) < 0)
+        return false;
+    while (!m_closeRequested.load()) {
+        int timeout = remainingMs(deadline);
+        if (timeout == 0)
+            return false;
+        epoll_event ready[2];
+        int n = epoll_wait(m_epollFd, ready, 2, timeout);
+        if (n < 0 && errno != EINTR)
+            return false;
+        for (int i = 0; i < n; i++) {
+            // Errors and hangups surface on the read or write that follows.
+            if (ready[i].data.fd == fd)
+                return true;
+        }
+    }
+    return false;
+}
+
+bool EpollTransport::handshake(const std::string &host, const std::string &port, const std::string &path,
+                               Clock::time_point deadline)
+{
+    uint8_t nonce[16];
+    for (auto &byte : nonce)
+        byte = static_cast<uint8_t>(m_random());
+    const std::string key = base64(nonce, sizeof(nonce));
+    const bool ipv6 = host.find(':') != std::string::npos;
+    std::string authority = ipv6 ? "[" + host + "]" : host;
+    if (port != "80")
+        authority += ":" + port;
+
+    std::string request = "GET " + path + " HTTP/1.1\r\n"
+                          "Host: " + authority + "\r\n"
+                          "Upgrade: websocket\r\n"
+                          "Connection: Upgrade\r\n"
+                          "Sec-WebSocket-Key: " + key + "\r\n"
+                          "Sec-WebSocket-Version: 13\r\n\r\n";
+    size_t sent = 0;
+    while (sent < request.size()) {
+        ssize_t n = ::send(m_fd, request.data() + sent, request.size() - sent, MSG_NOSIGNAL);
+        if (n > 0)
+            sent += n;
+        else if (n < 0 && errno == EINTR)
+            continue;
+        else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            if (!waitReady(m_fd, EPOLLOUT, deadline))
+                return false;
+        } else
+            return false;
+    }
+
+    m_inbox.clear();
+    size_t headerEnd;
+    while ((headerEnd = m_inbox.find("\r\n\r\n")) == std::string::npos) {
+        if (m_inbox.size() > MAX_RESPONSE_HEADER_BYTES)
+            return false;
+        char buffer[1024];
+        ssize_t n = ::recv(m_fd, buffer, sizeof(buffer), 0);
+        if (n > 0)
+            m_inbox.append(buffer, n);
+        else if (n < 0 && errno == EINTR)
+            continue;
+        else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            if (!waitReady(m_fd, EPOLLIN, deadline))
+                return false;
+        } else
+            return false;
+    }
+
+    // Anything after the header is already WebSocket frames and stays in m_inbox.
+    std::string header = m_inbox.substr(0, headerEnd);
+    m_inbox.erase(0, headerEnd + 4);
+    if (header.compare(0, 12, "HTTP/1.1 101") != 0) {
+        LOGERR("[EpollTransport::connect] Upgrade refused: %s", header.substr(0, header.find("\r\n")).c_str());
+        return false;
+    }
+
+    uint8_t digest[20];
+    sha1(key + s_acceptGuid, digest);
+    const std::string expected = base64(digest, sizeof(digest));
+    size_t lineStart = header.find("\r\n");
+    while (lineStart != std::string::npos) {
+        lineStart += 2;
+        size_t lineEnd = header.find("\r\n", lineStart);
+        std::string line = header.substr(lineStart, lineEnd == std::string::npos ? std::string::npos : lineEnd - lineStart);
+        size_t colon = line.find(':');
+        if (colon != std::string::npos && colon == strlen("Sec-WebSocket-Accept") &&
+            strncasecmp(line.c_str(), "Sec-WebSocket-Accept", colon) == 0) {
+            size_t valueStart = line.find_first_not_of(" \t", colon + 1);
+            size_t valueEnd = line.find_last_not_of(" \t");
+            if (valueStart != std::string::npos && line.compare(valueStart, valueEnd + 1 - valueStart, expected) == 0)
+                return true;
+            break;
+        }
+        lineStart = lineEnd;
+    }
+    LOGERR("[EpollTransport::connect] Bad or missing Sec-WebSocket-Accept");
+    return false;
+}
+
+void EpollTransport::serviceConnection()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_sendMutex);
+        epoll_event ev{};
+        ev.events = m_writeArmed ? (EPOLLIN | EPOLLOUT) : EPOLLIN;
+        ev.data.fd = m_fd;
+        epoll_ctl(m_epollFd, EPOLL_CTL_MOD, m_fd, &ev);
+    }
+    // The server may have sent frames right behind its handshake response.
+    if (!m_inbox.empty() && !parseFrames(Clock::now()))
+        return;
+
+    const auto heartbeat = Heartbeat::interval();
+    Clock::time_point nextPing = heartbeat.count() ? Clock::now() + heartbeat : Clock::time_point::max();
+    Clock::time_point closeDeadline = Clock::time_point::max();
+    while (true) {
+        int timeout = -1;
+        if (closeDeadline != Clock::time_point::max()) {
+            timeout = remainingMs(closeDeadline);
+            if (timeout == 0) {
+                LOGTRACE("[EpollTransport::serviceConnection] No close reply within %d ms", CLOSE_HANDSHAKE_TIMEOUT_IN_MS);
+                return;
+            }
+        } else if (nextPing != Clock::time_point::max()) {
+            timeout = remainingMs(nextPing);
+            if (timeout == 0) {
+                std::string payload;
+                if (m_heartbeat.tick(payload)) {
+                    sendFrame(OP_PING, payload.data(), payload.size());
+                    nextPing = Clock::now() + heartbeat;
+                } else {
+                    LOGERR("[EpollTransport::serviceConnection] %s stalled, closing the connection", m_wsUrl.c_str());
+                    sendClose(CLOSE_GOING_AWAY);
+                    closeDeadline = Clock::now() + std::chrono::milliseconds(CLOSE_HANDSHAKE_TIMEOUT_IN_MS);
+                }
+                continue;
+            }
+        }
+        epoll_event ready[2];
+        int n = epoll_wait(m_epollFd, ready, 2, timeout);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            LOGERR("[EpollTransport::serviceConnection] %s", strerror(errno));
+            return;
+        }
+        for (int i = 0; i < n; i++) {
+            if (ready[i].data.fd == m_wakeFd) {
+                uint64_t wakes;
+                while (read(m_wakeFd, &wakes, sizeof(wakes)) > 0)
+                    ;
+                if (m_closeRequested.load() && !m_closeSent) {
+                    sendClose(CLOSE_NORMAL);
+                    closeDeadline = Clock::now() + std::chrono::milliseconds(CLOSE_HANDSHAKE_TIMEOUT_IN_MS);
+                }
+                continue;
+            }
+            if (ready[i].events & EPOLLOUT) {
+                std::lock_guard<std::mutex> lock(m_sendMutex);
+                flushLocked();
+            }
+            if ((ready[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) && !readFrames())
+                return;
+        }
+    }
+}
+
+void EpollTransport::closeSocket()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_sendMutex);
+        if (m_fd >= 0) {
+            epoll_ctl(m_epollFd, EPOLL_CTL_DEL, m_fd, nullptr);
+            close(m_fd);
+            m_fd = -1;
+        }
+        m_outbox.clear();
+        m_writeArmed = false;
+    }
+    m_inbox.clear();
+    m_message.clear();
+    m_messageOpcode = -1;
+    m_closeSent = false;
+}
+
+bool EpollTransport::readFrames()
+{
+    char buffer[READ_CHUNK_BYTES];
+    ssize_t n = ::recv(m_fd, buffer, sizeof(buffer), 0);
+    if (n == 0)
+        return false;
+    if (n < 0)
+        return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+    m_inbox.append(buffer, n);
+    return parseFrames(Clock::now());
+}
+
+bool EpollTransport::parseFrames(Clock::time_point arrival)
+{
+    size_t pos = 0;
+    bool open = true;
+    while (open) {
+        const size_t available = m_inbox.size() - pos;
+        const uint8_t *p = reinterpret_cast<const uint8_t *>(m_inbox.data()) + pos;
+        if (available < 2)
+            break;
+        if (p[0] & 0x70) {
+            open = protocolError("reserved bits set", CLOSE_PROTOCOL_ERROR);
+            break;
+        }
+        const bool fin = (p[0] & 0x80) != 0;
+        const uint8_t opcode = p[0] & 0x0F;
+        const bool masked = (p[1] & 0x80) != 0;
+        uint64_t length = p[1] & 0x7F;
+        size_t header = 2;
+        if (length == 126) {
+            if (available < 4)
+                break;
+            length = (uint64_t(p[2]) << 8) | p[3];
+            header = 4;
+        } else if (length == 127) {
+            if (available < 10)
+                break;
+            length = 0;
+            for (int i = 2; i < 10; i++)
+                length = (length << 8) | p[i];
+            header = 10;
+        }
+        if (length > MAX_MESSAGE_BYTES) {
+            open = protocolError("frame too big", CLOSE_TOO_BIG);
+            break;
+        }
+        const size_t maskOffset = header;
+        if (masked)
+            header += 4;
+        if (available < header + length)
+            break;
+
+        char *payload = &m_inbox[pos + header];
+        if (masked) {
+            const uint8_t *mask = p + maskOffset;
+            for (size_t i = 0; i < length; i++)
+                payload[i] ^= mask[i & 3];
+        }
+        pos += header + length;
+        open = onFrame(fin, opcode, payload, length, arrival);
+    }
+    m_inbox.erase(0, pos);
+    return open;
+}
+
+bool EpollTransport::onFrame(bool fin, uint8_t opcode, const char *payload, size_t size, Clock::time_point arrival)
+{
+    if (opcode >= OP_CLOSE && (!fin || size > 125))
+        return protocolError("bad control frame", CLOSE_PROTOCOL_ERROR);
+
+    switch (opcode) {
+    case OP_CONTINUATION:
+        if (m_messageOpcode < 0)
+            return protocolError("continuation without a message", CLOSE_PROTOCOL_ERROR);
+        if (m_message.size() + size > MAX_MESSAGE_BYTES)
+            return protocolError("message too big", CLOSE_TOO_BIG);
+        m_message.append(payload, size);
+        if (fin) {
+            m_messageOpcode = -1;
+            deliver(std::move(m_message), arrival);
+            m_message.clear();
+        }
+        return true;
+    case OP_TEXT:
+    case OP_BINARY:
+        if (m_messageOpcode >= 0)
+            return protocolError("new message inside a fragmented one", CLOSE_PROTOCOL_ERROR);
+        if (fin) {
+            deliver(std::string(payload, size), arrival);
+        } else {
+            m_message.assign(payload, size);
+            m_messageOpcode = opcode;
+        }
+        return true;
+    case OP_CLOSE:
+        // Echo the status code; the server closes the TCP connection after that.
+        if (!m_closeSent) {
+            sendFrame(OP_CLOSE, payload, size < 2 ? size : 2);
+            m_closeSent = true;
+            setState(ConnectionState::DISCONNECTING);
+        }
+        return false;
+    case OP_PING:
+        sendFrame(OP_PONG, payload, size);
+        return true;
+    case OP_PONG:
+        m_heartbeat.pong(std::string(payload, size));
+        return true;
+    default:
+        return protocolError("unknown opcode", CLOSE_PROTOCOL_ERROR);
+    }
+}
+
+bool EpollTransport::protocolError(const char *reason, uint16_t code)
+{
+    LOGERR("[EpollTransport] %s: %s, closing", m_wsUrl.c_str(), reason);
+    if (!m_closeSent)
+        sendClose(code);
+    return false;
+}
+
+void EpollTransport::deliver(std::string payload, Clock::time_point arrival)
+{
+    mp_framesIn->inc();
+    mp_bytesIn->inc(payload.size());
+    m_recorder.record(FrameDirection::INBOUND, payload);
+
+    Frame frame = makeFrame(std::move(payload));
+    if (mp_pool != nullptr && mp_pool->runsOnCaller())
+        mp_pool->ioService().post([this, frame, arrival] { processPayload(frame, arrival); });
+    else
+        processPayload(std::move(frame), arrival);
+}
+
+void EpollTransport::sendFrame(uint8_t opcode, const char *payload, size_t size)
+{
+    std::lock_guard<std::mutex> lock(m_sendMutex);
+    if (m_fd < 0)
+        return;
+
+    std::string &out = m_outbox;
+    out.push_back(static_cast<char>(0x80 | opcode));
+    if (size < 126) {
+        out.push_back(static_cast<char>(0x80 | size));
+    } else if (size <= 0xFFFF) {
+        out.push_back(static_cast<char>(0x80 | 126));
+        out.push_back(static_cast<char>(size >> 8));
+        out.push_back(static_cast<char>(size));
+    } else {
+        out.push_back(static_cast<char>(0x80 | 127));
+        for (int i = 7; i >= 0; i--)
+            out.push_back(static_cast<char>(uint64_t(size) >> (i * 8)));
+    }
+    // Client frames are always masked (RFC 6455 section 5.3).
+    uint8_t mask[4];
+    uint32_t key = m_random();
+    memcpy(mask, &key, sizeof(mask));
+    out.append(reinterpret_cast<const char *>(mask), sizeof(mask));
+    size_t start = out.size();
+    out.append(payload, size);
+    char *masked = &out[start];
+    for (size_t i = 0; i < size; i++)
+        masked[i] ^= mask[i & 3];
+
+    flushLocked();
+}
+
+void EpollTransport::sendClose(uint16_t code)
+{
+    const char status[2] = {static_cast<char>(code >> 8), static_cast<char>(code)};
+    sendFrame(OP_CLOSE, status, sizeof(status));
+    m_closeSent = true;
+    setState(ConnectionState::DISCONNECTING);
+}
+
+void EpollTransport::flushLocked()
+{
+    size_t written = 0;
+    while (written < m_outbox.size()) {
+        ssize_t n = ::send(m_fd, m_outbox.data() + written, m_outbox.size() - written, MSG_NOSIGNAL);
+        if (n > 0) {
+            written += n;
+        } else if (n < 0 && errno == EINTR) {
+            continue;
+        } else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            break;
+        } else {
+            // The connection is gone; the loop finds out on its next read.
+            written = m_outbox.size();
+        }
+    }
+    m_outbox.erase(0, written);
+
+    bool wantWrite = !m_outbox.empty();
+    if (wantWrite != m_writeArmed) {
+        epoll_event ev{};
+        ev.events = wantWrite ? (EPOLLIN | EPOLLOUT) : EPOLLIN;
+        ev.data.fd = m_fd;
+        epoll_ctl(m_epollFd, EPOLL_CTL_MOD, m_fd, &ev);
+        m_writeArmed = wantWrite;
+    }
+}
+
+int EpollTransport::sendMessage(const std::string &message)
+{
+    if (tdebug)
+        LOGTRACE("[EpollTransport::sendMessage] Sending %s", message.c_str());
+
+    if (m_connectionState.load() != ConnectionState::CONNECTED)
+        return -1;
+    m_recorder.record(FrameDirection::OUTBOUND, message);
+    sendFrame(OP_TEXT, message.data(), message.size());
+    mp_framesOut->inc();
+    mp_bytesOut->inc(message.size());
+    return 1;
+}
+
+void EpollTransport::disconnect()
+{
+    m_closeRequested.store(true);
+    uint64_t one = 1;
+    if (write(m_wakeFd, &one, sizeof(one)) < 0 && tdebug)
+        LOGTRACE("[EpollTransport::disconnect] %s", strerror(errno));
+}
+
+bool EpollTransport::waitForConnection(std::chrono::milliseconds timeout)
+{
+    std::unique_lock<std::mutex> lock(m_stateMutex);
+
+    return m_stateChanged.wait_for(lock, timeout, [this]() {
+        ConnectionState state = m_connectionState.load();
+        return state == ConnectionState::CONNECTED || state == ConnectionState::ERROR_STATE;
+    });
+}
@@ -0,0 +1,214 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2022 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_MODULE LOG_MODULE_TRANSPORT
+
+#include "FrameRecorder.h"
+#include "EventUtils.h"
+
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+
+namespace {
+
+const char CAPTURE_MAGIC[8] = {'X', 'D', 'C', 'A', 'P', '0', '0', '1'};
+
+struct RecordHeader {
+    uint32_t length;     // payload bytes, written last; 0 means "no record here"
+    uint32_t direction;
+    uint64_t timestampNs;
+};
+
+constexpr size_t HEADER_SIZE = sizeof(RecordHeader);
+
+size_t recordSize(size_t payloadSize)
+{
+    return (HEADER_SIZE + payloadSize + 7) & ~static_cast<size_t>(7);
+}
+
+uint64_t monotonicNs()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+} // namespace
+
+FrameRecorder::FrameRecorder()
+    : m_fd(-1), mp_base(nullptr), m_capacity(0), m_offset(0), m_writers(0), m_open(false), m_dropped(0)
+{
+}
+
+FrameRecorder::~FrameRecorder()
+{
+    close();
+}
+
+bool FrameRecorder::open(const std::string &path, size_t maxBytes)
+{
+    if (mp_base != nullptr)
+        return false;
+    if (maxBytes < sizeof(CAPTURE_MAGIC) + HEADER_SIZE) {
+        LOGERR("Capture size %zu is too small", maxBytes);
+        return false;
+    }
+
+    m_fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (m_fd < 0) {
+        LOGERR("Unable to create capture file %s: %s", path.c_str(), strerror(errno));
+        return false;
+    }
+    if (ftruncate(m_fd, static_cast<off_t>(maxBytes)) != 0) {
+        LOGERR("Unable to size capture file %s: %s", path.c_str(), strerror(errno));
+        ::close(m_fd);
+        m_fd = -1;
+        return false;
+    }
+    void *base = mmap(nullptr, maxBytes, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, 0);
+    if (base == MAP_FAILED) {
+        LOGERR("Unable to map capture file %s: %s", path.c_str(), strerror(errno));
+        ::close(m_fd);
+        m_fd = -1;
+        return false;
+    }
+
+    mp_base = static_cast<char *>(base);
+    memcpy(mp_base, CAPTURE_MAGIC, sizeof(CAPTURE_MAGIC));
+    m_capacity = maxBytes;
+    m_offset.store(sizeof(CAPTURE_MAGIC));
+    m_dropped.store(0);
+    m_path = path;
+    m_open.store(true);
+    LOGINFO("Capturing Thunder traffic to %s (max %zu bytes)", path.c_str(), maxBytes);
+    return true;
+}
+
+void FrameRecorder::close()
+{
+    if (mp_base == nullptr)
+        return;
+
+    m_open.store(false);
+    while (m_writers.load() != 0)
+        std::this_thread::yield();
+
+    size_t used = m_offset.load();
+    munmap(mp_base, m_capacity);
+    mp_base = nullptr;
+    if (ftruncate(m_fd, static_cast<off_t>(used)) != 0)
+        LOGWARN("Unable to trim capture file %s: %s", m_path.c_str(), strerror(errno));
+    ::close(m_fd);
+    m_fd = -1;
+    LOGINFO("Capture %s closed: %zu bytes, %llu frames dropped", m_path.c_str(), used,
+            static_cast<unsigned long long>(m_dropped.load()));
+}
+
+void FrameRecorder::record(FrameDirection direction, const std::string &payload)
+{
+    if (!m_open.load(std::memory_order_relaxed) || payload.empty())
+        return;
+
+    uint64_t timestamp = monotonicNs();
+    m_writers.fetch_add(1);
+    if (!m_open.load()) {
+        m_writers.fetch_sub(1);
+        return;
+    }
+
+    size_t size = recordSize(payload.size());
+    size_t offset = m_offset.load(std::memory_order_relaxed);
+    do {
+        if (offset + size > m_capacity) {
+            m_dropped.fetch_add(1, std::memory_order_relaxed);
+            m_writers.fetch_sub(1, std::memory_order_release);
+            return;
+        }
+    } while (!m_offset.compare_exchange_weak(offset, offset + size, std::memory_order_relaxed));
+
+    RecordHeader *header = reinterpret_cast<RecordHeader *>(mp_base + offset);
+    header->direction = static_cast<uint32_t>(direction);
+    header->timestampNs = timestamp;
+    memcpy(mp_base + offset + HEADER_SIZE, payload.data(), payload.size());
+    // Publishing the length last means a reader never sees a half written record.
+    __atomic_store_n(&header->length, static_cast<uint32_t>(payload.size()), __ATOMIC_RELEASE);
+
+    m_writers.fetch_sub(1, std::memory_order_release);
+}
+
+FrameReader::FrameReader() : m_fd(-1), mp_base(nullptr), m_size(0), m_offset(0)
+{
+}
+
+FrameReader::~FrameReader()
+{
+    if (mp_base != nullptr)
+        munmap(const_cast<char *>(mp_base), m_size);
+    if (m_fd >= 0)
+        ::close(m_fd);
+}
+
+bool FrameReader::open(const std::string &path)
+{
+    m_fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (m_fd < 0) {
+        LOGERR("Unable to open capture file %s: %s", path.c_str(), strerror(errno));
+        return false;
+    }
+    struct stat st;
+    if (fstat(m_fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(CAPTURE_MAGIC)) {
+        LOGERR("%s is not a capture file", path.c_str());
+        return false;
+    }
+    m_size = static_cast<size_t>(st.st_size);
+    void *base = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, m_fd, 0);
+    if (base == MAP_FAILED) {
+        LOGERR("Unable to map capture file %s: %s", path.c_str(), strerror(errno));
+        return false;
+    }
+    mp_base = static_cast<const char *>(base);
+    if (memcmp(mp_base, CAPTURE_MAGIC, sizeof(CAPTURE_MAGIC)) != 0) {
+        LOGERR("%s is not a capture file", path.c_str());
+        return false;
+    }
+    m_offset = sizeof(CAPTURE_MAGIC);
+    return true;
+}
+
+bool FrameReader::next(CapturedFrame &frame)
+{
+    if (mp_base == nullptr || m_offset + HEADER_SIZE > m_size)
+        return false;
+
+    RecordHeader header;
+    memcpy(&header, mp_base + m_offset, HEADER_SIZE);
+    if (header.length == 0 || m_offset + recordSize(header.length) > m_size)
+        return false;
+
+    frame.direction = static_cast<FrameDirection>(header.direction);
+    frame.timestampNs = header.timestampNs;
+    frame.payload.assign(mp_base + m_offset + HEADER_SIZE, header.length);
+    m_offset += recordSize(header.length);
+    return true;
+}
@@ -0,0 +1,85 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2022 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_MODULE LOG_MODULE_TRANSPORT
+
+#include "Heartbeat.h"
+#include "EventUtils.h"
+
+#include <atomic>
+
+static std::atomic<unsigned> s_intervalMs{2000};
+static std::atomic<unsigned> s_maxMissed{3};
+
+void setHeartbeat(unsigned intervalMs, unsigned maxMissed)
+{
+    s_intervalMs.store(intervalMs, std::memory_order_relaxed);
+    s_maxMissed.store(maxMissed > 0 ? maxMissed : 1, std::memory_order_relaxed);
+}
+
+Heartbeat::Heartbeat(const std::string &labels) : m_sequence(0), m_outstanding(false), m_missed(0)
+{
+    MetricsRegistry *metrics = MetricsRegistry::getInstance();
+    mp_rtt = metrics->histogram("thunder_ping_rtt_us", labels);
+    mp_missedPongs = metrics->counter("thunder_ping_missed_total", labels);
+    mp_stalls = metrics->counter("thunder_connection_stalls_total", labels);
+}
+
+std::chrono::milliseconds Heartbeat::interval()
+{
+    return std::chrono::milliseconds(s_intervalMs.load(std::memory_order_relaxed));
+}
+
+void Heartbeat::reset()
+{
+    std::lock_guard<std::mutex> lock(m_lock);
+    m_outstanding = false;
+    m_missed = 0;
+}
+
+bool Heartbeat::tick(std::string &payload)
+{
+    std::lock_guard<std::mutex> lock(m_lock);
+    if (m_outstanding) {
+        m_missed++;
+        mp_missedPongs->inc();
+        LOGWARN("No pong from Thunder for %u ping(s)", m_missed);
+        if (m_missed >= s_maxMissed.load(std::memory_order_relaxed)) {
+            mp_stalls->inc();
+            m_outstanding = false;
+            m_missed = 0;
+            return false;
+        }
+    }
+    payload = std::to_string(++m_sequence);
+    m_outstanding = true;
+    m_sentAt = std::chrono::steady_clock::now();
+    return true;
+}
+
+void Heartbeat::pong(const std::string &payload)
+{
+    std::lock_guard<std::mutex> lock(m_lock);
+    // Even a late pong shows Thunder still services the socket.
+    m_missed = 0;
+    if (m_outstanding && payload == std::to_string(m_sequence)) {
+        mp_rtt->observeSince(m_sentAt);
+        m_outstanding = false;
+    }
+}
@@ -0,0 +1,61 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2022 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_MODULE LOG_MODULE_TRANSPORT
+
+#include "IoServicePool.h"
+#include "EventUtils.h"
+
+IoServicePool::IoServicePool(size_t threads)
+    : mp_work(new boost::asio::io_service::work(m_ioService)), m_runsOnCaller(threads == 0)
+{
+    for (size_t i = 0; i < threads; i++) {
+        m_threads.emplace_back([this] {
+            // A handler that throws must not take the whole pool down with it.
+            for (;;) {
+                try {
+                    m_ioService.run();
+                    break;
+                } catch (const std::exception &e) {
+                    LOGERR("[IoServicePool] handler threw: %s", e.what());
+                }
+            }
+        });
+    }
+    if (m_runsOnCaller)
+        LOGINFO("io service runs on the owning thread");
+    else
+        LOGINFO("Started %zu shared io threads", threads);
+}
+
+IoServicePool::~IoServicePool()
+{
+    stop();
+}
+
+void IoServicePool::stop()
+{
+    mp_work.reset();
+    m_ioService.stop();
+    for (auto &thread : m_threads) {
+        if (thread.joinable())
+            thread.join();
+    }
+    m_threads.clear();
+}
@@ -0,0 +1,502 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2022 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cstdlib>
+#include <limits>
+#include <new>
+#include "JsonDocument.h"
+
+static const JsonText EMPTY_TEXT = {"", 0};
+
+static inline void skipSpace(const char *&p, const char *end)
+{
+    while (p < end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r'))
+        ++p;
+}
+
+static inline bool isDigit(char c)
+{
+    return c >= '0' && c <= '9';
+}
+
+static int hexValue(char c)
+{
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+static bool readHex4(const char *p, const char *end, unsigned &cp)
+{
+    if (end - p < 4)
+        return false;
+    cp = 0;
+    for (int i = 0; i < 4; i++) {
+        int v = hexValue(p[i]);
+        if (v < 0)
+            return false;
+        cp = (cp << 4) | static_cast<unsigned>(v);
+    }
+    return true;
+}
+
+static char *encodeUtf8(unsigned cp, char *out)
+{
+    if (cp < 0x80) {
+        *out++ = static_cast<char>(cp);
+    } else if (cp < 0x800) {
+        *out++ = static_cast<char>(0xC0 | (cp >> 6));
+        *out++ = static_cast<char>(0x80 | (cp & 0x3F));
+    } else if (cp < 0x10000) {
+        *out++ = static_cast<char>(0xE0 | (cp >> 12));
+        *out++ = static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+        *out++ = static_cast<char>(0x80 | (cp & 0x3F));
+    } else {
+        *out++ = static_cast<char>(0xF0 | (cp >> 18));
+        *out++ = static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+        *out++ = static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+        *out++ = static_cast<char>(0x80 | (cp & 0x3F));
+    }
+    return out;
+}
+
+/// JsonValue
+
+bool JsonValue::isMember(const char *key) const
+{
+    if (!isObject())
+        return false;
+    for (const JsonNode *n = mp_node->child; n; n = n->next)
+        if (n->key == key)
+            return true;
+    return false;
+}
+
+JsonValue JsonValue::operator[](const char *key) const
+{
+    const JsonNode *found = nullptr;
+    if (isObject()) {
+        const size_t len = std::strlen(key);
+        for (const JsonNode *n = mp_node->child; n; n = n->next)
+            if (n->key.size == len && std::memcmp(n->key.data, key, len) == 0)
+                found = n;
+    }
+    return JsonValue(found);
+}
+
+JsonValue JsonValue::at(size_t index) const
+{
+    if (!isArray())
+        return JsonValue();
+    const JsonNode *n = mp_node->child;
+    while (n && index--)
+        n = n->next;
+    return JsonValue(n);
+}
+
+bool JsonValue::asBool() const
+{
+    switch (type()) {
+    case JsonType::BOOL:   return mp_node->boolean;
+    case JsonType::INT:    return mp_node->integer != 0;
+    case JsonType::DOUBLE: return mp_node->real != 0.0;
+    default:               return false;
+    }
+}
+
+int64_t JsonValue::asInt64() const
+{
+    switch (type()) {
+    case JsonType::BOOL:   return mp_node->boolean ? 1 : 0;
+    case JsonType::INT:    return mp_node->integer;
+    case JsonType::DOUBLE: return static_cast<int64_t>(mp_node->real);
+    default:               return 0;
+    }
+}
+
+int JsonValue::asInt() const
+{
+    return static_cast<int>(asInt64());
+}
+
+double JsonValue::asDouble() const
+{
+    switch (type()) {
+    case JsonType::BOOL:   return mp_node->boolean ? 1.0 : 0.0;
+    case JsonType::INT:    return static_cast<double>(mp_node->integer);
+    case JsonType::DOUBLE: return mp_node->real;
+    default:               return 0.0;
+    }
+}
+
+JsonText JsonValue::text() const
+{
+    return mp_node ? mp_node->text : EMPTY_TEXT;
+}
+
+std::string JsonValue::asString() const
+{
+    switch (type()) {
+    case JsonType::BOOL:
+    case JsonType::INT:
+    case JsonType::DOUBLE:
+    case JsonType::STRING:
+        return mp_node->text.str();
+    default:
+        return std::string();
+    }
+}
+
+std::string JsonValue::raw() const
+{
+    return mp_node ? mp_node->source.str() : std::string();
+}
+
+/// JsonDocument
+
+JsonDocument::JsonDocument()
+    : mp_cursor(m_inline), mp_limit(m_inline + INLINE_BYTES), mp_chunks(nullptr), m_arenaBytes(0),
+      mp_root(nullptr), mp_begin(nullptr), mp_end(nullptr), mp_error(nullptr), m_errorOffset(0)
+{
+}
+
+JsonDocument::~JsonDocument()
+{
+    release();
+}
+
+void JsonDocument::release()
+{
+    while (mp_chunks) {
+        Chunk *next = mp_chunks->next;
+        ::operator delete(mp_chunks);
+        mp_chunks = next;
+    }
+    mp_cursor = m_inline;
+    mp_limit = m_inline + INLINE_BYTES;
+    m_arenaBytes = 0;
+}
+
+void *JsonDocument::allocate(size_t bytes)
+{
+    constexpr size_t align = alignof(JsonNode);
+    bytes = (bytes + align - 1) & ~(align - 1);
+    if (static_cast<size_t>(mp_limit - mp_cursor) < bytes) {
+        // Monotonic: the rest of the current block is abandoned, nothing is freed before the
+        // document is reparsed or destroyed.
+        constexpr size_t header = (sizeof(Chunk) + align - 1) & ~(align - 1);
+        size_t size = header + bytes;
+        if (size < MIN_CHUNK_BYTES)
+            size = MIN_CHUNK_BYTES;
+        Chunk *chunk = static_cast<Chunk *>(::operator new(size));
+        chunk->next = mp_chunks;
+        mp_chunks = chunk;
+        mp_cursor = reinterpret_cast<char *>(chunk) + header;
+        mp_limit = reinterpret_cast<char *>(chunk) + size;
+    }
+    void *p = mp_cursor;
+    mp_cursor += bytes;
+    m_arenaBytes += bytes;
+    return p;
+}
+
+JsonNode *JsonDocument::newNode(JsonType type)
+{
+    JsonNode *node = static_cast<JsonNode *>(allocate(sizeof(JsonNode)));
+    node->type = type;
+    node->boolean = false;
+    node->count = 0;
+    node->integer = 0;
+    node->text = EMPTY_TEXT;
+    node->source = EMPTY_TEXT;
+    node->key = EMPTY_TEXT;
+    node->child = nullptr;
+    node->next = nullptr;
+    return node;
+}
+
+bool JsonDocument::fail(const char *error, const char *at)
+{
+    mp_error = error;
+    m_errorOffset = static_cast<size_t>(at - mp_begin);
+    return false;
+}
+
+bool JsonDocument::parse(const char *data, size_t size)
+{
+    release();
+    mp_root = nullptr;
+    mp_error = nullptr;
+    m_errorOffset = 0;
+    mp_begin = data;
+    mp_end = data + size;
+
+    const char *p = data;
+    skipSpace(p, mp_end);
+    if (p == mp_end)
+        return fail("empty document", p);
+
+    JsonNode *root = nullptr;
+    if (!parseValue(p, root, 0))
+        return false;
+    // Like jsoncpp's default reader, anything after the root value is ignored.
+    mp_root = root;
+    return true;
+}
+
+bool JsonDocument::parseValue(const char *&p, JsonNode *&node, int depth)
+{
+    const char *start = p;
+    switch (*p) {
+    case '{':
+    case '[':
+        if (depth >= MAX_DEPTH)
+            return fail("nesting too deep", p);
+        node = newNode(*p == '{' ? JsonType::OBJECT : JsonType::ARRAY);
+        if (!parseContainer(p, node, depth))
+            return false;
+        break;
+    case '"':
+        node = newNode(JsonType::STRING);
+        if (!parseString(p, node->text))
+            return false;
+        break;
+    case 't':
+        if (mp_end - p < 4 || std::memcmp(p, "true", 4) != 0)
+            return fail("invalid literal", p);
+        node = newNode(JsonType::BOOL);
+        node->boolean = true;
+        p += 4;
+        break;
+    case 'f':
+        if (mp_end - p < 5 || std::memcmp(p, "false", 5) != 0)
+            return fail("invalid literal", p);
+        node = newNode(JsonType::BOOL);
+        p += 5;
+        break;
+    case 'n':
+        if (mp_end - p < 4 || std::memcmp(p, "null", 4) != 0)
+            return fail("invalid literal", p);
+        node = newNode(JsonType::NULLVALUE);
+        p += 4;
+        break;
+    default:
+        if (*p != '-' && !isDigit(*p))
+            return fail("unexpected character", p);
+        node = newNode(JsonType::INT);
+        if (!parseNumber(p, node))
+            return false;
+        break;
+    }
+    node->source = JsonText{start, static_cast<size_t>(p - start)};
+    if (node->type != JsonType::STRING)
+        node->text = node->source;
+    return true;
+}
+
+bool JsonDocument::parseString(const char *&p, JsonText &out)
+{
+    const char *start = ++p;
+    while (p < mp_end && *p != '"' && *p != '\\')
+        ++p;
+    if (p == mp_end)
+        return fail("unterminated string", start - 1);
+    if (*p == '"') {
+        out = JsonText{start, static_cast<size_t>(p - start)};
+        ++p;
+        return true;
+    }
+
+    // Escaped: find the closing quote first, the decoded string is never longer than its source.
+    const char *close = p;
+    while (close < mp_end && *close != '"')
+        close += (*close == '\\') ? 2 : 1;
+    if (close >= mp_end)
+        return fail("unterminated string", start - 1);
+
+    char *buf = static_cast<char *>(allocate(static_cast<size_t>(close - start)));
+    char *dst = buf;
+    std::memcpy(dst, start, static_cast<size_t>(p - start));
+    dst += p - start;
+
+    while (p < close) {
+        if (*p != '\\') {
+            *dst++ = *p++;
+            continue;
+        }
+        ++p;
+        switch (*p++) {
+        case '"':  *dst++ = '"'; break;
+        case '\\': *dst++ = '\\'; break;
+        case '/':  *dst++ = '/'; break;
+        case 'b':  *dst++ = '\b'; break;
+        case 'f':  *dst++ = '\f'; break;
+        case 'n':  *dst++ = '\n'; break;
+        case 'r':  *dst++ = '\r'; break;
+        case 't':  *dst++ = '\t'; break;
+        case 'u': {
+            unsigned cp;
+            if (!readHex4(p, close, cp))
+                return fail("invalid unicode escape", p - 2);
+            p += 4;
+            if (cp >= 0xD800 && cp <= 0xDBFF) {
+                unsigned low;
+                if (close - p >= 6 && p[0] == '\\' && p[1] == 'u' && readHex4(p + 2, close, low) &&
+                    low >= 0xDC00 && low <= 0xDFFF) {
+                    cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+                    p += 6;
+                } else {
+                    cp = 0xFFFD;
+                }
+            } else if (cp >= 0xDC00 && cp <= 0xDFFF) {
+                cp = 0xFFFD;
+            }
+            dst = encodeUtf8(cp, dst);
+            break;
+        }
+        default:
+            return fail("invalid escape", p - 2);
+        }
+    }
+    out = JsonText{buf, static_cast<size_t>(dst - buf)};
+    p = close + 1;
+    return true;
+}
+
+bool JsonDocument::parseNumber(const char *&p, JsonNode *node)
+{
+    const char *start = p;
+    const bool negative = (*p == '-');
+    if (negative)
+        ++p;
+    if (p == mp_end || !isDigit(*p))
+        return fail("invalid number", start);
+
+    // Integral part, accumulated while it still fits an int64_t.
+    const uint64_t limit = negative ? uint64_t(std::numeric_limits<int64_t>::max()) + 1
+                                    : uint64_t(std::numeric_limits<int64_t>::max());
+    uint64_t magnitude = 0;
+    bool integral = true;
+    if (*p == '0') {
+        ++p;
+    } else {
+        while (p < mp_end && isDigit(*p)) {
+            const uint64_t digit = static_cast<uint64_t>(*p - '0');
+            if (magnitude > (limit - digit) / 10)
+                integral = false;
+            else
+                magnitude = magnitude * 10 + digit;
+            ++p;
+        }
+    }
+    if (p < mp_end && *p == '.') {
+        integral = false;
+        ++p;
+        if (p == mp_end || !isDigit(*p))
+            return fail("invalid number", start);
+        while (p < mp_end && isDigit(*p))
+            ++p;
+    }
+    if (p < mp_end && (*p == 'e' || *p == 'E')) {
+        integral = false;
+        ++p;
+        if (p < mp_end && (*p == '+' || *p == '-'))
+            ++p;
+        if (p == mp_end || !isDigit(*p))
+            return fail("invalid number", start);
+        while (p < mp_end && isDigit(*p))
+            ++p;
+    }
+
+    if (integral) {
+        node->type = JsonType::INT;
+        node->integer = negative ? static_cast<int64_t>(0 - magnitude) : static_cast<int64_t>(magnitude);
+        return true;
+    }
+
+    // The frame is not NUL terminated, strtod needs a terminated copy.
+    const size_t len = static_cast<size_t>(p - start);
+    char local[64];
+    std::string spill;
+    const char *digits = local;
+    if (len < sizeof(local)) {
+        std::memcpy(local, start, len);
+        local[len] = '\0';
+    } else {
+        spill.assign(start, len);
+        digits = spill.c_str();
+    }
+    node->type = JsonType::DOUBLE;
+    node->real = std::strtod(digits, nullptr);
+    return true;
+}
+
+bool JsonDocument::parseContainer(const char *&p, JsonNode *node, int depth)
+{
+    const bool object = (node->type == JsonType::OBJECT);
+    const char close = object ? '}' : ']';
+
+    ++p;
+    skipSpace(p, mp_end);
+    if (p < mp_end && *p == close) {
+        ++p;
+        return true;
+    }
+
+    JsonNode **tail = &node->child;
+    for (;;) {
+        JsonText key = EMPTY_TEXT;
+        if (object) {
+            if (p == mp_end || *p != '"')
+                return fail("expected member name", p);
+            if (!parseString(p, key))
+                return false;
+            skipSpace(p, mp_end);
+            if (p == mp_end || *p != ':')
+                return fail("expected ':'", p);
+            ++p;
+            skipSpace(p, mp_end);
+        }
+        if (p == mp_end)
+            return fail("unexpected end of document", p);
+
+        JsonNode *child = nullptr;
+        if (!parseValue(p, child, depth + 1))
+            return false;
+        child->key = key;
+        *tail = child;
+        tail = &child->next;
+        node->count++;
+
+        skipSpace(p, mp_end);
+        if (p == mp_end)
+            return fail(object ? "unterminated object" : "unterminated array", p);
+        if (*p == ',') {
+            ++p;
+            skipSpace(p, mp_end);
+            continue;
+        }
+        if (*p == close) {
+            ++p;
+            return true;
+        }
+        return fail(object ? "expected ',' or '}'" : "expected ',' or ']'", p);
+    }
+}
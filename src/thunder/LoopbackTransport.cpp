@@ -0,0 +1,66 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2022 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_MODULE LOG_MODULE_TRANSPORT
+
+#include "LoopbackTransport.h"
+#include "EventUtils.h"
+
+void LoopbackTransport::connect()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_stateMutex);
+        m_connectionState.store(ConnectionState::CONNECTED);
+    }
+    if (nullptr != m_conHandler)
+        m_conHandler(true);
+
+    // Like TransportHandler::connect(), stay on the connect thread until disconnected.
+    std::unique_lock<std::mutex> lock(m_stateMutex);
+    m_stateChanged.wait(lock, [this] { return m_connectionState.load() != ConnectionState::CONNECTED; });
+    m_connectionState.store(ConnectionState::DISCONNECTED);
+    LOGTRACE("[LoopbackTransport::connect] Connection closed");
+}
+
+int LoopbackTransport::sendMessage(const std::string &message)
+{
+    if (m_connectionState.load() != ConnectionState::CONNECTED)
+        return -1;
+    m_recorder.record(FrameDirection::OUTBOUND, message);
+    if (nullptr != m_peer)
+        m_peer(message);
+    return 1;
+}
+
+void LoopbackTransport::deliver(std::string frame)
+{
+    auto arrival = std::chrono::steady_clock::now();
+    m_recorder.record(FrameDirection::INBOUND, frame);
+    processPayload(makeFrame(std::move(frame)), arrival);
+}
+
+void LoopbackTransport::disconnect()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_stateMutex);
+        if (m_connectionState.load() == ConnectionState::CONNECTED)
+            m_connectionState.store(ConnectionState::DISCONNECTING);
+    }
+    m_stateChanged.notify_all();
+}
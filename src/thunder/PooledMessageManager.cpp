@@ -0,0 +1,53 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2022 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "PooledMessageManager.h"
+
+MessagePoolStats *MessagePoolStats::mcp_INSTANCE{nullptr};
+
+MessagePoolStats::MessagePoolStats()
+{
+    MetricsRegistry *metrics = MetricsRegistry::getInstance();
+    mp_hits = metrics->counter("ws_msg_pool_hits_total");
+    mp_misses = metrics->counter("ws_msg_pool_misses_total");
+    mp_hitPercent = metrics->gauge("ws_msg_pool_hit_percent");
+    mp_outstanding = metrics->gauge("ws_msg_pool_outstanding");
+}
+
+MessagePoolStats *MessagePoolStats::getInstance()
+{
+    if (MessagePoolStats::mcp_INSTANCE == nullptr)
+    {
+        MessagePoolStats::mcp_INSTANCE = new MessagePoolStats();
+    }
+    return MessagePoolStats::mcp_INSTANCE;
+}
+
+void MessagePoolStats::acquired(bool hit)
+{
+    (hit ? mp_hits : mp_misses)->inc();
+    mp_outstanding->add();
+    uint64_t hits = mp_hits->value();
+    mp_hitPercent->set(static_cast<int64_t>(hits * 100 / (hits + mp_misses->value())));
+}
+
+void MessagePoolStats::released()
+{
+    mp_outstanding->sub();
+}
@@ -16,28 +16,26 @@
  * See the License for the specific language governing permissions and
  * limitations under the License.
  */
+#define LOG_MODULE LOG_MODULE_PROTOCOL
+
+#include <atomic>
 #include <memory>
 #include <sstream>
 #include "json/json.h"
 
 #include "ProtocolHandler.h"
+#include "JsonDocument.h"
 #include "EventUtils.h"
 
-// Forward declaration for ThunderInterface
-class ThunderInterface;
-
-// External reference to get app configurations from ThunderInterface
-extern std::vector<AppConfig> g_appConfigList;
-
-static int event_id = 1001;
+// Request and subscription ids are unique across every session in the process.
+static std::atomic<int> event_id{1001};
 string getSubscribtionRequest(const string &callsign, const string &event, bool subscribe, int &id, int eventId = -1);
 
 void addVersion(Json::Value &root, int &id)
 {
     root["jsonrpc"] = "2.0";
-    id = event_id;
+    id = event_id.fetch_add(1, std::memory_order_relaxed);
     root["id"] = std::to_string(id);
-    event_id++;
 }
 
 string getStringFromJson(Json::Value &root)
@@ -181,8 +179,7 @@ string getSubscribtionRequest(const string &callsign, const string &event, bool
     params["event"] = event;
     if (eventId == -1)
     {
-        params["id"] = std::to_string(event_id);
-        event_id++;
+        params["id"] = std::to_string(event_id.fetch_add(1, std::memory_order_relaxed));
     }
     else
         params["id"] = std::to_string(eventId);
@@ -262,26 +259,57 @@ bool getParamObjectFromJsonString(const std::string &input, Json::Value &jObjOut
 	return true;
 }
 
-bool getResultObject(const string &jsonMsg, Json::Value &result)
+// Replies and notifications from Thunder are only read, so they go through the arena reader
+// rather than building a Json::Value tree per frame.
+static bool parseFrame(const string &jsonMsg, JsonDocument &doc)
 {
-    Json::Value root;
-    if (!parseJson(jsonMsg, root))
+    if (jsonMsg.empty()) {
+        LOGERR("Cannot parse empty JSON message");
+        return false;
+    }
+    if (!doc.parse(jsonMsg)) {
+        LOGERR("Failed to parse the json message: %s, error: %s at offset %zu",
+               jsonMsg.c_str(), doc.error(), doc.errorOffset());
+        return false;
+    }
+    return true;
+}
+
+bool getParamObjectFromJsonString(const std::string &input, JsonDocument &doc, JsonValue &params)
+{
+	if (!doc.parse(input)) {
+		LOGERR("Failed to parse JSON string: %s, error: %s at offset %zu", input.c_str(), doc.error(), doc.errorOffset());
+		return false;
+	}
+
+	params = doc.root()["params"];
+	if (!params.isObject()) {
+		LOGERR("No params object found in JSON: %s", input.c_str());
+		return false;
+	}
+	return true;
+}
+
+static bool getResultObject(const string &jsonMsg, JsonDocument &doc, JsonValue &result)
+{
+    if (!parseFrame(jsonMsg, doc))
         return false;
-    result = root["result"];
+    result = doc.root()["result"];
     return result.isObject();
 }
 
 bool convertResultStringToArray(const string &jsonMsg, const string key, std::vector<string> &arr)
 {
-    Json::Value result;
+    JsonDocument doc;
+    JsonValue result;
     bool status = false;
-    if (!getResultObject(jsonMsg, result))
+    if (!getResultObject(jsonMsg, doc, result))
         return status;
 
-    Json::Value clients = result[key];
+    JsonValue clients = result[key];
     if (clients.isArray())
     {
-        for (auto &x : clients)
+        for (JsonValue x : clients)
         {
             arr.emplace_back(x.asString());
         }
@@ -296,13 +324,14 @@ bool convertResultStringToArray(const string &jsonMsg, const string key, std::ve
 */
 bool convertResultStringToBool(const string &jsonMsg, bool &response)
 {
-    Json::Value result;
+    JsonDocument doc;
+    JsonValue result;
     bool status = false;
 
-    if (!getResultObject(jsonMsg, result))
+    if (!getResultObject(jsonMsg, doc, result))
         return status;
 
-    Json::Value bstat = result["status"];
+    JsonValue bstat = result["status"];
 
     if (bstat.isBool())
     {
@@ -312,29 +341,34 @@ bool convertResultStringToBool(const string &jsonMsg, bool &response)
     return status;
 }
 
-bool checkForThunderErrorResponse(const string &jsonMsg)
+static bool logThunderError(const JsonValue &root)
 {
 	// {"jsonrpc":"2.0","id":4,"error":{"code":-32601,"message":"Method not found"}}
-	Json::Value root;
-	if (!parseJson(jsonMsg, root))
-		return false;
-
-	if (root.isMember("error") && root["error"].isObject()) {
-		Json::Value error = root["error"];
-		string errorString = getStringFromJson(error);
-		LOGERR("Thunder JSON-RPC Error: %s", errorString.c_str());
+	JsonValue error = root["error"];
+	if (error.isObject()) {
+		LOGERR("Thunder JSON-RPC Error: %s", error.raw().c_str());
 		return true;
 	}
 	return false;
 }
 
+bool checkForThunderErrorResponse(const string &jsonMsg)
+{
+	JsonDocument doc;
+	if (!parseFrame(jsonMsg, doc))
+		return false;
+
+	return logThunderError(doc.root());
+}
+
 // {"jsonrpc":"2.0","id":1044,"result":null}
 bool isJsonRpcResultNull(const string &jsonMsg)
 {
-	Json::Value root;
-	if (!parseJson(jsonMsg, root))
+	JsonDocument doc;
+	if (!parseFrame(jsonMsg, doc))
 		return false;
 
+	JsonValue root = doc.root();
 	if (root.isMember("result") && root["result"].isNull())
 		return true;
 
@@ -343,13 +377,14 @@ bool isJsonRpcResultNull(const string &jsonMsg)
 
 bool convertResultStringToBool(const string &jsonMsg, const string &key, bool &response)
 {
-	Json::Value result;
+	JsonDocument doc;
+	JsonValue result;
 	bool status = false;
 
-	if (!getResultObject(jsonMsg, result))
+	if (!getResultObject(jsonMsg, doc, result))
 		return status;
 
-	Json::Value bstat = result[key];
+	JsonValue bstat = result[key];
 
 	if (bstat.isBool())
 	{
@@ -359,16 +394,32 @@ bool convertResultStringToBool(const string &jsonMsg, const string &key, bool &r
 	return status;
 }
 
+bool convertResultStringToInt64(const string &jsonMsg, const string &key, int64_t &value)
+{
+	JsonDocument doc;
+	JsonValue result;
+
+	if (!getResultObject(jsonMsg, doc, result))
+		return false;
+
+	JsonValue number = result[key];
+	if (!number.isNumber())
+		return false;
+	value = number.asInt64();
+	return true;
+}
+
 /*
     Expecting some thing like
     {"jsonrpc":"2.0","id":1001,"result":0}
 */
 bool convertEventSubResponseToInt(const string &jsonMsg, int &response)
 {
-    Json::Value result;
+    JsonDocument doc;
+    JsonValue result;
     bool status = false;
 
-    getResultObject(jsonMsg, result);
+    getResultObject(jsonMsg, doc, result);
 
     if (result.isInt())
     {
@@ -380,14 +431,19 @@ bool convertEventSubResponseToInt(const string &jsonMsg, int &response)
 
 /// Implementation of EventUtils.h
 
+// Global debug variables - check environment variable or command line flag
+bool debug = (getenv("SMDEBUG") != NULL);
+bool tdebug = (getenv("SMDEBUG") != NULL);
+
 bool getMessageId(const string &jsonMsg, int &msgId)
 {
     bool status = false;
-    Json::Value root;
+    JsonDocument doc;
 
-    if (parseJson(jsonMsg, root))
+    if (parseFrame(jsonMsg, doc))
     {
-        if (!root["id"].empty())
+        JsonValue root = doc.root();
+        if (!root["id"].isNull())
         {
             msgId = root["id"].asInt();
             status = true;
@@ -398,10 +454,11 @@ bool getMessageId(const string &jsonMsg, int &msgId)
 bool getEventId(const string &jsonMsg, string &evtName)
 {
     bool status = false;
-        Json::Value root;
-    if (parseJson(jsonMsg, root))
+    JsonDocument doc;
+    if (parseFrame(jsonMsg, doc))
     {
-        if (!root["method"].empty())
+        JsonValue root = doc.root();
+        if (!root["method"].isNull())
         {
             evtName = root["method"].asString();
             status = true;
@@ -412,14 +469,14 @@ bool getEventId(const string &jsonMsg, string &evtName)
 
 bool getDialEventParams(const string &jsonMsg, DialParams &params)
 {
-    Json::Value root;
+    JsonDocument doc;
     bool status = false;
 
-    if (parseJson(jsonMsg, root))
+    if (parseFrame(jsonMsg, doc))
     {
-        if (root["params"].isObject())
+        JsonValue jparams = doc.root()["params"];
+        if (jparams.isObject())
         {
-            Json::Value jparams = root["params"];
             params.appName = jparams["applicationName"].asString();
             if (!jparams["applicationId"].isNull())
                 params.appId = jparams["applicationId"].asString();
@@ -438,9 +495,10 @@ bool getDialEventParams(const string &jsonMsg, DialParams &params)
 bool getValueOfKeyFromJson(const string &jsonMsg, const string &key, string &value)
 {
 	bool status = false;
-	Json::Value root;
-	if (parseJson(jsonMsg, root))
+	JsonDocument doc;
+	if (parseFrame(jsonMsg, doc))
 	{
+		JsonValue root = doc.root();
 		if (!root[key].isNull())
 		{
 			value = root[key].asString();
@@ -457,13 +515,13 @@ bool isValidJsonResponse(const string &response)
 		return false;
 	}
 
-	Json::Value root;
-	if (!parseJson(response, root)) {
+	JsonDocument doc;
+	if (!parseFrame(response, doc)) {
 		LOGERR("Response is not valid JSON: %s", response.c_str());
 		return false;
 	}
 
-	if (checkForThunderErrorResponse(response)) {
+	if (logThunderError(doc.root())) {
 		return false;
 	}
 
@@ -473,13 +531,13 @@ bool isValidJsonResponse(const string &response)
 bool getParamFromResult(const string &jsonMsg, const string &param, string &value)
 {
     bool status = false;
-    Json::Value root;
-    if (parseJson(jsonMsg, root))
+    JsonDocument doc;
+    if (parseFrame(jsonMsg, doc))
     {
-        if (root["result"].isObject())
+        JsonValue result = doc.root()["result"];
+        if (result.isObject())
         {
-            Json::Value params = root["result"];
-            value = params[param].asString();
+            value = result[param].asString();
             status = true;
         }
     }
@@ -554,7 +612,7 @@ string shutdownAppToJson(const string &appName, int &id)
     return getStringFromJson(root);
 }
 
-string sendDeepLinkToJson(const DialParams &dialParams, int &id)
+string sendDeepLinkToJson(const DialParams &dialParams, const std::vector<AppConfig> &appConfigs, int &id)
 {
     Json::Value root;
     addVersion(root, id);
@@ -564,7 +622,7 @@ string sendDeepLinkToJson(const DialParams &dialParams, int &id)
     bool found = false;
     string netflixIIDInfo = "source_type=12&iid=99a5fb82";
 
-    for (const auto& appConfig : g_appConfigList) {
+    for (const auto& appConfig : appConfigs) {
         if (appConfig.name == dialParams.appName) {
             method = appConfig.deeplinkmethod;
             url = appConfig.baseurl;
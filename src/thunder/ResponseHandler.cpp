@@ -17,55 +17,181 @@
  * limitations under the License.
  */
 
+#define LOG_MODULE LOG_MODULE_RESPONSE
+
 #include <chrono>
 #include <algorithm>
 #include <sstream>
 #include <memory>
+#include <map>
+#include <cstring>
+#include <strings.h>
 #include "json/json.h"
 #include "ResponseHandler.h"
 #include "EventUtils.h"
 #include "ProtocolHandler.h"
-
-ResponseHandler *ResponseHandler::mcp_INSTANCE{nullptr};
+#include "JsonDocument.h"
+#include "Tracer.h"
 
 constexpr std::chrono::seconds ResponseHandler::CLEANUP_INTERVAL;
 constexpr std::chrono::seconds ResponseHandler::MAX_REQUEST_AGE;
+constexpr std::chrono::seconds ResponseHandler::HEARTBEAT_INTERVAL;
+constexpr unsigned ResponseHandler::STALL_TIMEOUTS;
+constexpr std::chrono::seconds ResponseHandler::STALL_PROBE_INTERVAL;
+
+static std::atomic<unsigned> s_handlerBudgetMs{250};
 
-ResponseHandler *ResponseHandler::getInstance()
+void setHandlerBudget(unsigned ms)
 {
-    if (ResponseHandler::mcp_INSTANCE == nullptr)
-    {
-        ResponseHandler::mcp_INSTANCE = new ResponseHandler();
-        ResponseHandler::mcp_INSTANCE->initialize();
+    s_handlerBudgetMs.store(ms, std::memory_order_relaxed);
+}
+
+static std::atomic<unsigned> s_maxQueuedEvents{256};
+static std::atomic<unsigned> s_maxEventLagMs{2000};
+
+void setEventQueueLimits(unsigned maxQueued, unsigned maxLagMs)
+{
+    s_maxQueuedEvents.store(maxQueued, std::memory_order_relaxed);
+    s_maxEventLagMs.store(maxLagMs, std::memory_order_relaxed);
+}
+
+static std::atomic<unsigned> s_maxPendingRequests{64};
+static std::atomic<unsigned> s_maxPendingPerMethod{16};
+static std::atomic<unsigned> s_slotWaitMs{0};
+
+void setRequestLimits(unsigned maxPending, unsigned maxPerMethod, unsigned waitMs)
+{
+    s_maxPendingRequests.store(maxPending, std::memory_order_relaxed);
+    s_maxPendingPerMethod.store(maxPerMethod, std::memory_order_relaxed);
+    s_slotWaitMs.store(waitMs, std::memory_order_relaxed);
+}
+
+static std::atomic<bool> s_coalesceEvents{true};
+
+void setEventCoalescing(bool enable)
+{
+    s_coalesceEvents.store(enable, std::memory_order_relaxed);
+}
+
+// Events that only rewrite the cached state of the app they name. The RDKShell ones name it
+// as "client", Controller statechange as "callsign".
+static const char *const STATE_EVENTS[] = {
+    "onApplicationActivated", "onApplicationLaunched", "onApplicationResumed",
+    "onApplicationSuspended", "onApplicationTerminated", "onDestroyed",
+    "onLaunched", "onSuspended", "onPluginSuspended", "statechange"
+};
+
+// The app a state event is about; empty for any other event. A statechange that Thunder did not
+// ask for (a crash, memory or watchdog kill) does more than rewrite the state: the warm pool
+// acts on it. It gets no key, so it is never replaced and later events do not move past it.
+static std::string stateEventKey(const JsonValue &message)
+{
+    JsonText method = message["method"].text();
+    const char *dot = static_cast<const char *>(memrchr(method.data, '.', method.size));
+    JsonText eventType = dot == nullptr ? method : JsonText{dot + 1, method.size - (dot + 1 - method.data)};
+    for (const char *stateEvent : STATE_EVENTS) {
+        if (eventType != stateEvent)
+            continue;
+        bool controller = strcmp(stateEvent, "statechange") == 0;
+        if (controller) {
+            JsonText reason = message["params"]["reason"].text();
+            if (reason.size != strlen("requested") || strncasecmp(reason.data, "requested", reason.size) != 0)
+                return std::string();
+        }
+        JsonValue app = message["params"][controller ? "callsign" : "client"];
+        return app.isString() ? app.asString() : std::string();
     }
-    return ResponseHandler::mcp_INSTANCE;
+    return std::string();
 }
 
-std::string ResponseHandler::extractParamsFromJsonRpc(const std::string& jsonRpcMsg)
+// How often the cleanup thread or timer looks at the running handler and at the requests
+// sent without waiting, whose reply is overdue after REQUEST_TIMEOUT_IN_MS.
+static std::chrono::milliseconds watchPeriod(unsigned budgetMs)
 {
-    Json::Value root;
-    Json::CharReaderBuilder builder;
-    std::unique_ptr<Json::CharReader> reader(builder.newCharReader());
-    std::string errs;
+    std::chrono::milliseconds replyCheck(REQUEST_TIMEOUT_IN_MS / 4);
+    return budgetMs ? std::min(replyCheck, std::chrono::milliseconds(std::max(budgetMs / 2, 10u))) : replyCheck;
+}
 
-    bool parsingSuccessful = reader->parse(
-        jsonRpcMsg.c_str(),
-        jsonRpcMsg.c_str() + jsonRpcMsg.size(),
-        &root,
-        &errs);
+static std::string formatSpanTree(const TraceSpan &span, const std::map<uint64_t, std::vector<const TraceSpan *>> &children)
+{
+    std::string out = span.name;
+    if (!span.detail.empty())
+        out += "(" + span.detail + ")";
+    out += " " + std::to_string(span.durationUs / 1000) + " ms";
+    auto it = children.find(span.spanId);
+    if (it != children.end()) {
+        out += " [";
+        for (size_t i = 0; i < it->second.size(); i++)
+            out += (i ? ", " : "") + formatSpanTree(*it->second[i], children);
+        out += "]";
+    }
+    return out;
+}
+
+// Where a slow handler spent its time: the completed spans of its trace as a tree, e.g.
+// "onDialEvent 1620 ms [launchPremiumApp 110 ms, settle_sleep 500 ms, ...]".
+static std::string handlerSpanBreakdown(uint64_t traceId)
+{
+    if (traceId == 0)
+        return "no spans, tracing is disabled";
+    std::vector<TraceSpan> spans = Tracer::getInstance()->snapshot();
+    std::map<uint64_t, const TraceSpan *> byId;
+    for (const TraceSpan &span : spans) {
+        if (span.traceId == traceId && span.name != "queue_wait")
+            byId[span.spanId] = &span;
+    }
+    std::vector<const TraceSpan *> top;
+    std::map<uint64_t, std::vector<const TraceSpan *>> children;
+    for (const auto &entry : byId) {
+        const TraceSpan *span = entry.second;
+        if (byId.count(span->parentId))
+            children[span->parentId].push_back(span);
+        else
+            top.push_back(span);
+    }
+    auto byStart = [](const TraceSpan *a, const TraceSpan *b) { return a->startUs < b->startUs; };
+    std::sort(top.begin(), top.end(), byStart);
+    for (auto &entry : children)
+        std::sort(entry.second.begin(), entry.second.end(), byStart);
+
+    std::string out;
+    for (size_t i = 0; i < top.size(); i++)
+        out += (i ? ", " : "") + formatSpanTree(*top[i], children);
+    return out.empty() ? "no spans recorded" : out;
+}
+
+ResponseHandler::ResponseHandler(const std::string &device)
+    : m_completedCount(0), m_backlog(0), m_dispatchArrival(0), m_dropping(false), m_consecutiveTimeouts(0),
+      mp_thandle(nullptr), mp_cleanupThread(nullptr), m_runLoop(true), mp_listener(nullptr),
+      mp_io(nullptr), m_drainPosted(false), m_dispatching(false),
+      m_device(device), m_deviceLabel(device.empty() ? "" : metricLabel("device", device)),
+      mp_eventQueueDepth(MetricsRegistry::getInstance()->gauge("event_queue_depth", m_deviceLabel)),
+      mp_pendingRequests(MetricsRegistry::getInstance()->gauge("thunder_requests_pending", m_deviceLabel)),
+      mp_lateResponses(MetricsRegistry::getInstance()->counter("thunder_late_responses_total", m_deviceLabel)),
+      mp_coalescedEvents(MetricsRegistry::getInstance()->counter("events_coalesced_total", m_deviceLabel)),
+      mp_droppedEvents(MetricsRegistry::getInstance()->counter("events_dropped_total", m_deviceLabel)),
+      m_heartbeat(std::chrono::steady_clock::now().time_since_epoch().count()),
+      m_handlerStart(0), m_handlerFlagged(false)
+{
+}
+
+ResponseHandler::~ResponseHandler()
+{
+    shutdown();
+}
 
-    if (!parsingSuccessful) {
+std::string ResponseHandler::extractParamsFromJsonRpc(const std::string& jsonRpcMsg)
+{
+    JsonDocument doc;
+    if (!doc.parse(jsonRpcMsg)) {
         LOGERR("Failed to parse JSON-RPC message: %s", jsonRpcMsg.c_str());
         return "{}";
     }
 
-    if (root["params"].isObject()) {
-        Json::StreamWriterBuilder writerBuilder;
-        writerBuilder["indentation"] = "";
-        std::ostringstream os;
-        std::unique_ptr<Json::StreamWriter> writer(writerBuilder.newStreamWriter());
-        writer->write(root["params"], &os);
-        return os.str();
+    // params as sent, nothing to re-serialize
+    JsonValue params = doc.root()["params"];
+    if (params.isObject()) {
+        return params.raw();
     }
 
     return "{}";
@@ -81,14 +207,15 @@ void ResponseHandler::handleEvent()
         return;
     }
 
-    string eventMsg;
+    QueuedEvent event;
     {
         std::lock_guard<std::mutex> lock(m_eventMutex);
-        eventMsg = m_eventQueue[0];
+        event = std::move(m_eventQueue[0]);
         m_eventQueue.erase(m_eventQueue.begin());
+        mp_eventQueueDepth->set(m_eventQueue.size());
     }
 
-    processEvent(eventMsg);
+    processEvent(event);
 
     LOGTRACE("Exit");
 }
@@ -99,17 +226,143 @@ void ResponseHandler::initialize()
     mp_cleanupThread = new std::thread([this] { runCleanupLoop(); });
 }
 
+void ResponseHandler::initialize(boost::asio::io_service &io)
+{
+    mp_io = &io;
+    mp_strand.reset(new boost::asio::io_service::strand(io));
+    mp_cleanupTimer.reset(new boost::asio::steady_timer(io));
+    mp_heartbeatTimer.reset(new boost::asio::steady_timer(io));
+    mp_budgetTimer.reset(new boost::asio::steady_timer(io));
+    scheduleCleanup();
+    scheduleHeartbeat();
+    scheduleBudgetCheck();
+}
+
+void ResponseHandler::drainEvents()
+{
+    // A handler waiting for a reply runs the io service, which can land here again. Leave the
+    // new events to the outer drain so events are still dispatched one at a time, in order.
+    if (m_dispatching)
+        return;
+    m_dispatching = true;
+    while (m_runLoop) {
+        std::vector<QueuedEvent> events;
+        {
+            std::lock_guard<std::mutex> lock(m_eventMutex);
+            if (m_eventQueue.empty()) {
+                m_drainPosted = false;
+                break;
+            }
+            events = std::move(m_eventQueue);
+            m_eventQueue.clear();
+            mp_eventQueueDepth->set(0);
+        }
+        for (const auto& event : events)
+            processEvent(event);
+    }
+    m_dispatching = false;
+}
+
+void ResponseHandler::scheduleCleanup()
+{
+    mp_cleanupTimer->expires_after(CLEANUP_INTERVAL);
+    mp_cleanupTimer->async_wait([this](const boost::system::error_code &ec) {
+        if (ec || !m_runLoop)
+            return;
+        cleanupExpiredRequests();
+        scheduleCleanup();
+    });
+}
+
+void ResponseHandler::scheduleHeartbeat()
+{
+    // On the strand, so it stalls exactly when dispatch does.
+    mp_heartbeatTimer->expires_after(HEARTBEAT_INTERVAL);
+    mp_heartbeatTimer->async_wait(mp_strand->wrap([this](const boost::system::error_code &ec) {
+        if (ec || !m_runLoop)
+            return;
+        beat();
+        scheduleHeartbeat();
+    }));
+}
+
+void ResponseHandler::scheduleBudgetCheck()
+{
+    // Not on the strand: it has to run while a handler holds the strand and runs the io
+    // service waiting for a reply.
+    mp_budgetTimer->expires_after(watchPeriod(s_handlerBudgetMs.load(std::memory_order_relaxed)));
+    mp_budgetTimer->async_wait([this](const boost::system::error_code &ec) {
+        if (ec || !m_runLoop)
+            return;
+        checkHandlerBudget();
+        expireDetachedRequests();
+        scheduleBudgetCheck();
+    });
+}
+
+void ResponseHandler::checkHandlerBudget()
+{
+    unsigned budget = s_handlerBudgetMs.load(std::memory_order_relaxed);
+    int64_t start = m_handlerStart.load();
+    if (budget == 0 || start == 0 || m_handlerFlagged.load())
+        return;
+    auto running = std::chrono::steady_clock::now() -
+                   std::chrono::steady_clock::time_point(std::chrono::steady_clock::duration(start));
+    if (running < std::chrono::milliseconds(budget))
+        return;
+    std::string name;
+    {
+        std::lock_guard<std::mutex> lock(m_handlerMutex);
+        name = m_handlerName;
+    }
+    if (m_handlerFlagged.exchange(true))
+        return;
+    MetricsRegistry::getInstance()->counter("event_handler_over_budget_total",
+        joinLabels(m_deviceLabel, metricLabel("event", name)))->inc();
+    LOGWARN("Handler for %s%s%s still running after %lld ms, budget %u ms", name.c_str(),
+            m_device.empty() ? "" : " on ", m_device.c_str(),
+            static_cast<long long>(std::chrono::duration_cast<std::chrono::milliseconds>(running).count()), budget);
+}
+
+void ResponseHandler::beat()
+{
+    m_heartbeat.store(std::chrono::steady_clock::now().time_since_epoch().count(), std::memory_order_relaxed);
+}
+
+std::chrono::steady_clock::time_point ResponseHandler::lastHeartbeat() const
+{
+    return std::chrono::steady_clock::time_point(
+        std::chrono::steady_clock::duration(m_heartbeat.load(std::memory_order_relaxed)));
+}
+
+std::future_status ResponseHandler::waitForReply(std::future<Frame> &future, int timeout)
+{
+    if (mp_io == nullptr)
+        return future.wait_for(std::chrono::milliseconds(timeout));
+
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout);
+    while (future.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+        auto now = std::chrono::steady_clock::now();
+        if (now >= deadline || mp_io->stopped())
+            return std::future_status::timeout;
+        mp_io->run_one_for(deadline - now);
+    }
+    return std::future_status::ready;
+}
+
 void ResponseHandler::runEventLoop()
 {
     while (m_runLoop) {
         std::unique_lock<std::mutex> lock(m_eventMutex);
-        m_eventCV.wait(lock, [this] { return !m_eventQueue.empty() || !m_runLoop; });
+        m_eventCV.wait_for(lock, HEARTBEAT_INTERVAL, [this] { return !m_eventQueue.empty() || !m_runLoop; });
 
         if (!m_runLoop) break;
+        beat();
 
         if (!m_eventQueue.empty()) {
             auto events = std::move(m_eventQueue);
             m_eventQueue.clear();
+            mp_eventQueueDepth->set(0);
             lock.unlock();
             for (const auto& event : events) {
                 processEvent(event);
@@ -119,63 +372,94 @@ void ResponseHandler::runEventLoop()
     LOGTRACE("Exit");
 }
 
-string ResponseHandler::getRequestStatus(int msgId, int timeout)
+Frame ResponseHandler::getRequestStatus(int msgId, int timeout)
 {
     LOGTRACE("Waiting for request id %d with timeout %d ms.", msgId, timeout);
 
     std::unique_lock<std::mutex> lock(m_requestMutex);
 
     auto it = m_pendingRequests.find(msgId);
+    if (!m_runLoop) {
+        // Shutting down: nobody is going to answer, don't make the caller sit out its timeout.
+        if (it != m_pendingRequests.end())
+            eraseRequest(it);
+        return nullptr;
+    }
     if (it != m_pendingRequests.end()) {
         if (it->second->state == RequestState::COMPLETED) {
-            std::string response = std::move(it->second->response);
-            m_pendingRequests.erase(it);
+            Frame response = std::move(it->second->response);
+            eraseRequest(it);
             return response;
         }
     } else {
         auto context = std::make_unique<RequestContext>(msgId);
         m_pendingRequests[msgId] = std::move(context);
         it = m_pendingRequests.find(msgId);
+        mp_pendingRequests->set(m_pendingRequests.size());
     }
 
     auto future = it->second->promise.get_future();
     lock.unlock(); // Release lock before waiting
 
-    auto status = future.wait_for(std::chrono::milliseconds(timeout));
+    auto status = waitForReply(future, timeout);
 
     lock.lock(); // Reacquire lock after waiting
 
+    // The cleanup may have swept a cancelled entry while we waited.
+    it = m_pendingRequests.find(msgId);
     if (status == std::future_status::ready) {
         try {
-            std::string response = future.get();
-            m_pendingRequests.erase(msgId);
+            Frame response = future.get();
+            if (it != m_pendingRequests.end())
+                eraseRequest(it);
+            if (response)
+                m_consecutiveTimeouts = 0;
             return response;
         } catch (const std::exception& e) {
             LOGERR("Exception getting response for id %d: %s", msgId, e.what());
         }
     } else {
         LOGTRACE("Request %d timed out", msgId);
-        auto timeoutIt = m_pendingRequests.find(msgId);
-        if (timeoutIt != m_pendingRequests.end()) {
-            timeoutIt->second->state = RequestState::TIMEOUT;
-        }
+        noteTimeout();
+        // Nobody waits on this entry any more; a reply that still turns up is counted
+        // as late. Keeping it for the cleanup loop only grows the map under load.
+        if (it != m_pendingRequests.end())
+            eraseRequest(it);
     }
 
-    return "";
+    return nullptr;
 }
 void ResponseHandler::shutdown()
 {
     LOGTRACE("Enter");
-    m_runLoop = false;
-
     {
         std::lock_guard<std::mutex> lock(m_requestMutex);
+        m_runLoop = false;
+        // Release every caller still blocked on a reply, an event handler among them,
+        // so the joins below don't wait out request timeouts.
+        for (auto &entry : m_pendingRequests) {
+            if (entry.second->state != RequestState::PENDING)
+                continue;
+            entry.second->state = RequestState::CANCELLED;
+            try {
+                entry.second->promise.set_value(nullptr);
+            } catch (const std::exception& e) {
+                // Promise might already be fulfilled
+            }
+        }
         m_requestCV.notify_all();
+        m_slotCV.notify_all();
     }
     {
         std::lock_guard<std::mutex> lock(m_eventMutex);
         m_eventCV.notify_all();
     }
+    if (mp_cleanupTimer)
+        mp_cleanupTimer->cancel();
+    if (mp_heartbeatTimer)
+        mp_heartbeatTimer->cancel();
+    if (mp_budgetTimer)
+        mp_budgetTimer->cancel();
 
     if (mp_cleanupThread && mp_cleanupThread->joinable()) {
         mp_cleanupThread->join();
@@ -191,48 +475,230 @@ void ResponseHandler::shutdown()
 
     LOGTRACE("Exit");
 }
-void ResponseHandler::addMessageToResponseQueue(int msgId, const std::string& msg)
+void ResponseHandler::addMessageToResponseQueue(int msgId, Frame frame)
 {
     LOGTRACE("Adding response for id %d", msgId);
 
-    std::lock_guard<std::mutex> lock(m_requestMutex);
+    std::unique_lock<std::mutex> lock(m_requestMutex);
 
     auto it = m_pendingRequests.find(msgId);
     if (it != m_pendingRequests.end()) {
-        if (it->second->state == RequestState::PENDING) {
-            it->second->response = msg;
+        if (it->second->state == RequestState::PENDING && it->second->onReply) {
+            std::function<void(Frame)> onReply = std::move(it->second->onReply);
+            eraseRequest(it);
+            m_completedCount++;
+            m_consecutiveTimeouts = 0;
+            lock.unlock();
+            onReply(std::move(frame));
+        } else if (it->second->state == RequestState::PENDING) {
+            it->second->response = frame;
             it->second->state = RequestState::COMPLETED;
+            m_completedCount++;
             try {
-                it->second->promise.set_value(msg);
+                it->second->promise.set_value(std::move(frame));
             } catch (const std::exception& e) {
                 LOGERR("Exception setting promise for id %d: %s", msgId, e.what());
             }
         } else {
             LOGTRACE("Response for id %d arrived but request is in state %d",
                     msgId, static_cast<int>(it->second->state));
+            mp_lateResponses->inc();
         }
     } else {
         LOGTRACE("Late response for id %d - no pending request found", msgId);
+        mp_lateResponses->inc();
     }
 }
-void ResponseHandler::addMessageToEventQueue(const std::string& msg)
+
+bool ResponseHandler::admitRequest()
+{
+    if (m_consecutiveTimeouts.load(std::memory_order_relaxed) < STALL_TIMEOUTS)
+        return true;
+    auto now = std::chrono::steady_clock::now();
+    std::lock_guard<std::mutex> lock(m_requestMutex);
+    if (now - m_lastProbe < STALL_PROBE_INTERVAL)
+        return false;
+    m_lastProbe = now;
+    return true;
+}
+
+bool ResponseHandler::overloaded() const
+{
+    if (m_consecutiveTimeouts.load(std::memory_order_relaxed) >= STALL_TIMEOUTS)
+        return true;
+    unsigned maxQueued = s_maxQueuedEvents.load(std::memory_order_relaxed);
+    if (maxQueued != 0 && m_backlog.load(std::memory_order_relaxed) >= std::max(maxQueued / 2, 1u))
+        return true;
+    unsigned maxLagMs = s_maxEventLagMs.load(std::memory_order_relaxed);
+    int64_t arrival = m_dispatchArrival.load(std::memory_order_relaxed);
+    return maxLagMs != 0 && arrival != 0 &&
+           std::chrono::steady_clock::now() - std::chrono::steady_clock::time_point(std::chrono::steady_clock::duration(arrival)) >=
+               std::chrono::milliseconds(maxLagMs);
+}
+
+bool ResponseHandler::registerRequest(int msgId, const std::string &method)
+{
+    return registerRequest(msgId, method, nullptr);
+}
+
+bool ResponseHandler::registerRequest(int msgId, const std::string &method, std::function<void(Frame)> onReply)
+{
+    unsigned maxPending = s_maxPendingRequests.load(std::memory_order_relaxed);
+    unsigned maxPerMethod = s_maxPendingPerMethod.load(std::memory_order_relaxed);
+
+    std::unique_lock<std::mutex> lock(m_requestMutex);
+    unsigned &methodPending = m_pendingByMethod[method];
+    auto hasSlot = [&] {
+        return (maxPending == 0 || m_pendingRequests.size() < maxPending) &&
+               (maxPerMethod == 0 || methodPending < maxPerMethod);
+    };
+    if (!hasSlot()) {
+        // In single thread mode the replies that free a slot are read on this very thread,
+        // and a request nobody waits for is not worth holding up its sender.
+        unsigned waitMs = (mp_io == nullptr && !onReply) ? s_slotWaitMs.load(std::memory_order_relaxed) : 0;
+        if (waitMs == 0 ||
+            !m_slotCV.wait_for(lock, std::chrono::milliseconds(waitMs), [&] { return !m_runLoop || hasSlot(); }) ||
+            !m_runLoop) {
+            LOGWARN("Overloaded: %zu request(s) pending, %u for %s, rejecting", m_pendingRequests.size(),
+                    methodPending, method.c_str());
+            return false;
+        }
+    }
+    auto context = std::make_unique<RequestContext>(msgId);
+    context->onReply = std::move(onReply);
+    context->methodPending = &methodPending;
+    methodPending++;
+    m_pendingRequests[msgId] = std::move(context);
+    mp_pendingRequests->set(m_pendingRequests.size());
+    return true;
+}
+
+ResponseHandler::PendingRequests::iterator ResponseHandler::eraseRequest(PendingRequests::iterator it)
+{
+    if (it->second->methodPending != nullptr)
+        --*it->second->methodPending;
+    it = m_pendingRequests.erase(it);
+    mp_pendingRequests->set(m_pendingRequests.size());
+    m_slotCV.notify_all();
+    return it;
+}
+
+void ResponseHandler::registerRequest(int msgId)
+{
+    std::lock_guard<std::mutex> lock(m_requestMutex);
+    if (m_pendingRequests.find(msgId) == m_pendingRequests.end()) {
+        m_pendingRequests[msgId] = std::make_unique<RequestContext>(msgId);
+        mp_pendingRequests->set(m_pendingRequests.size());
+    }
+}
+void ResponseHandler::addMessageToEventQueue(Frame frame, std::chrono::steady_clock::time_point arrival,
+                                             const JsonValue &message)
 {
     LOGTRACE("Adding event to queue");
 
+    // Taken from the routing parse; the frame is not parsed again here.
+    std::string stateKey;
+    if (s_coalesceEvents.load(std::memory_order_relaxed) && !message.isNull())
+        stateKey = stateEventKey(message);
+
     std::lock_guard<std::mutex> lock(m_eventMutex);
-    m_eventQueue.emplace_back(msg);
-    m_eventCV.notify_one();
+    bool replaced = false;
+    if (!stateKey.empty()) {
+        // Only the state events queued after the last other event are candidates, so a DIAL
+        // request still sees the app state it would have seen without coalescing.
+        for (auto it = m_eventQueue.rbegin(); it != m_eventQueue.rend() && !it->stateKey.empty(); ++it) {
+            if (it->stateKey == stateKey) {
+                m_eventQueue.erase(std::next(it).base());
+                mp_coalescedEvents->inc();
+                replaced = true;
+                break;
+            }
+        }
+    }
+    if (!replaced) {
+        // Behind a stalled Thunder every handler waits out its timeouts while events keep
+        // coming; past the cap they are dropped rather than queued without bound.
+        unsigned maxQueued = s_maxQueuedEvents.load(std::memory_order_relaxed);
+        if (maxQueued != 0 && m_backlog.load(std::memory_order_relaxed) >= maxQueued) {
+            mp_droppedEvents->inc();
+            if (!m_dropping)
+                LOGWARN("%u events waiting for dispatch%s%s, dropping new ones", maxQueued,
+                        m_device.empty() ? "" : " on ", m_device.c_str());
+            m_dropping = true;
+            return;
+        }
+        m_dropping = false;
+        m_backlog++;
+    }
+    m_eventQueue.emplace_back(std::move(frame), arrival);
+    m_eventQueue.back().stateKey = std::move(stateKey);
+    mp_eventQueueDepth->set(m_eventQueue.size());
+    wakeDispatch();
 
     LOGTRACE("Added event to queue");
 }
 
+void ResponseHandler::postTask(std::function<void()> task)
+{
+    std::lock_guard<std::mutex> lock(m_eventMutex);
+    m_backlog++;
+    m_eventQueue.emplace_back(nullptr, std::chrono::steady_clock::now());
+    m_eventQueue.back().task = std::move(task);
+    mp_eventQueueDepth->set(m_eventQueue.size());
+    wakeDispatch();
+}
+
+void ResponseHandler::wakeDispatch()
+{
+    if (mp_io == nullptr) {
+        m_eventCV.notify_one();
+    } else if (!m_drainPosted) {
+        m_drainPosted = true;
+        mp_strand->post([this] { drainEvents(); });
+    }
+}
+
 void ResponseHandler::connectionEvent(bool connected)
 {
-    (void)connected;
-    // This needs to be revisited.
+    // Whatever stalled the old connection is not held against a new one.
+    m_consecutiveTimeouts = 0;
+    if (connected)
+        return;
+
+    // Nothing will answer what was sent on the lost connection; release the callers now
+    // rather than after their timeouts.
+    std::vector<std::function<void(Frame)>> detached;
+    size_t failed = 0;
+    {
+        std::lock_guard<std::mutex> lock(m_requestMutex);
+        for (auto it = m_pendingRequests.begin(); it != m_pendingRequests.end();) {
+            if (it->second->state != RequestState::PENDING) {
+                ++it;
+                continue;
+            }
+            failed++;
+            if (it->second->onReply) {
+                detached.push_back(std::move(it->second->onReply));
+                it = eraseRequest(it);
+                continue;
+            }
+            it->second->state = RequestState::CANCELLED;
+            try {
+                it->second->promise.set_value(nullptr);
+            } catch (const std::exception& e) {
+                // Promise might already be fulfilled
+            }
+            ++it;
+        }
+        mp_pendingRequests->set(m_pendingRequests.size());
+    }
+    if (failed > 0)
+        LOGWARN("Connection lost, failed %zu pending request(s)", failed);
+    for (auto &onReply : detached)
+        onReply(nullptr);
 }
 
-std::future<std::string> ResponseHandler::getRequestAsync(int msgId)
+std::future<Frame> ResponseHandler::getRequestAsync(int msgId)
 {
     std::lock_guard<std::mutex> lock(m_requestMutex);
 
@@ -243,6 +709,7 @@ std::future<std::string> ResponseHandler::getRequestAsync(int msgId)
     auto context = std::make_unique<RequestContext>(msgId);
     auto future = context->promise.get_future();
     m_pendingRequests[msgId] = std::move(context);
+    mp_pendingRequests->set(m_pendingRequests.size());
 
     return future;
 }
@@ -255,19 +722,38 @@ bool ResponseHandler::cancelRequest(int msgId)
     if (it != m_pendingRequests.end() && it->second->state == RequestState::PENDING) {
         it->second->state = RequestState::CANCELLED;
         try {
-            it->second->promise.set_value("");
+            it->second->promise.set_value(nullptr);
         } catch (const std::exception& e) {
             // Promise might already be fulfilled
         }
-        m_pendingRequests.erase(it);
+        eraseRequest(it);
         return true;
     }
 
     return false;
 }
 
-void ResponseHandler::processEvent(const std::string& eventMsg)
+void ResponseHandler::processEvent(const QueuedEvent& event)
 {
+    if (event.task) {
+        m_backlog--;
+        {
+            std::lock_guard<std::mutex> lock(m_handlerMutex);
+            m_handlerName = "task";
+        }
+        m_handlerFlagged = false;
+        m_handlerStart = std::chrono::steady_clock::now().time_since_epoch().count();
+        event.task();
+        m_handlerStart = 0;
+        return;
+    }
+    const std::string& eventMsg = *event.frame;
+    // Each event starts its own trace; the root span covers the time spent queued.
+    ScopedSpan span("event", "", event.arrival);
+    auto dispatchStart = std::chrono::steady_clock::now();
+    recordSpan("queue_wait", event.arrival, dispatchStart);
+    m_backlog--;
+
     if (mp_listener == nullptr) {
         LOGTRACE("No listeners - skipping event");
         return;
@@ -278,7 +764,57 @@ void ResponseHandler::processEvent(const std::string& eventMsg)
         LOGERR("Failed to extract event name from: %s", eventMsg.c_str());
         return;
     }
+    span.setDetail(eventName);
+    const EventMetrics &metrics = eventMetrics(eventName);
+    const std::string &eventType = metrics.type;
+    metrics.dispatched->inc();
+    metrics.queueWait->observe(
+        std::chrono::duration_cast<std::chrono::microseconds>(dispatchStart - event.arrival).count());
+
+    {
+        std::lock_guard<std::mutex> lock(m_handlerMutex);
+        m_handlerName = eventType;
+    }
+    m_handlerFlagged = false;
+    m_handlerStart = dispatchStart.time_since_epoch().count();
+    m_dispatchArrival = event.arrival.time_since_epoch().count();
+    dispatchToListener(eventName, eventMsg);
+    m_dispatchArrival = 0;
+    m_handlerStart = 0;
+
+    auto took = std::chrono::steady_clock::now() - dispatchStart;
+    metrics.handler->observe(
+        std::chrono::duration_cast<std::chrono::microseconds>(took).count());
+    unsigned budget = s_handlerBudgetMs.load(std::memory_order_relaxed);
+    if (budget != 0 && took > std::chrono::milliseconds(budget)) {
+        if (!m_handlerFlagged.exchange(true))
+            metrics.overBudget->inc();
+        LOGWARN("Handler for %s%s%s took %lld ms, budget %u ms: %s", eventType.c_str(),
+                m_device.empty() ? "" : " on ", m_device.c_str(),
+                static_cast<long long>(std::chrono::duration_cast<std::chrono::milliseconds>(took).count()), budget,
+                handlerSpanBreakdown(span.traceId()).c_str());
+    }
+}
+
+const ResponseHandler::EventMetrics &ResponseHandler::eventMetrics(const std::string &eventName)
+{
+    auto found = m_eventMetrics.find(eventName);
+    if (found != m_eventMetrics.end())
+        return found->second;
+    // Event names arrive as "<subscription id>.<event>"; account by the event part.
+    size_t dotPos = eventName.rfind('.');
+    const std::string eventType = dotPos == std::string::npos ? eventName : eventName.substr(dotPos + 1);
+    MetricsRegistry *metrics = MetricsRegistry::getInstance();
+    const std::string label = joinLabels(m_deviceLabel, metricLabel("event", eventType));
+    EventMetrics entry{eventType, metrics->counter("events_dispatched_total", label),
+                       metrics->histogram("event_queue_wait_us", label),
+                       metrics->histogram("event_handler_us", label),
+                       metrics->counter("event_handler_over_budget_total", label)};
+    return m_eventMetrics.emplace(eventName, std::move(entry)).first->second;
+}
 
+void ResponseHandler::dispatchToListener(const std::string &eventName, const std::string &eventMsg)
+{
     DialParams dialParams;
 
     // Handle DIAL events
@@ -327,20 +863,61 @@ void ResponseHandler::runCleanupLoop()
 {
     LOGTRACE("Cleanup loop started");
 
-    while (m_runLoop) {
-        std::this_thread::sleep_for(CLEANUP_INTERVAL);
-
-        if (!m_runLoop) break;
-
-        cleanupExpiredRequests();
+    // Also watches the handler budget and overdue replies, so it wakes more often than it cleans up.
+    auto nextCleanup = std::chrono::steady_clock::now() + CLEANUP_INTERVAL;
+    while (true) {
+        auto period = watchPeriod(s_handlerBudgetMs.load(std::memory_order_relaxed));
+        {
+            // Woken early by shutdown(), so a session can be torn down without waiting out the interval.
+            std::unique_lock<std::mutex> lock(m_requestMutex);
+            if (m_requestCV.wait_for(lock, period, [this] { return !m_runLoop; }))
+                break;
+        }
+        checkHandlerBudget();
+        expireDetachedRequests();
+        if (std::chrono::steady_clock::now() >= nextCleanup) {
+            cleanupExpiredRequests();
+            nextCleanup = std::chrono::steady_clock::now() + CLEANUP_INTERVAL;
+        }
     }
 
     LOGTRACE("Cleanup loop exited");
 }
 
+void ResponseHandler::noteTimeout()
+{
+    if (++m_consecutiveTimeouts == STALL_TIMEOUTS)
+        LOGWARN("%u requests in a row timed out, Thunder%s%s is stalled", STALL_TIMEOUTS,
+                m_device.empty() ? "" : " of ", m_device.c_str());
+}
+
+void ResponseHandler::expireDetachedRequests()
+{
+    std::vector<std::function<void(Frame)>> detached;
+    {
+        std::lock_guard<std::mutex> lock(m_requestMutex);
+        auto overdue = std::chrono::steady_clock::now() - std::chrono::milliseconds(REQUEST_TIMEOUT_IN_MS);
+        for (auto it = m_pendingRequests.begin(); it != m_pendingRequests.end();) {
+            if (it->second->state == RequestState::PENDING && it->second->onReply && it->second->createdAt < overdue) {
+                LOGTRACE("Request %d timed out", it->first);
+                detached.push_back(std::move(it->second->onReply));
+                it = eraseRequest(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+    // Outside the lock, as for a reply: a callback may send the next request.
+    for (auto &onReply : detached) {
+        noteTimeout();
+        onReply(nullptr);
+    }
+}
+
 void ResponseHandler::cleanupExpiredRequests()
 {
-    std::lock_guard<std::mutex> lock(m_requestMutex);
+    std::vector<std::function<void(Frame)>> detached;
+    std::unique_lock<std::mutex> lock(m_requestMutex);
 
     auto now = std::chrono::steady_clock::now();
     auto it = m_pendingRequests.begin();
@@ -351,22 +928,27 @@ void ResponseHandler::cleanupExpiredRequests()
         if (age > MAX_REQUEST_AGE || it->second->state != RequestState::PENDING) {
             LOGTRACE("Cleaning up request %d (age: %lld seconds, state: %d)",
                     it->first,
-                    std::chrono::duration_cast<std::chrono::seconds>(age).count(),
+                    static_cast<long long>(std::chrono::duration_cast<std::chrono::seconds>(age).count()),
                     static_cast<int>(it->second->state));
 
-            if (it->second->state == RequestState::PENDING) {
+            if (it->second->state == RequestState::PENDING && it->second->onReply) {
+                detached.push_back(std::move(it->second->onReply));
+            } else if (it->second->state == RequestState::PENDING) {
                 try {
-                    it->second->promise.set_value("");
+                    it->second->promise.set_value(nullptr);
                 } catch (const std::exception& e) {
                     // Promise might already be fulfilled
                 }
             }
 
-            it = m_pendingRequests.erase(it);
+            it = eraseRequest(it);
         } else {
             ++it;
         }
     }
+    lock.unlock();
+    for (auto &onReply : detached)
+        onReply(nullptr);
 }
 
 size_t ResponseHandler::getPendingRequestCount() const
@@ -378,11 +960,11 @@ size_t ResponseHandler::getPendingRequestCount() const
 size_t ResponseHandler::getCompletedRequestCount() const
 {
     std::lock_guard<std::mutex> lock(m_requestMutex);
-    return m_completedRequests.size();
+    return m_completedCount;
 }
 
 void ResponseHandler::clearCompletedRequests()
 {
     std::lock_guard<std::mutex> lock(m_requestMutex);
-    m_completedRequests.clear();
+    m_completedCount = 0;
 }
@@ -17,6 +17,10 @@
  * limitations under the License.
  */
 
+#define LOG_MODULE LOG_MODULE_PROTOCOL
+
+#include <chrono>
+#include <cstring>
 #include <memory>
 #include <sstream>
 #include <fstream>
@@ -24,53 +28,171 @@
 #include "json/json.h"
 
 #include "ThunderInterface.h"
+#include "WebSocketTransport.h"
 #include "ProtocolHandler.h"
+#include "JsonDocument.h"
 #include "ResponseHandler.h"
 #include "EventUtils.h"
+#include "Metrics.h"
+#include "Tracer.h"
+
+static const char *const XCAST_CALLSIGN = "org.rdk.Xcast.1.";
+static const char *const RDKSHELL_CALLSIGN = "org.rdk.RDKShell.1.";
+static const char *const CONTROLLER_CALLSIGN = "Controller.1.";
+
+static const char *const DIAL_EVENTS[] = {
+    "onApplicationHideRequest", "onApplicationLaunchRequest", "onApplicationResumeRequest",
+    "onApplicationStateRequest", "onApplicationStopRequest"
+};
+static const char *const RDKSHELL_EVENTS[] = {
+    "onApplicationActivated", "onApplicationLaunched", "onApplicationResumed",
+    "onApplicationSuspended", "onApplicationTerminated", "onDestroyed",
+    "onLaunched", "onSuspended", "onPluginSuspended"
+};
+
+static std::atomic<unsigned> s_requestConnections{0};
+
+void setRequestConnections(unsigned count)
+{
+    s_requestConnections = count;
+}
+unsigned requestConnections()
+{
+    return s_requestConnections;
+}
+
+// Latency critical requests: a cast waits on these.
+static const char *const CRITICAL_METHODS[] = {
+    "org.rdk.RDKShell.1.launch", "org.rdk.RDKShell.1.suspend", "org.rdk.RDKShell.1.destroy",
+    "org.rdk.Xcast.1.setApplicationState", "deeplink@"
+};
+
+// Outcome of the last request made on this thread, see lastRequestResult().
+static thread_local RequestResult s_lastResult = RequestResult::OK;
+
+// Next free slot of ThunderInterface::m_methodMetrics, taken by each ThunderMethod as it is first used.
+static std::atomic<size_t> s_nextMethodIndex(0);
 
-std::vector<AppConfig> g_appConfigList;
+constexpr size_t ThunderInterface::MAX_METHODS;
 
-void ThunderInterface::connected(bool connected)
+static bool endsWith(const char *str, const char *suffix)
 {
-    LOGTRACE("Connection update .. %s", connected ? "true" : "false");
+    size_t len = strlen(str), suffixLen = strlen(suffix);
+    return len >= suffixLen && strcmp(str + len - suffixLen, suffix) == 0;
+}
+
+// The session is up while all of its connections are. One of them dropping takes the others
+// down with it, so the reconnect starts over with fresh subscriptions.
+void ThunderInterface::connected(size_t index, bool connected)
+{
+    LOGTRACE("Connection %zu update .. %s", index, connected ? "true" : "false");
+    bool all = true;
+    {
+        std::lock_guard<std::mutex> lock(m_connMutex);
+        m_connections[index].up = connected;
+        for (const Connection &conn : m_connections)
+            all = all && conn.up;
+    }
+    if (connected && !all)
+        return;
+    if (!connected)
+    {
+        for (size_t i = 0; i < m_connections.size(); i++)
+            if (i != index && m_connections[i].transport->isConnected())
+                m_connections[i].transport->disconnect();
+    }
+    mp_responses->connectionEvent(connected);
     if (nullptr != m_connListener)
         m_connListener(connected);
 }
-void ThunderInterface::onMsgReceived(const string message)
+ThunderInterface::Connection &ThunderInterface::route(const char *method)
+{
+    size_t requestConns = m_connections.size() - 1;
+    // Thunder sends events on the connection that subscribed to them.
+    if (requestConns == 0 || endsWith(method, ".register") || endsWith(method, ".unregister"))
+        return m_connections[0];
+    if (requestConns == 1)
+        return m_connections[1];
+    for (const char *critical : CRITICAL_METHODS)
+        if (strncmp(method, critical, strlen(critical)) == 0)
+            return m_connections[1];
+    return m_connections[2 + m_nextBulk++ % (requestConns - 1)];
+}
+ThunderInterface::ThunderMethod::ThunderMethod(const char *methodName)
+    : name(methodName), index(s_nextMethodIndex++)
+{
+    if (index >= MAX_METHODS)
+        LOGERR("Request method %s is past MAX_METHODS, its metrics are resolved on every request", name);
+}
+
+ThunderInterface::MethodMetrics ThunderInterface::resolveMethodMetrics(const std::string &method) const
+{
+    MetricsRegistry *metrics = MetricsRegistry::getInstance();
+    const std::string label = joinLabels(m_deviceLabel, metricLabel("method", method));
+    return {method, metrics->histogram("thunder_request_rtt_us", label),
+            metrics->counter("thunder_request_timeouts_total", label),
+            metrics->counter("thunder_request_send_failures_total", label),
+            metrics->counter("thunder_requests_rejected_total", label)};
+}
+
+const ThunderInterface::MethodMetrics &ThunderInterface::methodMetrics(const ThunderMethod &method)
+{
+    if (method.index >= MAX_METHODS)
+    {
+        // Only reachable after the LOGERR above; keep the request working rather than mislabel it.
+        static thread_local MethodMetrics overflow;
+        overflow = resolveMethodMetrics(method.name);
+        return overflow;
+    }
+    const MethodMetrics *metrics = m_methodMetrics[method.index].load(std::memory_order_acquire);
+    if (metrics != nullptr)
+        return *metrics;
+    // First request of the method in this session. Another thread may be resolving it as well;
+    // the registry hands both the same pointers and the first to publish wins.
+    MethodMetrics *resolved = new MethodMetrics(resolveMethodMetrics(method.name));
+    if (!m_methodMetrics[method.index].compare_exchange_strong(metrics, resolved, std::memory_order_acq_rel))
+    {
+        delete resolved;
+        return *metrics;
+    }
+    return *resolved;
+}
+
+void ThunderInterface::onMsgReceived(Frame frame)
 {
-    ResponseHandler *evtHandler = ResponseHandler::getInstance();
-    LOGINFO(" %s", message.c_str());
+    LOGPAYLOAD(" ", *frame);
     int msgId = 0;
-    if (getMessageId(message, msgId))
+    if (getMessageId(*frame, msgId))
     {
-        evtHandler->addMessageToResponseQueue(msgId, message);
+        mp_responses->addMessageToResponseQueue(msgId, std::move(frame));
     }
     else
     {
-        evtHandler->addMessageToEventQueue(message);
+        mp_responses->addMessageToEventQueue(std::move(frame));
     }
 }
 
-void ThunderInterface::onEventReceived(const Json::Value& event)
+void ThunderInterface::onEventReceived(Frame frame, std::chrono::steady_clock::time_point arrival,
+                                       const JsonValue &message)
 {
-    // Convert JSON event back to string for existing event processing
-    Json::StreamWriterBuilder builder;
-    builder["indentation"] = "";
-    std::ostringstream os;
-    std::unique_ptr<Json::StreamWriter> writer(builder.newStreamWriter());
-    writer->write(event, &os);
-    std::string eventStr = os.str();
+    LOGPAYLOAD("Event received: ", *frame);
 
-    LOGINFO("Event received: %s", eventStr.c_str());
-
-    // Forward to existing event processing system
-    ResponseHandler *evtHandler = ResponseHandler::getInstance();
-    evtHandler->addMessageToEventQueue(eventStr);
+    // Queued as received, the frame is not copied or re-serialized
+    mp_responses->addMessageToEventQueue(std::move(frame), arrival, message);
 }
 
-ThunderInterface::ThunderInterface() : m_isInitialized(false), m_connListener(nullptr), mp_thThread(nullptr)
+ThunderInterface::ThunderInterface(Transport *transport, ResponseHandler *responses, const std::string &device)
+    : m_nextBulk(0), mp_responses(responses), m_ownsResponses(responses == nullptr), m_isInitialized(false),
+      m_deviceLabel(device.empty() ? "" : metricLabel("device", device)), m_connListener(nullptr)
 {
-    mp_handler = new TransportHandler();
+    if (transport == nullptr)
+        transport = new WebSocketTransport(nullptr, device);
+    m_connections.push_back({transport, nullptr, false, nullptr, nullptr});
+    if (m_ownsResponses)
+    {
+        mp_responses = new ResponseHandler(device);
+        mp_responses->initialize();
+    }
 
     const std::string configFilePath = "/opt/appConfig.json";
 	/* Sample appConfig.json format */
@@ -124,7 +246,7 @@ ThunderInterface::ThunderInterface() : m_isInitialized(false), m_connListener(nu
                             config.name = appItem["name"].asString();
                             config.baseurl = appItem["baseurl"].asString();
                             config.deeplinkmethod = appItem.get("deeplinkmethod", "").asString();
-                            g_appConfigList.push_back(config);
+                            m_appConfigList.push_back(config);
 
                             LOGINFO("Loaded app config: %s -> %s (method: %s)",
                                    config.name.c_str(), config.baseurl.c_str(), config.deeplinkmethod.c_str());
@@ -134,7 +256,7 @@ ThunderInterface::ThunderInterface() : m_isInitialized(false), m_connListener(nu
                             LOGWARN("Invalid app config entry - missing name or baseurl field");
                         }
                     }
-                    LOGINFO("Successfully loaded %zu app configurations", g_appConfigList.size());
+                    LOGINFO("Successfully loaded %zu app configurations", m_appConfigList.size());
                 }
                 else
                 {
@@ -159,29 +281,58 @@ ThunderInterface::ThunderInterface() : m_isInitialized(false), m_connListener(nu
         AppConfig netflix = {"Netflix", "https://www.netflix.com", "Netflix.1.systemcommand"};
         AppConfig amazon = {"Amazon", "https://www.amazon.com/gp/video", "PrimeVideo.1.deeplink"};
 
-        g_appConfigList.push_back(youtube);
-        g_appConfigList.push_back(netflix);
-        g_appConfigList.push_back(amazon);
+        m_appConfigList.push_back(youtube);
+        m_appConfigList.push_back(netflix);
+        m_appConfigList.push_back(amazon);
 
         LOGINFO("Loaded default app configurations");
     }
+
+    for (auto &metrics : m_methodMetrics)
+        metrics = nullptr;
+    for (const AppConfig &config : m_appConfigList)
+        m_deeplinkMetrics.push_back(resolveMethodMetrics("deeplink@" + config.name));
+}
+
+void ThunderInterface::addRequestConnection(Transport *transport)
+{
+    m_connections.push_back({transport, nullptr, false, nullptr, nullptr});
 }
 
 int ThunderInterface::initialize()
 {
     LOGTRACE("%s", __FUNCTION__);
-    mp_handler->registerConnectionHandler([this](bool isConnected)
-                                          { connected(isConnected); });
-    mp_handler->registerMessageHandler([this](string message)
-                                       { onMsgReceived(message); });
-
-    // Register event handler for Thunder notifications (messages with "method" but no "id")
-    mp_handler->registerEventHandler([this](const Json::Value& event) {
-        onEventReceived(event);
-    });
+    MetricsRegistry *metrics = MetricsRegistry::getInstance();
+    int status = 0;
+    for (size_t i = 0; i < m_connections.size(); i++)
+    {
+        Connection &conn = m_connections[i];
+        conn.transport->registerConnectionHandler([this, i](bool isConnected)
+                                                  { connected(i, isConnected); });
+        conn.transport->registerMessageHandler([this](Frame frame)
+                                               { onMsgReceived(std::move(frame)); });
+
+        // Register event handler for Thunder notifications (messages with "method" but no "id")
+        conn.transport->registerEventHandler([this](Frame frame, std::chrono::steady_clock::time_point arrival,
+                                                    const JsonValue &message) {
+            onEventReceived(std::move(frame), arrival, message);
+        });
+
+        std::string name = "events";
+        if (i == 1)
+            name = m_connections.size() == 2 ? "requests" : "critical";
+        else if (i > 1)
+            name = "bulk" + (i > 2 ? std::to_string(i - 1) : std::string());
+        const std::string label = joinLabels(m_deviceLabel, metricLabel("connection", name));
+        conn.inflight = metrics->gauge("thunder_connection_inflight", label);
+        conn.requests = metrics->counter("thunder_connection_requests_total", label);
+
+        int rc = conn.transport->initializeTransport();
+        if (status == 0)
+            status = rc;
+    }
 
-    ResponseHandler::getInstance()->registerEventListener(this);
-    int status = mp_handler->initializeTransport();
+    mp_responses->registerEventListener(this);
     return status;
 }
 
@@ -189,30 +340,87 @@ ThunderInterface::~ThunderInterface()
 {
     LOGTRACE("%s", __FUNCTION__);
 
-    if (mp_handler->isConnected())
+    for (Connection &conn : m_connections)
     {
-        mp_handler->disconnect();
-        mp_thThread->join();
+        if (conn.transport->isConnected())
+            conn.transport->disconnect();
+        if (conn.thread != nullptr && conn.thread->joinable())
+            conn.thread->join();
     }
 
-    delete mp_handler;
-    delete mp_thThread;
+    // The event thread may still be calling back into this object; stop it before the transport goes.
+    if (m_ownsResponses)
+        delete mp_responses;
+    for (Connection &conn : m_connections)
+    {
+        delete conn.transport;
+        delete conn.thread;
+    }
+    for (auto &metrics : m_methodMetrics)
+        delete metrics.load();
 }
 void ThunderInterface::setThunderConnectionURL(const std::string &wsurl)
 {
     LOGTRACE("%s", __FUNCTION__);
-    mp_handler->setConnectURL(wsurl);
+    for (Connection &conn : m_connections)
+        conn.transport->setConnectURL(wsurl);
+}
+// Request connections record next to the event connection, in path.1, path.2 and so on.
+bool ThunderInterface::startCapture(const std::string &path, size_t maxBytes)
+{
+    LOGTRACE("%s", __FUNCTION__);
+    bool status = true;
+    for (size_t i = 0; i < m_connections.size(); i++)
+        status = m_connections[i].transport->startCapture(i == 0 ? path : path + "." + std::to_string(i), maxBytes) && status;
+    return status;
+}
+void ThunderInterface::stopCapture()
+{
+    LOGTRACE("%s", __FUNCTION__);
+    for (Connection &conn : m_connections)
+        conn.transport->stopCapture();
+}
+void ThunderInterface::injectFrame(std::string payload)
+{
+    m_connections[0].transport->processPayload(makeFrame(std::move(payload)));
+}
+std::chrono::steady_clock::time_point ThunderInterface::lastDispatchHeartbeat() const
+{
+    return mp_responses->lastHeartbeat();
+}
+bool ThunderInterface::isOverloaded() const
+{
+    return mp_responses->overloaded();
+}
+void ThunderInterface::postToDispatch(std::function<void()> task)
+{
+    mp_responses->postTask(std::move(task));
 }
 void ThunderInterface::connectToThunder()
 {
     LOGTRACE("%s", __FUNCTION__);
-    if (mp_thThread != nullptr)
+    // A connection still closing after a drop is brought back by the next attempt.
+    for (Connection &conn : m_connections)
+        if (!conn.transport->isConnected())
+            connect(conn);
+}
+void ThunderInterface::connect(Connection &conn)
+{
+    if (conn.transport->connectsAsynchronously())
     {
-        // Do we need to join and then delete ?
-        delete mp_thThread;
+        conn.transport->connect();
+        return;
     }
-    auto &handler = mp_handler;
-    mp_thThread = new std::thread([handler]
+    if (conn.thread != nullptr)
+    {
+        // The previous attempt's io loop has returned by the time we retry; reap it so
+        // each retry does not leak a thread and its stack.
+        if (conn.thread->joinable())
+            conn.thread->join();
+        delete conn.thread;
+    }
+    Transport *handler = conn.transport;
+    conn.thread = new std::thread([handler]
                                   { handler->connect(); });
 }
 
@@ -223,12 +431,13 @@ bool ThunderInterface::enableCasting(bool enable)
     LOGTRACE("%s", __FUNCTION__);
     bool status = false;
     int msgId = 0;
-    ResponseHandler *evtHandler = ResponseHandler::getInstance();
     std::string jsonmsg = enableCastingToJson(true, msgId);
-    LOGINFO(" Request : %s", jsonmsg.c_str());
-    if (mp_handler->sendMessage(jsonmsg) == 1) // Success
+    LOGPAYLOAD(" Request : ", jsonmsg);
+    static const ThunderMethod method("org.rdk.Xcast.1.setEnabled");
+    Frame reply;
+    if (invoke(method, jsonmsg, msgId, REQUEST_TIMEOUT_IN_MS, reply) == RequestResult::OK)
     {
-        string response = evtHandler->getRequestStatus(msgId);
+        const string &response = *reply;
         if (checkForThunderErrorResponse(response))
             return false;
         bool retstat = convertResultStringToBool(response, "success", status);
@@ -243,12 +452,13 @@ bool ThunderInterface::isCastingEnabled(string &result)
     bool status = false;
     int msgId = 0;
 
-    ResponseHandler *evtHandler = ResponseHandler::getInstance();
     std::string jsonmsg = getThunderMethodToJson("org.rdk.Xcast.1.getEnabled", msgId);
-    LOGINFO(" Request : %s", jsonmsg.c_str());
-    if (mp_handler->sendMessage(jsonmsg) == 1) // Success
+    LOGPAYLOAD(" Request : ", jsonmsg);
+    static const ThunderMethod method("org.rdk.Xcast.1.getEnabled");
+    Frame reply;
+    if (invoke(method, jsonmsg, msgId, REQUEST_TIMEOUT_IN_MS, reply) == RequestResult::OK)
     {
-        string response = evtHandler->getRequestStatus(msgId);
+        const string &response = *reply;
         if (checkForThunderErrorResponse(response))
             return false;
         getParamFromResult(response, "enabled", result);
@@ -262,13 +472,14 @@ bool ThunderInterface::getFriendlyName(std::string &name)
     bool status = false;
     int msgId = 0;
 
-    ResponseHandler *evtHandler = ResponseHandler::getInstance();
     std::string jsonmsg = getThunderMethodToJson("org.rdk.System.getFriendlyName", msgId);
-    LOGINFO(" Request : %s", jsonmsg.c_str());
+    LOGPAYLOAD(" Request : ", jsonmsg);
 
-    if (mp_handler->sendMessage(jsonmsg) == 1) // Success
+    static const ThunderMethod method("org.rdk.System.getFriendlyName");
+    Frame reply;
+    if (invoke(method, jsonmsg, msgId, REQUEST_TIMEOUT_IN_MS, reply) == RequestResult::OK)
     {
-        string response = evtHandler->getRequestStatus(msgId);
+        const string &response = *reply;
         if (checkForThunderErrorResponse(response))
             return false;
         getParamFromResult(response, "friendlyName", name);
@@ -281,13 +492,14 @@ bool ThunderInterface::setFriendlyName(const std::string &name)
     LOGTRACE("%s", __FUNCTION__);
     bool status = false;
     int msgId = 0;
-    ResponseHandler *evtHandler = ResponseHandler::getInstance();
     std::string jsonmsg = setFriendlyNameToJson(name, msgId);
-    LOGINFO(" Request : %s", jsonmsg.c_str());
+    LOGPAYLOAD(" Request : ", jsonmsg);
 
-    if (mp_handler->sendMessage(jsonmsg) == 1) // Success
+    static const ThunderMethod method("org.rdk.System.setFriendlyName");
+    Frame reply;
+    if (invoke(method, jsonmsg, msgId, REQUEST_TIMEOUT_IN_MS, reply) == RequestResult::OK)
     {
-        string response = evtHandler->getRequestStatus(msgId);
+        const string &response = *reply;
         if (checkForThunderErrorResponse(response))
             return false;
         bool retstat = convertResultStringToBool(response, "success", status);
@@ -302,27 +514,25 @@ bool ThunderInterface::getPluginState(const string &myapp, string &state)
 	bool status = false;
 	int msgId = 0;
 
-	ResponseHandler *evtHandler = ResponseHandler::getInstance();
 	std::string jsonmsg = getThunderMethodToJson("Controller.1.status@" + (myapp == "YouTube" ? "Cobalt" : myapp), msgId);
 
-	if (mp_handler->sendMessage(jsonmsg) == 1) // Success
+	static const ThunderMethod method("Controller.1.status");
+	Frame reply;
+	if (invoke(method, jsonmsg, msgId, 5000, reply) == RequestResult::OK)
 	{
-		string response = evtHandler->getRequestStatus(msgId, 5000);
-
+		const string &response = *reply;
 		if (!isValidJsonResponse(response)) {
 			LOGERR("Invalid or empty response for plugin state request");
 			return status;
 		}
 
-		Json::Value root;
-		Json::CharReaderBuilder builder;
-		std::unique_ptr<Json::CharReader> reader(builder.newCharReader());
-		std::string errs;
-
-		if (reader->parse(response.c_str(), response.c_str() + response.size(), &root, &errs)) {
-			if (root.isMember("result") && root["result"].isArray() && root["result"].size() > 0) {
-				for (const auto& element : root["result"]) {
-					if (element.isMember("callsign") && element["callsign"].asString() == (myapp == "YouTube" ? "Cobalt" : myapp)) {
+		const std::string callsign = (myapp == "YouTube" ? "Cobalt" : myapp);
+		JsonDocument doc;
+		if (doc.parse(response)) {
+			JsonValue result = doc.root()["result"];
+			if (result.isArray() && result.size() > 0) {
+				for (JsonValue element : result) {
+					if (element.isMember("callsign") && element["callsign"].text() == callsign) {
 						if (element.isMember("state")) {
 							state = element["state"].asString();
 							status = true;
@@ -333,7 +543,7 @@ bool ThunderInterface::getPluginState(const string &myapp, string &state)
 				}
 			}
 		} else {
-			LOGERR("Failed to parse JSON response: %s", errs.c_str());
+			LOGERR("Failed to parse JSON response: %s at offset %zu", doc.error(), doc.errorOffset());
 		}
 	}
 	return status;
@@ -345,12 +555,13 @@ bool ThunderInterface::registerXcastApps(const string &appCallsigns)
     bool status = false;
     int msgId = 0;
 
-    ResponseHandler *evtHandler = ResponseHandler::getInstance();
     std::string jsonmsg = getRegisterAppToJson(msgId, appCallsigns);
-    LOGINFO(" Registering Apps  : %s", jsonmsg.c_str());
-    if (mp_handler->sendMessage(jsonmsg) == 1) // Success
+    LOGPAYLOAD(" Registering Apps  : ", jsonmsg);
+    static const ThunderMethod method("org.rdk.Xcast.1.registerApplications");
+    Frame reply;
+    if (invoke(method, jsonmsg, msgId, 3000, reply) == RequestResult::OK)
     {
-         string response = evtHandler->getRequestStatus(msgId, 3000);
+        const string &response = *reply;
         if (checkForThunderErrorResponse(response))
             return false;
          convertResultStringToBool(response, status);
@@ -358,30 +569,70 @@ bool ThunderInterface::registerXcastApps(const string &appCallsigns)
     return status;
 }
 
-bool ThunderInterface::sendMessage(const string jsonmsg, int msgId, int timeout)
+RequestResult ThunderInterface::invoke(const MethodMetrics &metrics, const string &jsonmsg, int msgId, int timeout, Frame &reply)
+{
+    const char *method = metrics.method.c_str();
+    ScopedSpan span(method);
+
+    // Register before sending, otherwise a fast reply can arrive ahead of
+    // getRequestStatus() and be discarded as a late response.
+    if (!mp_responses->admitRequest() || !mp_responses->registerRequest(msgId, metrics.method))
+    {
+        metrics.rejected->inc();
+        return s_lastResult = RequestResult::OVERLOADED;
+    }
+    Connection &conn = route(method);
+    conn.requests->inc();
+    conn.inflight->add();
+    auto start = std::chrono::steady_clock::now();
+    if (conn.transport->sendMessage(jsonmsg) != 1)
+    {
+        conn.inflight->sub();
+        mp_responses->cancelRequest(msgId);
+        metrics.sendFailures->inc();
+        return s_lastResult = RequestResult::SEND_FAILED;
+    }
+
+    reply = mp_responses->getRequestStatus(msgId, timeout);
+    conn.inflight->sub();
+    if (!reply)
+    {
+        metrics.timeouts->inc();
+        return s_lastResult = RequestResult::TIMEOUT;
+    }
+    metrics.rtt->observeSince(start);
+    return s_lastResult = RequestResult::OK;
+}
+
+RequestResult ThunderInterface::lastRequestResult() const
+{
+    return s_lastResult;
+}
+
+bool ThunderInterface::sendMessage(const ThunderMethod &method, const string jsonmsg, int msgId, int timeout)
 {
     bool status = false;
-    ResponseHandler *evtHandler = ResponseHandler::getInstance();
-    LOGINFO(" Request : %s", jsonmsg.c_str());
+    LOGPAYLOAD(" Request : ", jsonmsg);
 
-    if (mp_handler->sendMessage(jsonmsg) == 1) // Success
+    Frame reply;
+    if (invoke(method, jsonmsg, msgId, timeout, reply) == RequestResult::OK)
     {
-        string response = evtHandler->getRequestStatus(msgId, timeout);
+        const string &response = *reply;
         if (checkForThunderErrorResponse(response))
             return false;
         convertResultStringToBool(response, status);
     }
     return status;
 }
-bool ThunderInterface::sendSubscriptionMessage(const string jsonmsg, int msgId, int timeout)
+bool ThunderInterface::sendSubscriptionMessage(const ThunderMethod &method, const string jsonmsg, int msgId, int timeout)
 {
     int status = false;
-    ResponseHandler *evtHandler = ResponseHandler::getInstance();
-    LOGINFO(" Request : %s", jsonmsg.c_str());
+    LOGPAYLOAD(" Request : ", jsonmsg);
 
-    if (mp_handler->sendMessage(jsonmsg) == 1) // Success
+    Frame reply;
+    if (invoke(method, jsonmsg, msgId, timeout, reply) == RequestResult::OK)
     {
-        string response = evtHandler->getRequestStatus(msgId, timeout);
+        const string &response = *reply;
         if (checkForThunderErrorResponse(response))
             return false;
         convertEventSubResponseToInt(response, status);
@@ -391,23 +642,28 @@ bool ThunderInterface::sendSubscriptionMessage(const string jsonmsg, int msgId,
 
 void ThunderInterface::shutdown()
 {
-    mp_handler->disconnect();
-    ResponseHandler::getInstance()->shutdown();
-    mp_thThread->join();
+    for (Connection &conn : m_connections)
+        conn.transport->disconnect();
+    mp_responses->shutdown();
+    for (Connection &conn : m_connections)
+        if (conn.thread != nullptr && conn.thread->joinable())
+            conn.thread->join();
 }
 
 void ThunderInterface::registerEvent(const std::string &event, bool isbinding)
 {
     int msgId = 0;
     bool status = false;
-    std::string callsign = "org.rdk.Xcast.1.";
+    std::string callsign = XCAST_CALLSIGN;
 
     std::string jsonmsg;
     if (isbinding)
         jsonmsg = getSubscribeRequest(callsign, event, msgId);
     else
         jsonmsg = getUnSubscribeRequest(callsign, event, msgId);
-    status = sendMessage(jsonmsg, msgId);
+    static const ThunderMethod registerMethod("org.rdk.Xcast.1.register");
+    static const ThunderMethod unregisterMethod("org.rdk.Xcast.1.unregister");
+    status = sendMessage(isbinding ? registerMethod : unregisterMethod, jsonmsg, msgId);
 
     LOGINFO(" Event %s, response  %d ", event.c_str(), status);
 }
@@ -422,7 +678,15 @@ void ThunderInterface::registerEvent(const std::string &callsignWithVersion, con
 		jsonmsg = getSubscribeRequest(callsignWithVersion, event, msgId);
 	else
 		jsonmsg = getUnSubscribeRequest(callsignWithVersion, event, msgId);
-	status = sendMessage(jsonmsg, msgId);
+	// Subscriptions only go to the Controller and RDKShell.
+	static const ThunderMethod controllerRegister("Controller.1.register");
+	static const ThunderMethod controllerUnregister("Controller.1.unregister");
+	static const ThunderMethod shellRegister("org.rdk.RDKShell.1.register");
+	static const ThunderMethod shellUnregister("org.rdk.RDKShell.1.unregister");
+	if (callsignWithVersion == CONTROLLER_CALLSIGN)
+		status = sendMessage(isbinding ? controllerRegister : controllerUnregister, jsonmsg, msgId);
+	else
+		status = sendMessage(isbinding ? shellRegister : shellUnregister, jsonmsg, msgId);
 
 	LOGINFO(" Event %s, response  %d ", event.c_str(), status);
 }
@@ -456,43 +720,29 @@ void ThunderInterface::onControllerStateChangeEvents(const std::string &event, c
 void ThunderInterface::addControllerStateChangeListener(std::function<void(const std::string &, const std::string &)> callback)
 {
     m_controllerStateChangeListener = callback;
-    registerEvent("Controller.1.", "statechange", true);
+    registerEvent(CONTROLLER_CALLSIGN, "statechange", true);
 }
 
 void ThunderInterface::removeControllerStateChangeListener()
 {
     m_controllerStateChangeListener = nullptr;
-	registerEvent("Controller.1.", "statechange", false);
+	registerEvent(CONTROLLER_CALLSIGN, "statechange", false);
 }
 
 void ThunderInterface::removeRDKShellListener()
 {
     m_rdkShellListener = nullptr;
 
-    registerEvent("org.rdk.RDKShell.1.", "onApplicationActivated", false);
-    registerEvent("org.rdk.RDKShell.1.", "onApplicationLaunched", false);
-    registerEvent("org.rdk.RDKShell.1.", "onApplicationResumed", false);
-    registerEvent("org.rdk.RDKShell.1.", "onApplicationSuspended", false);
-    registerEvent("org.rdk.RDKShell.1.", "onApplicationTerminated", false);
-    registerEvent("org.rdk.RDKShell.1.", "onDestroyed", false);
-    registerEvent("org.rdk.RDKShell.1.", "onLaunched", false);
-    registerEvent("org.rdk.RDKShell.1.", "onSuspended", false);
-    registerEvent("org.rdk.RDKShell.1.", "onPluginSuspended", false);
+    for (const char *event : RDKSHELL_EVENTS)
+        registerEvent(RDKSHELL_CALLSIGN, event, false);
 }
 
 void ThunderInterface::registerRDKShellEvents(std::function<void(const std::string &, const std::string &)> callback)
 {
     m_rdkShellListener = callback;
 
-    registerEvent("org.rdk.RDKShell.1.", "onApplicationActivated", true);
-    registerEvent("org.rdk.RDKShell.1.", "onApplicationLaunched", true);
-    registerEvent("org.rdk.RDKShell.1.", "onApplicationResumed", true);
-    registerEvent("org.rdk.RDKShell.1.", "onApplicationSuspended", true);
-    registerEvent("org.rdk.RDKShell.1.", "onApplicationTerminated", true);
-    registerEvent("org.rdk.RDKShell.1.", "onDestroyed", true);
-    registerEvent("org.rdk.RDKShell.1.", "onLaunched", true);
-    registerEvent("org.rdk.RDKShell.1.", "onSuspended", true);
-    registerEvent("org.rdk.RDKShell.1.", "onPluginSuspended", true);
+    for (const char *event : RDKSHELL_EVENTS)
+        registerEvent(RDKSHELL_CALLSIGN, event, true);
 }
 
 void ThunderInterface::registerDialRequests(std::function<void(DIALEVENTS, const DialParams &)> callback)
@@ -500,35 +750,77 @@ void ThunderInterface::registerDialRequests(std::function<void(DIALEVENTS, const
     m_dialListener = callback;
 
     // Register for events
-    registerEvent("onApplicationHideRequest", true);
-    registerEvent("onApplicationLaunchRequest", true);
-    registerEvent("onApplicationResumeRequest", true);
-    registerEvent("onApplicationStateRequest", true);
-    registerEvent("onApplicationStopRequest", true);
+    for (const char *event : DIAL_EVENTS)
+        registerEvent(event, true);
 }
 
 void ThunderInterface::removeDialListener()
 {
     m_dialListener = nullptr;
 
-    registerEvent("onApplicationHideRequest", false);
-    registerEvent("onApplicationLaunchRequest", false);
-    registerEvent("onApplicationResumeRequest", false);
-    registerEvent("onApplicationStateRequest", false);
-    registerEvent("onApplicationStopRequest", false);
+    for (const char *event : DIAL_EVENTS)
+        registerEvent(event, false);
+}
+
+std::vector<int> ThunderInterface::unsubscribeAll()
+{
+    LOGTRACE("%s", __FUNCTION__);
+    std::vector<int> ids;
+    m_dialListener = nullptr;
+    m_rdkShellListener = nullptr;
+    m_controllerStateChangeListener = nullptr;
+    Transport *eventConn = m_connections[0].transport;
+    if (!eventConn->isConnected())
+        return ids;
+
+    std::vector<std::pair<std::string, std::string>> events;
+    for (const char *event : DIAL_EVENTS)
+        events.emplace_back(XCAST_CALLSIGN, event);
+    for (const char *event : RDKSHELL_EVENTS)
+        events.emplace_back(RDKSHELL_CALLSIGN, event);
+    events.emplace_back(CONTROLLER_CALLSIGN, "statechange");
+
+    for (const auto &event : events)
+    {
+        int msgId = 0;
+        std::string jsonmsg = getUnSubscribeRequest(event.first, event.second, msgId);
+        mp_responses->registerRequest(msgId);
+        if (eventConn->sendMessage(jsonmsg) != 1)
+        {
+            mp_responses->cancelRequest(msgId);
+            continue;
+        }
+        ids.push_back(msgId);
+    }
+    return ids;
+}
+
+size_t ThunderInterface::awaitReplies(const std::vector<int> &ids, std::chrono::steady_clock::time_point deadline)
+{
+    size_t acked = 0;
+    for (int id : ids)
+    {
+        auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+        // A zero timeout still collects a reply that is already in, and drops the entry otherwise.
+        int timeout = left.count() > 0 ? static_cast<int>(left.count()) : 0;
+        if (mp_responses->getRequestStatus(id, timeout))
+            acked++;
+    }
+    return acked;
 }
 
 std::vector<string> &ThunderInterface::getActiveApplications(int timeout)
 {
     int id = 0;
-    ResponseHandler *evtHandler = ResponseHandler::getInstance();
     m_appList.clear();
     string jsonmsg = getClientListToJson(id);
-    LOGINFO("Clients request API : %s", jsonmsg.c_str());
+    LOGPAYLOAD("Clients request API : ", jsonmsg);
 
-    if (mp_handler->sendMessage(jsonmsg) == 1) // Success
+    static const ThunderMethod method("org.rdk.RDKShell.1.getClients");
+    Frame reply;
+    if (invoke(method, jsonmsg, id, timeout, reply) == RequestResult::OK)
     {
-        string response = evtHandler->getRequestStatus(id, timeout);
+        const string &response = *reply;
         if (checkForThunderErrorResponse(response))
             return m_appList;
         convertResultStringToArray(response, "clients", m_appList);
@@ -542,13 +834,14 @@ bool ThunderInterface::setAppState(const std::string &appName, const std::string
 
     int id = 0;
     bool status = false;
-    ResponseHandler *evtHandler = ResponseHandler::getInstance();
     string jsonmsg = setAppStateToJson(appName, appId, state, id);
-    LOGINFO(" State change request API : %s", jsonmsg.c_str());
+    LOGPAYLOAD(" State change request API : ", jsonmsg);
 
-    if (mp_handler->sendMessage(jsonmsg) == 1) // Success
+    static const ThunderMethod method("org.rdk.Xcast.1.setApplicationState");
+    Frame reply;
+    if (invoke(method, jsonmsg, id, REQUEST_TIMEOUT_IN_MS, reply) == RequestResult::OK)
     {
-        string response = evtHandler->getRequestStatus(id);
+        const string &response = *reply;
         if (checkForThunderErrorResponse(response))
             return false;
         convertResultStringToBool(response, status);
@@ -556,6 +849,56 @@ bool ThunderInterface::setAppState(const std::string &appName, const std::string
     return status;
 }
 
+bool ThunderInterface::pushDIALAppState(const std::string &appName, const std::string &appId,
+                                         const std::string &state, std::function<void(bool)> onResult)
+{
+    static const ThunderMethod method("org.rdk.Xcast.1.setApplicationState");
+    const MethodMetrics &metrics = methodMetrics(method);
+    if (!mp_responses->admitRequest())
+    {
+        metrics.rejected->inc();
+        return false;
+    }
+    int id = 0;
+    string jsonmsg = setAppStateToJson(appName, appId, state, id);
+    LOGPAYLOAD(" State push API : ", jsonmsg);
+
+    Connection &conn = route(method.name);
+    auto start = std::chrono::steady_clock::now();
+    Gauge *inflight = conn.inflight;
+    Histogram *rtt = metrics.rtt;
+    Counter *timeouts = metrics.timeouts;
+    bool registered = mp_responses->registerRequest(id, metrics.method, [rtt, timeouts, inflight, start, onResult](Frame reply) {
+        inflight->sub();
+        if (!reply)
+        {
+            timeouts->inc();
+            onResult(false);
+            return;
+        }
+        rtt->observeSince(start);
+        bool status = false;
+        if (!checkForThunderErrorResponse(*reply))
+            convertResultStringToBool(*reply, status);
+        onResult(status);
+    });
+    if (!registered)
+    {
+        metrics.rejected->inc();
+        return false;
+    }
+    conn.requests->inc();
+    conn.inflight->add();
+    if (conn.transport->sendMessage(jsonmsg) != 1)
+    {
+        conn.inflight->sub();
+        mp_responses->cancelRequest(id);
+        metrics.sendFailures->inc();
+        return false;
+    }
+    return true;
+}
+
 bool ThunderInterface::reportDIALAppState(const std::string &appName, const std::string &appId, const std::string &state)
 {
 	if (appName.empty() || state.empty()) {
@@ -590,13 +933,14 @@ bool ThunderInterface::launchPremiumApp(const std::string &appName, int timeout)
     int id = 0;
     bool status = false;
     std::string callsign = (appName == "YouTube") ? "Cobalt" : appName;
-    ResponseHandler *evtHandler = ResponseHandler::getInstance();
     string jsonmsg = launchAppToJson(callsign, id);
-    LOGINFO(" Launch request API : %s", jsonmsg.c_str());
+    LOGPAYLOAD(" Launch request API : ", jsonmsg);
 
-    if (mp_handler->sendMessage(jsonmsg) == 1) // Success
+    static const ThunderMethod method("org.rdk.RDKShell.1.launch");
+    Frame reply;
+    if (invoke(method, jsonmsg, id, timeout, reply) == RequestResult::OK)
     {
-        string response = evtHandler->getRequestStatus(id, timeout);
+        const string &response = *reply;
         if (checkForThunderErrorResponse(response))
             return false;
         bool retStatus = convertResultStringToBool(response, "success", status);
@@ -605,17 +949,36 @@ bool ThunderInterface::launchPremiumApp(const std::string &appName, int timeout)
     return status;
 }
 
+bool ThunderInterface::getSystemFreeMemory(int64_t &freeKb)
+{
+    int id = 0;
+    string jsonmsg = getThunderMethodToJson("org.rdk.RDKShell.1.getSystemMemory", id);
+    LOGPAYLOAD(" System memory request API : ", jsonmsg);
+
+    static const ThunderMethod method("org.rdk.RDKShell.1.getSystemMemory");
+    Frame reply;
+    if (invoke(method, jsonmsg, id, RDKSHELL_TIMEOUT_IN_MS, reply) == RequestResult::OK)
+    {
+        const string &response = *reply;
+        if (checkForThunderErrorResponse(response))
+            return false;
+        return convertResultStringToInt64(response, "freeRam", freeKb);
+    }
+    return false;
+}
+
 bool ThunderInterface::setStandbyBehaviour()
 {
     LOGTRACE("Enabling standby behaviour as active.. ");
     bool status = false;
     int msgId = 0;
-    ResponseHandler *evtHandler = ResponseHandler::getInstance();
     string jsonmsg = setStandbyBehaviourToJson(msgId);
-    LOGINFO(" Standby active API : %s", jsonmsg.c_str());
-    if (mp_handler->sendMessage(jsonmsg) == 1) // Success
+    LOGPAYLOAD(" Standby active API : ", jsonmsg);
+    static const ThunderMethod method("org.rdk.Xcast.1.setStandbyBehavior");
+    Frame reply;
+    if (invoke(method, jsonmsg, msgId, REQUEST_TIMEOUT_IN_MS, reply) == RequestResult::OK)
     {
-         string response = evtHandler->getRequestStatus(msgId);
+        const string &response = *reply;
         if (checkForThunderErrorResponse(response))
             return false;
          convertResultStringToBool(response, status);
@@ -628,13 +991,14 @@ bool ThunderInterface::suspendPremiumApp(const std::string &appName, int timeout
     int id = 0;
     bool status = false;
     std::string callsign = (appName == "YouTube") ? "Cobalt" : appName;
-    ResponseHandler *evtHandler = ResponseHandler::getInstance();
     string jsonmsg = suspendAppToJson(callsign, id);
-    LOGINFO(" Suspend request API : %s", jsonmsg.c_str());
+    LOGPAYLOAD(" Suspend request API : ", jsonmsg);
 
-    if (mp_handler->sendMessage(jsonmsg) == 1) // Success
+    static const ThunderMethod method("org.rdk.RDKShell.1.suspend");
+    Frame reply;
+    if (invoke(method, jsonmsg, id, timeout, reply) == RequestResult::OK)
     {
-        string response = evtHandler->getRequestStatus(id, timeout);
+        const string &response = *reply;
         if (checkForThunderErrorResponse(response))
             return false;
         convertResultStringToBool(response, status);
@@ -647,13 +1011,14 @@ bool ThunderInterface::shutdownPremiumApp(const std::string &appName, int timeou
     int id = 0;
     bool status = false;
     std::string callsign = (appName == "YouTube") ? "Cobalt" : appName;
-    ResponseHandler *evtHandler = ResponseHandler::getInstance();
     string jsonmsg = shutdownAppToJson(callsign, id);
-    LOGINFO(" Stop request API : %s", jsonmsg.c_str());
+    LOGPAYLOAD(" Stop request API : ", jsonmsg);
 
-    if (mp_handler->sendMessage(jsonmsg) == 1) // Success
+    static const ThunderMethod method("org.rdk.RDKShell.1.destroy");
+    Frame reply;
+    if (invoke(method, jsonmsg, id, timeout, reply) == RequestResult::OK)
     {
-        string response = evtHandler->getRequestStatus(id, timeout);
+        const string &response = *reply;
         if (checkForThunderErrorResponse(response))
             return false;
         convertResultStringToBool(response, status);
@@ -663,13 +1028,19 @@ bool ThunderInterface::shutdownPremiumApp(const std::string &appName, int timeou
 bool ThunderInterface::sendDeepLinkRequest(const DialParams &dialParams)
 {
     int id = 0;
-    ResponseHandler *evtHandler = ResponseHandler::getInstance();
-    string jsonmsg = sendDeepLinkToJson(dialParams, id);
-    LOGINFO(" Deep link request API : %s", jsonmsg.c_str());
-
-    if (mp_handler->sendMessage(jsonmsg) == 1) // Success
+    string jsonmsg = sendDeepLinkToJson(dialParams, m_appConfigList, id);
+    LOGPAYLOAD(" Deep link request API : ", jsonmsg);
+
+    // The deeplink method is per app (appConfig.json); label by app to keep the set bounded.
+    size_t app = 0;
+    while (app < m_appConfigList.size() && m_appConfigList[app].name != dialParams.appName)
+        app++;
+    if (app == m_appConfigList.size())
+        return false;
+    Frame reply;
+    if (invoke(m_deeplinkMetrics[app], jsonmsg, id, REQUEST_TIMEOUT_IN_MS, reply) == RequestResult::OK)
     {
-        string response = evtHandler->getRequestStatus(id);
+        const string &response = *reply;
         if (checkForThunderErrorResponse(response))
             return false;
         return isJsonRpcResultNull(response);
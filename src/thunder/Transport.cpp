@@ -0,0 +1,86 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2022 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_MODULE LOG_MODULE_TRANSPORT
+
+#include "Transport.h"
+#include "JsonDocument.h"
+#include "EventUtils.h"
+
+void Transport::registerConnectionHandler(std::function<void(bool)> callback)
+{
+    m_conHandler = callback;
+}
+void Transport::registerMessageHandler(MessageCallback callback)
+{
+    m_msgHandler = callback;
+}
+
+void Transport::registerEventHandler(EventCallback callback)
+{
+    m_eventHandler = callback;
+}
+
+bool Transport::startCapture(const std::string &path, size_t maxBytes)
+{
+    return m_recorder.open(path, maxBytes);
+}
+
+void Transport::stopCapture()
+{
+    m_recorder.close();
+}
+
+void Transport::processPayload(Frame frame, std::chrono::steady_clock::time_point arrival)
+{
+    const std::string &payload = *frame;
+    if (tdebug)
+        LOGTRACE("[Transport::processPayload] %s", payload.c_str());
+
+    // Only routing is decided here; the frame itself is handed on untouched.
+    JsonDocument message;
+    if (message.parse(payload)) {
+        JsonValue root = message.root();
+        if (root.isMember("id")) {
+            if (nullptr != m_msgHandler) {
+                m_msgHandler(std::move(frame));
+            }
+        } else if (root.isMember("method")) {
+            if (tdebug) {
+                LOGTRACE("[Transport::processPayload] Event notification: %s", root["method"].asString().c_str());
+            }
+            if (nullptr != m_eventHandler) {
+                m_eventHandler(std::move(frame), arrival, root);
+            }
+        } else {
+            if (tdebug) {
+                LOGERR("[Transport::processPayload] Unknown message format: %s",
+                       payload.c_str());
+            }
+        }
+    } else {
+        if (tdebug) {
+            LOGERR("[Transport::processPayload] JSON parsing failed: %s at offset %zu", message.error(),
+                   message.errorOffset());
+        }
+        if (nullptr != m_msgHandler) {
+            m_msgHandler(std::move(frame));
+        }
+    }
+}
@@ -17,15 +17,29 @@
  * limitations under the License.
  */
 
+#define LOG_MODULE LOG_MODULE_TRANSPORT
+
 #include "TransportHandler.h"
 #include "EventUtils.h"
+#include "Metrics.h"
 #include <thread>
 #include <string>
-#include <memory>
-#include "json/json.h"
 
 #include <iostream>
 
+TransportHandler::TransportHandler(IoServicePool *pool, const std::string &device)
+    : mp_pool(pool), m_heartbeat(device.empty() ? "" : metricLabel("device", device))
+{
+    MetricsRegistry *metrics = MetricsRegistry::getInstance();
+    const std::string label = device.empty() ? "" : metricLabel("device", device);
+    mp_framesOut = metrics->counter("ws_frames_out_total", label);
+    mp_bytesOut = metrics->counter("ws_bytes_out_total", label);
+    mp_framesIn = metrics->counter("ws_frames_in_total", label);
+    mp_bytesIn = metrics->counter("ws_bytes_in_total", label);
+    // Created here rather than by the first connection on an io thread.
+    MessagePoolStats::getInstance();
+}
+
 int TransportHandler::initializeTransport()
 {
 
@@ -44,7 +58,11 @@ int TransportHandler::initializeTransport()
         // m_client.set_error_channels(websocketpp::log::elevel::all);
 
         // Initialize ASIO
-        m_client.init_asio();
+        if (mp_pool != nullptr)
+            m_client.init_asio(&mp_pool->ioService());
+        else
+            m_client.init_asio();
+        m_client.set_close_handshake_timeout(CLOSE_HANDSHAKE_TIMEOUT_IN_MS);
 
         // Register our handlers
         m_client.set_open_handler([&, this](websocketpp::connection_hdl hdl)
@@ -56,6 +74,8 @@ int TransportHandler::initializeTransport()
                                      { processResponse(hdl, msg); });
         m_client.set_close_handler([&, this](websocketpp::connection_hdl hdl)
                                    { disconnected(hdl); });
+        m_client.set_pong_handler([this](websocketpp::connection_hdl, std::string payload)
+                                  { m_heartbeat.pong(payload); });
         LOGTRACE("[TransportHandler::initialize] Connecting to %s", m_wsUrl.c_str());
     }
     catch (const std::exception &e)
@@ -83,26 +103,54 @@ void TransportHandler::connect()
         m_connectionState.store(ConnectionState::CONNECTING);
     }
 
+    // run() leaves the io_service stopped; it must be reset before another attempt.
+    // A shared pool's io_service never stops, and resetting it would disturb other devices.
+    if (mp_pool == nullptr)
+        m_client.reset();
+
     websocketpp::lib::error_code ec;
     wsclient::connection_ptr con = m_client.get_connection(m_wsUrl, ec);
+    if (ec) {
+        LOGERR("[TransportHandler::connect] %s: %s", m_wsUrl.c_str(), ec.message().c_str());
+        {
+            std::lock_guard<std::mutex> lock(m_stateMutex);
+            m_connectionState.store(ConnectionState::ERROR_STATE);
+        }
+        m_stateChanged.notify_all();
+        return;
+    }
     m_client.connect(con);
 
-    m_client.run();
+    if (mp_pool == nullptr)
+        m_client.run();
 }
 
-int TransportHandler::sendMessage(std::string message)
+int TransportHandler::sendMessage(const std::string &message)
 {
     if (tdebug)
         LOGTRACE("[TransportHandler::sendMessage] Sending %s", message.c_str());
 
     bool connected = (m_connectionState.load() == ConnectionState::CONNECTED);
     if (connected)
+    {
+        m_recorder.record(FrameDirection::OUTBOUND, message);
         m_client.send(m_wsHdl, message, websocketpp::frame::opcode::text);
+        mp_framesOut->inc();
+        mp_bytesOut->inc(message.size());
+    }
     return connected ? 1 : -1;
 }
 void TransportHandler::disconnect()
 {
-    m_client.close(m_wsHdl, websocketpp::close::status::normal, "");
+    // The connection may never have opened or may already be gone; neither is an error here.
+    websocketpp::lib::error_code ec;
+    m_client.close(m_wsHdl, websocketpp::close::status::normal, "", ec);
+    if (ec && tdebug)
+        LOGTRACE("[TransportHandler::disconnect] %s", ec.message().c_str());
+    // A connect still in progress would keep our own io loop, and the thread joining it,
+    // busy until its handshake timeout; there is nothing to close cleanly yet.
+    if (mp_pool == nullptr && m_connectionState.load() != ConnectionState::CONNECTED)
+        m_client.stop();
 }
 void TransportHandler::connected(websocketpp::connection_hdl hdl)
 {
@@ -116,6 +164,9 @@ void TransportHandler::connected(websocketpp::connection_hdl hdl)
     }
     m_stateChanged.notify_all();
 
+    m_heartbeat.reset();
+    scheduleHeartbeat();
+
     if (nullptr != m_conHandler)
         m_conHandler(true);
 }
@@ -138,54 +189,22 @@ void TransportHandler::connectFailed(websocketpp::connection_hdl hdl)
 void TransportHandler::processResponse(websocketpp::connection_hdl hdl, message_ptr msg)
 {
     (void)hdl;
+    auto arrival = std::chrono::steady_clock::now();
 
-    if (tdebug)
-        LOGTRACE("[TransportHandler::processResponse] %s", msg->get_payload().c_str());
-
-    Json::Value message;
-    Json::CharReaderBuilder builder;
-    std::unique_ptr<Json::CharReader> reader(builder.newCharReader());
-    std::string errors;
-
-    std::string payload = msg->get_payload();
-    bool parsingSuccessful = reader->parse(
-        payload.c_str(),
-        payload.c_str() + payload.size(),
-        &message,
-        &errors);
-
-    if (parsingSuccessful) {
-        if (message.isMember("id")) {
-            if (nullptr != m_msgHandler) {
-                m_msgHandler(msg->get_payload());
-            }
-        } else if (message.isMember("method")) {
-            if (nullptr != m_eventHandler) {
-                m_eventHandler(message);
-            }
-            if (tdebug) {
-                LOGTRACE("[TransportHandler::processResponse] Event notification: %s",
-                        message.get("method", "unknown").asString().c_str());
-            }
-        } else {
-            if (tdebug) {
-                LOGERR("[TransportHandler::processResponse] Unknown message format: %s",
-                       msg->get_payload().c_str());
-            }
-        }
-    } else {
-        if (tdebug) {
-            LOGERR("[TransportHandler::processResponse] JSON parsing failed: %s", errors.c_str());
-        }
-        if (nullptr != m_msgHandler) {
-            m_msgHandler(msg->get_payload());
-        }
-    }
+    mp_framesIn->inc();
+    mp_bytesIn->inc(msg->get_payload().size());
+
+    m_recorder.record(FrameDirection::INBOUND, msg->get_payload());
+
+    // The frame shares ownership of the message, so the payload lives as long as anyone holds it.
+    processPayload(Frame(msg, &msg->get_payload()), arrival);
 }
 void TransportHandler::disconnected(websocketpp::connection_hdl hdl)
 {
     (void)hdl;
 
+    // Our own io loop only returns once no timer is left pending.
+    cancelHeartbeat();
     {
         std::lock_guard<std::mutex> lock(m_stateMutex);
         m_connectionState.store(ConnectionState::DISCONNECTED);
@@ -194,21 +213,48 @@ void TransportHandler::disconnected(websocketpp::connection_hdl hdl)
 
     if (tdebug)
         LOGTRACE("[TransportHandler::disconnected] Connection closed");
+    if (nullptr != m_conHandler)
+        m_conHandler(false);
 }
-void TransportHandler::registerConnectionHandler(std::function<void(bool)> callback)
+void TransportHandler::scheduleHeartbeat()
 {
-    m_conHandler = callback;
+    auto interval = Heartbeat::interval();
+    if (interval.count() == 0)
+        return;
+    std::lock_guard<std::mutex> lock(m_heartbeatMutex);
+    if (!mp_heartbeatTimer)
+        mp_heartbeatTimer.reset(new boost::asio::steady_timer(m_client.get_io_service()));
+    mp_heartbeatTimer->expires_after(interval);
+    mp_heartbeatTimer->async_wait([this](const boost::system::error_code &ec) {
+        if (!ec)
+            sendHeartbeat();
+    });
 }
-void TransportHandler::registerMessageHandler(std::function<void(const std::string)> callback)
+void TransportHandler::cancelHeartbeat()
 {
-    m_msgHandler = callback;
+    std::lock_guard<std::mutex> lock(m_heartbeatMutex);
+    if (mp_heartbeatTimer)
+        mp_heartbeatTimer->cancel();
 }
-
-void TransportHandler::registerEventHandler(EventCallback callback)
+void TransportHandler::sendHeartbeat()
 {
-    m_eventHandler = callback;
-}
+    if (m_connectionState.load() != ConnectionState::CONNECTED)
+        return;
 
+    websocketpp::lib::error_code ec;
+    std::string payload;
+    if (!m_heartbeat.tick(payload)) {
+        // The close handshake gets CLOSE_HANDSHAKE_TIMEOUT_IN_MS, then the socket is dropped and
+        // disconnected() fails the pending requests.
+        LOGERR("[TransportHandler::sendHeartbeat] %s stalled, closing the connection", m_wsUrl.c_str());
+        m_client.close(m_wsHdl, websocketpp::close::status::going_away, "heartbeat timeout", ec);
+        return;
+    }
+    m_client.ping(m_wsHdl, payload, ec);
+    if (ec && tdebug)
+        LOGTRACE("[TransportHandler::sendHeartbeat] %s", ec.message().c_str());
+    scheduleHeartbeat();
+}
 bool TransportHandler::waitForConnection(std::chrono::milliseconds timeout)
 {
     std::unique_lock<std::mutex> lock(m_stateMutex);
@@ -0,0 +1,421 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2022 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <elf.h>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <sstream>
+
+#include "ClientProcess.h"
+#include "MockThunder.h"
+
+#ifndef XDIALTESTER_PATH
+#define XDIALTESTER_PATH "xdialtester"
+#endif
+
+using Clock = std::chrono::steady_clock;
+
+/*
+ * A scripted DIAL request is complete when the client makes the call that ends its
+ * handling: the deep link for a launch, setApplicationState for a state request.
+ * hide, stop and resume may legitimately end without any call (app already in the
+ * requested state), so each is followed by a state probe and completes with the probe.
+ */
+struct Operation {
+    std::string kind;
+    std::string app;
+    std::string probeId;
+    Clock::time_point emitted;
+    bool done;
+};
+
+struct BenchState {
+    std::mutex lock;
+    std::condition_variable changed;
+    std::vector<Operation> ops;
+    std::map<std::string, std::deque<size_t>> pendingLaunches;  // device/app -> op index
+    std::map<std::string, size_t> pendingProbes;                // probe id -> op index
+    std::map<std::string, std::vector<int64_t>> latencyUs;      // kind -> samples
+    size_t completed = 0;
+    Clock::time_point lastCompletion;
+    size_t readyDevices = 0;
+};
+
+// Outcome of one run of one client against a given number of devices.
+struct RunResult {
+    std::string client;
+    long imageKb;           // loaded size of the client binary, without debug info
+    long startupMs;         // spawn until every device registered its DIAL apps
+    size_t devices;
+    int events;
+    size_t completed;
+    double elapsed;
+    std::vector<int64_t> all;
+    long rssKb;
+    long threads;
+    long contextSwitches;   // voluntary plus involuntary, over the client's lifetime
+    long shutdownMs;        // SIGTERM to exit; -1 if the client had to be killed
+};
+
+static void complete(BenchState &state, size_t index)
+{
+    Operation &op = state.ops[index];
+    if (op.done)
+        return;
+    op.done = true;
+    state.lastCompletion = Clock::now();
+    state.latencyUs[op.kind].push_back(
+        std::chrono::duration_cast<std::chrono::microseconds>(state.lastCompletion - op.emitted).count());
+    state.completed++;
+    state.changed.notify_all();
+}
+
+static std::string launchKey(size_t device, const std::string &app)
+{
+    return std::to_string(device) + "/" + app;
+}
+
+static void onRequest(BenchState &state, size_t device, const std::string &method, const Json::Value &params)
+{
+    std::lock_guard<std::mutex> guard(state.lock);
+    if (method == "org.rdk.Xcast.1.registerApplications") {
+        state.readyDevices++;
+        state.changed.notify_all();
+    } else if (method == "org.rdk.Xcast.1.setApplicationState") {
+        auto it = state.pendingProbes.find(params.get("applicationId", "").asString());
+        if (it != state.pendingProbes.end()) {
+            complete(state, it->second);
+            state.pendingProbes.erase(it);
+        }
+    } else if (method.find(".deeplink") != std::string::npos || method.find(".systemcommand") != std::string::npos) {
+        std::string callsign = method.substr(0, method.find('.'));
+        std::string app = (callsign == "Cobalt") ? "YouTube" : (callsign == "PrimeVideo") ? "Amazon" : callsign;
+        auto &launches = state.pendingLaunches[launchKey(device, app)];
+        if (!launches.empty()) {
+            complete(state, launches.front());
+            launches.pop_front();
+        }
+    }
+}
+
+static std::vector<std::string> split(const std::string &list)
+{
+    std::vector<std::string> out;
+    std::stringstream ss(list);
+    std::string item;
+    while (std::getline(ss, item, ','))
+        if (!item.empty())
+            out.push_back(item);
+    return out;
+}
+
+static double percentileMs(std::vector<int64_t> &samples, double q)
+{
+    if (samples.empty())
+        return 0;
+    std::sort(samples.begin(), samples.end());
+    size_t rank = static_cast<size_t>(std::ceil(q * samples.size()));
+    return samples[std::min(samples.size(), std::max<size_t>(rank, 1)) - 1] / 1000.0;
+}
+
+// Reads a "Key:   value kB" line of /proc/<pid>/status; -1 when unavailable.
+static long procStatus(pid_t pid, const char *key)
+{
+    std::ifstream status("/proc/" + std::to_string(pid) + "/status");
+    std::string line;
+    size_t keyLen = strlen(key);
+    while (std::getline(status, line)) {
+        if (line.compare(0, keyLen, key) == 0 && line.size() > keyLen && line[keyLen] == ':')
+            return strtol(line.c_str() + keyLen + 1, nullptr, 10);
+    }
+    return -1;
+}
+
+// Sum of the loadable segments of an ELF64 binary, i.e. what is mapped when it runs; -1 if unreadable.
+static long loadedImageKb(const std::string &path)
+{
+    std::ifstream file(path, std::ios::binary);
+    Elf64_Ehdr header;
+    if (!file.read(reinterpret_cast<char *>(&header), sizeof(header)) || memcmp(header.e_ident, ELFMAG, SELFMAG) != 0 ||
+        header.e_ident[EI_CLASS] != ELFCLASS64)
+        return -1;
+    uint64_t bytes = 0;
+    for (int i = 0; i < header.e_phnum; i++) {
+        Elf64_Phdr segment;
+        file.seekg(header.e_phoff + static_cast<uint64_t>(i) * header.e_phentsize);
+        if (!file.read(reinterpret_cast<char *>(&segment), sizeof(segment)))
+            return -1;
+        if (segment.p_type == PT_LOAD)
+            bytes += segment.p_memsz;
+    }
+    return static_cast<long>(bytes / 1024);
+}
+
+struct BenchOptions {
+    MockThunderConfig config;
+    std::vector<std::string> clientPaths = {XDIALTESTER_PATH};
+    std::vector<std::string> script = {"launch", "hide", "state", "stop"};
+    std::vector<std::string> apps = {"YouTube", "Netflix", "Amazon"};
+    std::vector<std::string> clientArgs;
+    int events = 200;
+    double rate = 0;
+    int timeoutSec = 120;
+    bool verbose = false;
+};
+
+/*
+ * Starts one mock per device on consecutive ports from config.port and a single client
+ * driving all of them. Events are spread round robin over the devices; rate is the total.
+ */
+static bool runBench(const BenchOptions &options, const std::string &clientPath, size_t devices, RunResult &result)
+{
+    BenchState state;
+    std::vector<std::unique_ptr<MockThunder>> mocks;
+    std::string deviceList;
+    for (size_t d = 0; d < devices; d++) {
+        MockThunderConfig config = options.config;
+        config.port = static_cast<uint16_t>(options.config.port + d);
+        config.seed = options.config.seed + static_cast<unsigned>(d);
+        mocks.emplace_back(new MockThunder(config));
+        mocks.back()->setRequestObserver([&state, d](const std::string &method, const Json::Value &params)
+                                         { onRequest(state, d, method, params); });
+        if (!mocks.back()->start())
+            return false;
+        if (!deviceList.empty())
+            deviceList += ",";
+        deviceList += "dev" + std::to_string(d) + "=ws://127.0.0.1:" + std::to_string(config.port) + "/jsonrpc";
+    }
+
+    std::vector<std::string> clientArgs = options.clientArgs;
+    clientArgs.insert(clientArgs.begin(), "--stats-socket=");
+    uint16_t clientPort = options.config.port;
+    if (devices > 1) {
+        clientArgs.insert(clientArgs.begin(), "--devices=" + deviceList);
+        clientPort = 0;
+    }
+    auto spawned = Clock::now();
+    pid_t client = spawnClient(clientPath, clientPort, clientArgs, options.verbose);
+    if (client < 0) {
+        fprintf(stderr, "Failed to start %s\n", clientPath.c_str());
+        return false;
+    }
+
+    {
+        std::unique_lock<std::mutex> guard(state.lock);
+        auto startup = std::chrono::seconds(30 + devices / 4);
+        if (!state.changed.wait_for(guard, startup, [&state, devices] { return state.readyDevices >= devices; })) {
+            fprintf(stderr, "xdialtester (%s) brought up %zu of %zu devices within %lld s\n",
+                    clientPath.c_str(), state.readyDevices, devices,
+                    static_cast<long long>(startup.count()));
+            guard.unlock();
+            stopClient(client);
+            return false;
+        }
+        result.startupMs = std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - spawned).count();
+        state.ops.reserve(options.events);
+    }
+
+    const std::vector<std::string> &script = options.script;
+    const std::vector<std::string> &apps = options.apps;
+    auto start = Clock::now();
+    for (int n = 0; n < options.events; n++) {
+        if (options.rate > 0)
+            std::this_thread::sleep_until(start + std::chrono::microseconds(static_cast<int64_t>(n * 1e6 / options.rate)));
+
+        size_t device = n % devices;
+        int step = n / static_cast<int>(devices);
+        const std::string &kind = script[step % script.size()];
+        const std::string &app = apps[(step / script.size()) % apps.size()];
+        std::string opId = "bench-" + std::to_string(n);
+        {
+            std::lock_guard<std::mutex> guard(state.lock);
+            state.ops.push_back({kind, app, opId, Clock::now(), false});
+            if (kind == "launch")
+                state.pendingLaunches[launchKey(device, app)].push_back(n);
+            else
+                state.pendingProbes[opId] = n;
+        }
+        MockThunder &mock = *mocks[device];
+        if (kind == "state") {
+            mock.emitDialEvent(MockThunder::dialEventName(kind), app, opId);
+        } else if (kind == "launch") {
+            mock.emitDialEvent(MockThunder::dialEventName(kind), app, opId, "v=bench");
+        } else {
+            mock.emitDialEvent(MockThunder::dialEventName(kind), app, "");
+            mock.emitDialEvent(MockThunder::dialEventName("state"), app, opId);
+        }
+    }
+
+    {
+        std::unique_lock<std::mutex> guard(state.lock);
+        state.changed.wait_for(guard, std::chrono::seconds(options.timeoutSec),
+                               [&state, &options] { return state.completed == static_cast<size_t>(options.events); });
+    }
+    result.rssKb = procStatus(client, "VmRSS");
+    result.threads = procStatus(client, "Threads");
+    result.contextSwitches = procStatus(client, "voluntary_ctxt_switches") +
+                             procStatus(client, "nonvoluntary_ctxt_switches");
+    result.shutdownMs = stopClient(client);
+    for (auto &mock : mocks)
+        mock->stop();
+
+    std::lock_guard<std::mutex> guard(state.lock);
+    result.client = clientPath;
+    result.imageKb = loadedImageKb(clientPath);
+    result.devices = devices;
+    result.events = options.events;
+    result.completed = state.completed;
+    result.elapsed = std::chrono::duration<double>(
+        (state.completed ? state.lastCompletion : Clock::now()) - start).count();
+    if (devices > 1)
+        printf("devices: %zu\n", devices);
+    printf("events: %d  completed: %zu  failed: %zu  elapsed: %.3f s  throughput: %.2f casts/s\n",
+           result.events, result.completed, result.events - result.completed, result.elapsed,
+           result.elapsed > 0 ? result.completed / result.elapsed : 0.0);
+    printf("client: %s  image %ld kB  startup %ld ms  rss %ld kB  threads %ld  context switches %ld  shutdown %ld ms\n",
+           clientPath.c_str(), result.imageKb, result.startupMs, result.rssKb, result.threads, result.contextSwitches,
+           result.shutdownMs);
+    printf("%-8s %8s %10s %10s %10s %10s\n", "kind", "count", "p50 ms", "p99 ms", "p999 ms", "max ms");
+    result.all.clear();
+    for (auto &entry : state.latencyUs) {
+        auto &samples = entry.second;
+        result.all.insert(result.all.end(), samples.begin(), samples.end());
+        printf("%-8s %8zu %10.2f %10.2f %10.2f %10.2f\n", entry.first.c_str(), samples.size(),
+               percentileMs(samples, 0.50), percentileMs(samples, 0.99), percentileMs(samples, 0.999),
+               percentileMs(samples, 1.0));
+    }
+    printf("%-8s %8zu %10.2f %10.2f %10.2f %10.2f\n", "all", result.all.size(), percentileMs(result.all, 0.50),
+           percentileMs(result.all, 0.99), percentileMs(result.all, 0.999), percentileMs(result.all, 1.0));
+    return true;
+}
+
+/***
+ * Drives a scripted storm of DIAL requests through xdialtester and the mock Thunder
+ * endpoint and reports cast latency percentiles and throughput.
+ * --devices=1,4,16 repeats the run with one client driving that many mock devices
+ * (ports port..port+N-1) and prints the scaling curve with client RSS, thread count and
+ * context switches. Pass "-- --single-thread" to measure the single thread client.
+ * --xdialtester=a,b runs every device count with each client binary in turn, e.g. a websocketpp
+ * and an epoll (-DEPOLL_WEBSOCKET=ON) build, and prints them side by side: loaded image size,
+ * startup time, RSS and latency.
+ * Usage: xdialtester_bench [--xdialtester=path,...] [--port=19998] [--events=N] [--rate=events/s]
+ *                          [--script=launch,hide,state,stop] [--apps=YouTube,Netflix,Amazon]
+ *                          [--latency-ms=N] [--jitter-ms=N] [--drop-rate=R] [--launch-ms=N] [--seed=N]
+ *                          [--devices=N,...] [--timeout-s=N] [--verbose] [-- <extra xdialtester args>]
+ */
+int main(int argc, char *argv[])
+{
+    BenchOptions options;
+    options.config.port = 19998;
+    std::vector<size_t> deviceCounts = {1};
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        std::string value = arg.substr(arg.find("=") + 1);
+        if (arg == "--") {
+            options.clientArgs.assign(argv + i + 1, argv + argc);
+            break;
+        } else if (arg.find("--xdialtester=") == 0) {
+            options.clientPaths = split(value);
+        } else if (arg.find("--port=") == 0) {
+            options.config.port = static_cast<uint16_t>(atoi(value.c_str()));
+        } else if (arg.find("--events=") == 0) {
+            options.events = atoi(value.c_str());
+        } else if (arg.find("--rate=") == 0) {
+            options.rate = atof(value.c_str());
+        } else if (arg.find("--script=") == 0) {
+            options.script = split(value);
+        } else if (arg.find("--apps=") == 0) {
+            options.apps = split(value);
+        } else if (arg.find("--latency-ms=") == 0) {
+            options.config.latencyMs = atoi(value.c_str());
+        } else if (arg.find("--jitter-ms=") == 0) {
+            options.config.jitterMs = atoi(value.c_str());
+        } else if (arg.find("--drop-rate=") == 0) {
+            options.config.dropRate = atof(value.c_str());
+        } else if (arg.find("--launch-ms=") == 0) {
+            options.config.launchMs = atoi(value.c_str());
+        } else if (arg.find("--seed=") == 0) {
+            options.config.seed = static_cast<unsigned>(strtoul(value.c_str(), nullptr, 10));
+        } else if (arg.find("--devices=") == 0) {
+            deviceCounts.clear();
+            for (const auto &count : split(value))
+                deviceCounts.push_back(strtoul(count.c_str(), nullptr, 10));
+        } else if (arg.find("--timeout-s=") == 0) {
+            options.timeoutSec = atoi(value.c_str());
+        } else if (arg == "--verbose") {
+            options.verbose = true;
+        } else {
+            fprintf(stderr, "Invalid argument %s\n", arg.c_str());
+            return -1;
+        }
+    }
+    for (const auto &kind : options.script) {
+        if (MockThunder::dialEventName(kind) == nullptr) {
+            fprintf(stderr, "Unknown script step %s; use launch, hide, resume, stop or state\n", kind.c_str());
+            return -1;
+        }
+    }
+    if (options.script.empty() || options.apps.empty() || options.clientPaths.empty() || options.events <= 0 ||
+        deviceCounts.empty() ||
+        std::find(deviceCounts.begin(), deviceCounts.end(), 0u) != deviceCounts.end()) {
+        fprintf(stderr, "Nothing to run\n");
+        return -1;
+    }
+
+    std::vector<RunResult> results;
+    int status = 0;
+    for (size_t devices : deviceCounts) {
+        for (const auto &clientPath : options.clientPaths) {
+            RunResult result;
+            if (!runBench(options, clientPath, devices, result))
+                return -1;
+            if (result.completed != static_cast<size_t>(result.events))
+                status = 1;
+            results.push_back(std::move(result));
+        }
+    }
+
+    if (options.clientPaths.size() > 1) {
+        printf("\n%-40s %8s %10s %10s %10s %10s %10s\n", "client", "devices", "image kB", "startup ms", "rss kB",
+               "p50 ms", "p99 ms");
+        for (auto &r : results) {
+            printf("%-40s %8zu %10ld %10ld %10ld %10.2f %10.2f\n", r.client.c_str(), r.devices, r.imageKb, r.startupMs,
+                   r.rssKb, percentileMs(r.all, 0.50), percentileMs(r.all, 0.99));
+        }
+    } else if (results.size() > 1) {
+        printf("\n%8s %12s %10s %10s %12s %8s %10s %12s\n", "devices", "casts/s", "p50 ms", "p99 ms", "rss kB",
+               "threads", "ctx sw", "shutdown ms");
+        for (auto &r : results) {
+            printf("%8zu %12.2f %10.2f %10.2f %12ld %8ld %10ld %12ld\n", r.devices,
+                   r.elapsed > 0 ? r.completed / r.elapsed : 0.0, percentileMs(r.all, 0.50), percentileMs(r.all, 0.99),
+                   r.rssKb, r.threads, r.contextSwitches, r.shutdownMs);
+        }
+    }
+    return status;
+}
@@ -0,0 +1,65 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2022 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <chrono>
+#include <csignal>
+#include <cstdint>
+#include <fcntl.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "ClientProcess.h"
+
+pid_t spawnClient(const std::string &path, uint16_t port, const std::vector<std::string> &extraArgs, bool verbose)
+{
+    std::vector<std::string> args = {path};
+    if (port != 0)
+        args.push_back("--thunder-url=ws://127.0.0.1:" + std::to_string(port) + "/jsonrpc");
+    args.insert(args.end(), extraArgs.begin(), extraArgs.end());
+
+    pid_t pid = fork();
+    if (pid == 0) {
+        if (!verbose) {
+            int devnull = open("/dev/null", O_WRONLY);
+            dup2(devnull, STDOUT_FILENO);
+            dup2(devnull, STDERR_FILENO);
+        }
+        std::vector<char *> argv;
+        for (auto &arg : args)
+            argv.push_back(&arg[0]);
+        argv.push_back(nullptr);
+        execv(argv[0], argv.data());
+        _exit(127);
+    }
+    return pid;
+}
+
+long stopClient(pid_t pid)
+{
+    auto start = std::chrono::steady_clock::now();
+    kill(pid, SIGTERM);
+    for (int i = 0; i < 5000; i++) {
+        if (waitpid(pid, nullptr, WNOHANG) == pid)
+            return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+        usleep(1000);
+    }
+    kill(pid, SIGKILL);
+    waitpid(pid, nullptr, 0);
+    return -1;
+}
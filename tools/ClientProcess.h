@@ -0,0 +1,33 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2022 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <sys/types.h>
+#include <vector>
+
+// Runs xdialtester against the mock on 127.0.0.1:port with the given extra arguments; port 0
+// leaves the endpoints to extraArgs (--devices). Output goes to /dev/null unless verbose.
+// Returns the child pid or -1.
+pid_t spawnClient(const std::string &path, uint16_t port, const std::vector<std::string> &extraArgs, bool verbose);
+
+// SIGTERM, then SIGKILL if the client has not exited within 5 s. Returns the ms from
+// SIGTERM until the client was reaped, or -1 if it had to be killed.
+long stopClient(pid_t pid);
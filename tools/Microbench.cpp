@@ -0,0 +1,578 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2022 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <malloc.h>
+#include <map>
+#include <memory>
+#include <new>
+#include <sstream>
+#include <thread>
+#include <vector>
+#include "json/json.h"
+
+#include "ProtocolHandler.h"
+#include "JsonDocument.h"
+#ifndef XDIAL_EPOLL_WEBSOCKET
+#include "PooledMessageManager.h"
+#endif
+#include "ResponseHandler.h"
+#include "ThunderInterface.h"
+#include "EventUtils.h"
+#include "ScriptedThunder.h"
+#include "MicrobenchFixtures.h"
+
+// Every allocation in the process is counted; cases report the delta per operation. Live heap
+// bytes are tracked too (as malloc sized the blocks) for the high-water mark of each case.
+static std::atomic<uint64_t> g_allocCount{0};
+static std::atomic<uint64_t> g_allocBytes{0};
+static std::atomic<int64_t> g_liveBytes{0};
+static std::atomic<int64_t> g_peakBytes{0};
+
+void *operator new(size_t size)
+{
+    g_allocCount.fetch_add(1, std::memory_order_relaxed);
+    g_allocBytes.fetch_add(size, std::memory_order_relaxed);
+    void *p = malloc(size ? size : 1);
+    if (p == nullptr)
+        throw std::bad_alloc();
+    int64_t usable = static_cast<int64_t>(malloc_usable_size(p));
+    int64_t live = g_liveBytes.fetch_add(usable, std::memory_order_relaxed) + usable;
+    int64_t peak = g_peakBytes.load(std::memory_order_relaxed);
+    while (live > peak && !g_peakBytes.compare_exchange_weak(peak, live, std::memory_order_relaxed)) {
+    }
+    return p;
+}
+void operator delete(void *p) noexcept
+{
+    g_liveBytes.fetch_sub(static_cast<int64_t>(malloc_usable_size(p)), std::memory_order_relaxed);
+    free(p);
+}
+void operator delete(void *p, size_t) noexcept { operator delete(p); }
+
+template <typename T>
+static inline void doNotOptimize(const T &value)
+{
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+struct BenchResult {
+    std::string name;
+    uint64_t iterations;
+    double nsPerOp;
+    double allocsPerOp;
+    double bytesPerOp;
+    int64_t peakBytes;   // heap high-water mark above the live heap at the start of the case
+};
+
+// A case runs `iterations` operations per call and returns the number actually performed.
+using BenchBody = std::function<uint64_t(uint64_t iterations)>;
+
+static BenchResult runCase(const std::string &name, const BenchBody &body, double minTimeMs)
+{
+    using Clock = std::chrono::steady_clock;
+    uint64_t iterations = 1;
+    body(16); // warm up caches, singletons and lazily registered metrics
+    for (;;) {
+        uint64_t allocs = g_allocCount.load();
+        uint64_t bytes = g_allocBytes.load();
+        int64_t live = g_liveBytes.load();
+        g_peakBytes.store(live);
+        auto start = Clock::now();
+        uint64_t ops = body(iterations);
+        double elapsedNs = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+        if (elapsedNs >= minTimeMs * 1e6 || iterations >= (uint64_t(1) << 40)) {
+            return {name, ops, elapsedNs / ops, double(g_allocCount.load() - allocs) / ops,
+                    double(g_allocBytes.load() - bytes) / ops, g_peakBytes.load() - live};
+        }
+        // Aim straight for the target once the timing is meaningful.
+        double scale = elapsedNs > 1e5 ? (minTimeMs * 1e6 * 1.2) / elapsedNs : 10;
+        iterations = std::max<uint64_t>(iterations + 1, static_cast<uint64_t>(iterations * scale));
+    }
+}
+
+template <typename F>
+static BenchBody loop(F op)
+{
+    return [op](uint64_t iterations) {
+        for (uint64_t i = 0; i < iterations; i++)
+            op();
+        return iterations;
+    };
+}
+
+#ifndef XDIAL_EPOLL_WEBSOCKET
+// What websocketpp does with its message manager per frame: a message sized from the frame
+// header that the payload is read into, and for a send the payload message plus the prepared
+// frame (header and payload copy) that goes to the socket.
+template <typename Manager>
+static BenchBody receiveFrames(const std::string &frame)
+{
+    auto manager = std::make_shared<Manager>();
+    return loop([manager, frame] {
+        auto msg = manager->get_message(websocketpp::frame::opcode::text, frame.size());
+        msg->append_payload(frame);
+        doNotOptimize(msg->get_payload().size());
+    });
+}
+
+template <typename Manager>
+static BenchBody sendFrames(const std::string &request)
+{
+    auto manager = std::make_shared<Manager>();
+    return loop([manager, request] {
+        auto msg = manager->get_message(websocketpp::frame::opcode::text, request.size());
+        msg->append_payload(request);
+        auto out = manager->get_message();
+        out->set_header("\x81\xfe\x00\x80\x12\x34\x56\x78");
+        out->set_payload(msg->get_payload());
+        out->set_prepared(true);
+        doNotOptimize(out->get_payload().size());
+    });
+}
+#endif
+
+class NullListener : public EventListener
+{
+public:
+    void registerDialRequests(std::function<void(DIALEVENTS, const DialParams &)>) override {}
+    void registerRDKShellEvents(std::function<void(const std::string &, const std::string &)>) override {}
+    void addControllerStateChangeListener(std::function<void(const std::string &, const std::string &)>) override {}
+    void removeDialListener() override {}
+    void removeRDKShellListener() override {}
+    void removeControllerStateChangeListener() override {}
+    void onDialEvents(DIALEVENTS dialEvent, const DialParams &dialParams) override
+    {
+        doNotOptimize(dialEvent);
+        doNotOptimize(dialParams.appName.size());
+    }
+    void onRDKShellEvents(const std::string &, const std::string &params) override { doNotOptimize(params.size()); }
+    void onControllerStateChangeEvents(const std::string &, const std::string &params) override
+    {
+        doNotOptimize(params.size());
+    }
+};
+
+// Each thread registers, answers and collects its own requests; measures lock contention.
+static BenchBody selfDeliveredHandshake(ResponseHandler *handler, int threads)
+{
+    return [handler, threads](uint64_t iterations) {
+        static std::atomic<int> nextId{1000000};
+        std::vector<std::thread> workers;
+        uint64_t perThread = std::max<uint64_t>(1, iterations / threads);
+        for (int t = 0; t < threads; t++) {
+            workers.emplace_back([handler, perThread] {
+                Frame reply = makeFrame(fixtures::SUCCESS_REPLY);
+                for (uint64_t i = 0; i < perThread; i++) {
+                    int id = nextId.fetch_add(1, std::memory_order_relaxed);
+                    handler->registerRequest(id);
+                    handler->addMessageToResponseQueue(id, reply);
+                    doNotOptimize(handler->getRequestStatus(id, 1000)->size());
+                }
+            });
+        }
+        for (auto &w : workers)
+            w.join();
+        return perThread * threads;
+    };
+}
+
+// A waiting requester and a separate "socket" thread delivering the reply; measures wake-up latency.
+static uint64_t crossThreadHandshake(ResponseHandler *handler, uint64_t iterations)
+{
+    static std::atomic<int> nextId{2000000000};
+    std::atomic<int> posted{0};
+    std::atomic<bool> done{false};
+    std::thread responder([&] {
+        Frame reply = makeFrame(fixtures::SUCCESS_REPLY);
+        int last = 0;
+        while (!done.load(std::memory_order_acquire)) {
+            int id = posted.load(std::memory_order_acquire);
+            if (id != last) {
+                handler->addMessageToResponseQueue(id, reply);
+                last = id;
+            }
+        }
+    });
+    for (uint64_t i = 0; i < iterations; i++) {
+        int id = nextId.fetch_add(1, std::memory_order_relaxed);
+        handler->registerRequest(id);
+        posted.store(id, std::memory_order_release);
+        doNotOptimize(handler->getRequestStatus(id, 1000)->size());
+    }
+    done = true;
+    responder.join();
+    return iterations;
+}
+
+// ThunderInterface talking to ScriptedThunder over LoopbackTransport: the full client request
+// path (builder, invoke, transport routing, response handshake, reply parsing) minus the network.
+class LoopbackClient
+{
+    LoopbackTransport *mp_transport;   // owned by iface
+
+public:
+    ResponseHandler responses;
+    ScriptedThunder thunder;
+    ThunderInterface iface;
+
+    LoopbackClient() : mp_transport(new LoopbackTransport()), thunder(*mp_transport), iface(mp_transport, &responses)
+    {
+        responses.initialize();
+        Json::Value status;
+        std::istringstream reply(fixtures::CONTROLLER_STATUS_REPLY);
+        Json::CharReaderBuilder reader;
+        Json::parseFromStream(reader, reply, &status, nullptr);
+        Json::StreamWriterBuilder writer;
+        writer["indentation"] = "";
+        thunder.setResult("Controller.1.status", Json::writeString(writer, status["result"]));
+
+        std::atomic<bool> connected{false};
+        iface.registerConnectStatusListener([&connected](bool isConnected) { connected = isConnected; });
+        iface.initialize();
+        iface.connectToThunder();
+        while (!connected.load())
+            std::this_thread::yield();
+        iface.registerConnectStatusListener(nullptr);
+    }
+};
+
+static std::vector<std::pair<std::string, BenchBody>> buildCases(LoopbackClient &client)
+{
+    using namespace fixtures;
+    std::vector<std::pair<std::string, BenchBody>> cases;
+    auto add = [&cases](const std::string &name, BenchBody body) { cases.emplace_back(name, body); };
+
+    // Parsers
+    add("parseJson/dial_event", loop([] {
+        Json::Value root;
+        doNotOptimize(parseJson(DIAL_LAUNCH_EVENT, root));
+    }));
+    add("parseJson/controller_status_reply", loop([] {
+        Json::Value root;
+        doNotOptimize(parseJson(CONTROLLER_STATUS_REPLY, root));
+    }));
+
+    // Read-only parsing of captured frames: jsoncpp (parseJson) against the arena reader that the
+    // reply and event accessors use.
+    static const std::vector<std::pair<std::string, std::string>> frames = {
+        {"dial_event", DIAL_LAUNCH_EVENT},
+        {"statechange", CONTROLLER_STATECHANGE_EVENT},
+        {"error_reply", ERROR_REPLY},
+        {"get_clients_reply", GET_CLIENTS_REPLY},
+        {"controller_status_reply", CONTROLLER_STATUS_REPLY},
+    };
+    for (const auto &frame : frames) {
+        const std::string *text = &frame.second;
+        add("jsonReader/jsoncpp/" + frame.first, loop([text] {
+            Json::Value root;
+            doNotOptimize(parseJson(*text, root));
+        }));
+        add("jsonReader/arena/" + frame.first, loop([text] {
+            JsonDocument doc;
+            doNotOptimize(doc.parse(*text));
+            doNotOptimize(doc.root().size());
+        }));
+    }
+#ifndef XDIAL_EPOLL_WEBSOCKET
+    // websocketpp message buffers: the stock manager against the pooled one TransportHandler uses
+    typedef websocketpp::message_buffer::alloc::con_msg_manager<websocketpp::config::asio_client::message_type>
+        StockManager;
+    typedef PooledAsioClientConfig::con_msg_manager_type PooledManager;
+    int requestId = 0;
+    const std::string request = getSubscribeRequest("org.rdk.Xcast.1.", "onApplicationLaunchRequest", requestId);
+    add("wsMessage/stock/receive_dial_event", receiveFrames<StockManager>(DIAL_LAUNCH_EVENT));
+    add("wsMessage/pooled/receive_dial_event", receiveFrames<PooledManager>(DIAL_LAUNCH_EVENT));
+    add("wsMessage/stock/receive_controller_status", receiveFrames<StockManager>(CONTROLLER_STATUS_REPLY));
+    add("wsMessage/pooled/receive_controller_status", receiveFrames<PooledManager>(CONTROLLER_STATUS_REPLY));
+    add("wsMessage/stock/send_request", sendFrames<StockManager>(request));
+    add("wsMessage/pooled/send_request", sendFrames<PooledManager>(request));
+#endif
+
+    add("getMessageId/reply", loop([] {
+        int id = 0;
+        doNotOptimize(getMessageId(SUCCESS_REPLY, id));
+    }));
+    add("getEventId/dial_event", loop([] {
+        std::string name;
+        doNotOptimize(getEventId(DIAL_LAUNCH_EVENT, name));
+    }));
+    add("getDialEventParams/launch", loop([] {
+        DialParams params;
+        doNotOptimize(getDialEventParams(DIAL_LAUNCH_EVENT, params));
+    }));
+    add("getParamObjectFromJsonString/statechange", loop([] {
+        Json::Value params;
+        doNotOptimize(getParamObjectFromJsonString(CONTROLLER_STATECHANGE_EVENT, params));
+    }));
+    add("convertResultStringToBool/status", loop([] {
+        bool value = false;
+        doNotOptimize(convertResultStringToBool(STATUS_REPLY, value));
+    }));
+    add("convertResultStringToBool/key", loop([] {
+        bool value = false;
+        doNotOptimize(convertResultStringToBool(SUCCESS_REPLY, "success", value));
+    }));
+    add("convertResultStringToArray/clients", loop([] {
+        std::vector<std::string> clients;
+        doNotOptimize(convertResultStringToArray(GET_CLIENTS_REPLY, "clients", clients));
+    }));
+    add("convertEventSubResponseToInt/subscribe", loop([] {
+        int value = -1;
+        doNotOptimize(convertEventSubResponseToInt(SUBSCRIBE_REPLY, value));
+    }));
+    add("checkForThunderErrorResponse/success", loop([] {
+        doNotOptimize(checkForThunderErrorResponse(SUCCESS_REPLY));
+    }));
+    add("isJsonRpcResultNull/null", loop([] { doNotOptimize(isJsonRpcResultNull(NULL_RESULT_REPLY)); }));
+    add("isValidJsonResponse/controller_status", loop([] {
+        doNotOptimize(isValidJsonResponse(CONTROLLER_STATUS_REPLY));
+    }));
+    add("getParamFromResult/friendlyName", loop([] {
+        std::string name;
+        doNotOptimize(getParamFromResult(FRIENDLY_NAME_REPLY, "friendlyName", name));
+    }));
+    add("getValueOfKeyFromJson/method", loop([] {
+        std::string value;
+        doNotOptimize(getValueOfKeyFromJson(RDKSHELL_LAUNCHED_EVENT, "method", value));
+    }));
+
+    // Builders
+    add("getSubscribeRequest", loop([] {
+        int id = 0;
+        doNotOptimize(getSubscribeRequest("org.rdk.Xcast.1.", "onApplicationLaunchRequest", id).size());
+    }));
+    add("getUnSubscribeRequest", loop([] {
+        int id = 0;
+        doNotOptimize(getUnSubscribeRequest("org.rdk.Xcast.1.", "onApplicationLaunchRequest", id).size());
+    }));
+    add("getThunderMethodToJson", loop([] {
+        int id = 0;
+        doNotOptimize(getThunderMethodToJson("Controller.1.status@Cobalt", id).size());
+    }));
+    add("enableCastingToJson", loop([] {
+        int id = 0;
+        doNotOptimize(enableCastingToJson(true, id).size());
+    }));
+    add("isCastingEnabledToJson", loop([] {
+        int id = 0;
+        doNotOptimize(isCastingEnabledToJson(id).size());
+    }));
+    add("setFriendlyNameToJson", loop([] {
+        int id = 0;
+        doNotOptimize(setFriendlyNameToJson("RDKE-48213377", id).size());
+    }));
+    add("getRegisterAppToJson", loop([] {
+        int id = 0;
+        doNotOptimize(getRegisterAppToJson(id, "YouTube,Netflix,Amazon").size());
+    }));
+    add("setStandbyBehaviourToJson", loop([] {
+        int id = 0;
+        doNotOptimize(setStandbyBehaviourToJson(id).size());
+    }));
+    add("getClientListToJson", loop([] {
+        int id = 0;
+        doNotOptimize(getClientListToJson(id).size());
+    }));
+    add("setAppStateToJson", loop([] {
+        int id = 0;
+        doNotOptimize(setAppStateToJson("YouTube", "1234", "running", id).size());
+    }));
+    add("launchAppToJson", loop([] {
+        int id = 0;
+        doNotOptimize(launchAppToJson("Cobalt", id).size());
+    }));
+    add("suspendAppToJson", loop([] {
+        int id = 0;
+        doNotOptimize(suspendAppToJson("Cobalt", id).size());
+    }));
+    add("shutdownAppToJson", loop([] {
+        int id = 0;
+        doNotOptimize(shutdownAppToJson("Cobalt", id).size());
+    }));
+    DialParams deepLink;
+    getDialEventParams(DIAL_LAUNCH_EVENT, deepLink);
+    std::vector<AppConfig> appConfigs = {{"YouTube", "https://www.youtube.com/tv", "Cobalt.1.deeplink"}};
+    add("sendDeepLinkToJson", loop([deepLink, appConfigs] {
+        int id = 0;
+        doNotOptimize(sendDeepLinkToJson(deepLink, appConfigs, id).size());
+    }));
+
+    // Event dispatch, on the calling thread
+    ResponseHandler *responses = &client.responses;
+    Frame dialLaunch = makeFrame(DIAL_LAUNCH_EVENT);
+    Frame rdkshellLaunched = makeFrame(RDKSHELL_LAUNCHED_EVENT);
+    Frame stateChange = makeFrame(CONTROLLER_STATECHANGE_EVENT);
+    add("processEvent/dial_launch", loop([responses, dialLaunch] {
+        responses->processEvent(QueuedEvent(dialLaunch, std::chrono::steady_clock::now()));
+    }));
+    add("processEvent/rdkshell_onLaunched", loop([responses, rdkshellLaunched] {
+        responses->processEvent(QueuedEvent(rdkshellLaunched, std::chrono::steady_clock::now()));
+    }));
+    add("processEvent/statechange", loop([responses, stateChange] {
+        responses->processEvent(QueuedEvent(stateChange, std::chrono::steady_clock::now()));
+    }));
+
+    // Request/response handshake
+    add("responseHandshake/self_1t", selfDeliveredHandshake(responses, 1));
+    add("responseHandshake/self_4t", selfDeliveredHandshake(responses, 4));
+    add("responseHandshake/cross_thread",
+        [responses](uint64_t iterations) { return crossThreadHandshake(responses, iterations); });
+
+    // Whole client round trips over the in-process transport
+    ThunderInterface &iface = client.iface;
+    add("loopback/getPluginState", loop([&iface] {
+        std::string state;
+        iface.getPluginState("YouTube", state);
+        doNotOptimize(state.size());
+    }));
+    add("loopback/setAppState", loop([&iface] { doNotOptimize(iface.setAppState("YouTube", "1234", "running")); }));
+    std::string launchParams = R"({"applicationName":"YouTube","applicationId":"1234","strPayLoad":"v=dQw4w9WgXcQ"})";
+    ScriptedThunder &thunder = client.thunder;
+    add("loopback/eventIngest", loop([&thunder, launchParams] {
+        thunder.emitEvent("1003.onApplicationLaunchRequest", launchParams);
+    }));
+    return cases;
+}
+
+static std::string toJson(const std::vector<BenchResult> &results)
+{
+    Json::Value root;
+    root["benchmarks"] = Json::Value(Json::arrayValue);
+    for (const auto &r : results) {
+        Json::Value entry;
+        entry["name"] = r.name;
+        entry["iterations"] = static_cast<Json::UInt64>(r.iterations);
+        entry["ns_per_op"] = r.nsPerOp;
+        entry["allocs_per_op"] = r.allocsPerOp;
+        entry["bytes_per_op"] = r.bytesPerOp;
+        entry["peak_heap_bytes"] = static_cast<Json::Int64>(r.peakBytes);
+        root["benchmarks"].append(entry);
+    }
+    Json::StreamWriterBuilder builder;
+    builder["indentation"] = "  ";
+    return Json::writeString(builder, root) + "\n";
+}
+
+// Returns the number of regressions: slower by more than thresholdPct, or more allocations.
+static int compareWithBaseline(const std::vector<BenchResult> &results, const std::string &path, double thresholdPct)
+{
+    std::ifstream file(path);
+    Json::Value baseline;
+    Json::CharReaderBuilder builder;
+    std::string errs;
+    if (!file.is_open() || !Json::parseFromStream(builder, file, &baseline, &errs)) {
+        fprintf(stderr, "Cannot read baseline %s %s\n", path.c_str(), errs.c_str());
+        return -1;
+    }
+    std::map<std::string, Json::Value> base;
+    for (const auto &entry : baseline["benchmarks"])
+        base[entry["name"].asString()] = entry;
+
+    int regressions = 0;
+    fprintf(stderr, "%-44s %12s %12s %8s %10s %10s\n", "case", "base ns/op", "ns/op", "delta", "base alloc", "alloc");
+    for (const auto &r : results) {
+        auto it = base.find(r.name);
+        if (it == base.end()) {
+            fprintf(stderr, "%-44s %12s %12.1f %8s %10s %10.2f  new\n", r.name.c_str(), "-", r.nsPerOp, "-", "-",
+                    r.allocsPerOp);
+            continue;
+        }
+        double baseNs = it->second["ns_per_op"].asDouble();
+        double baseAllocs = it->second["allocs_per_op"].asDouble();
+        double delta = baseNs > 0 ? (r.nsPerOp - baseNs) * 100.0 / baseNs : 0;
+        bool slower = delta > thresholdPct;
+        bool moreAllocs = r.allocsPerOp > baseAllocs + 0.5;
+        if (slower || moreAllocs)
+            regressions++;
+        fprintf(stderr, "%-44s %12.1f %12.1f %+7.1f%% %10.2f %10.2f%s\n", r.name.c_str(), baseNs, r.nsPerOp, delta,
+                baseAllocs, r.allocsPerOp, (slower || moreAllocs) ? "  REGRESSION" : "");
+    }
+    return regressions;
+}
+
+/***
+ * Microbenchmarks for the per-message code paths.
+ * Usage: xdialtester_microbench [--filter=substr] [--min-time-ms=200] [--out=results.json]
+ *                               [--compare=baseline.json] [--threshold=10]
+ * Results are written as JSON to stdout (or --out). With --compare the exit status is 1
+ * when any case regressed by more than --threshold percent or allocates more.
+ */
+int main(int argc, char *argv[])
+{
+    std::string filter, outPath, baselinePath;
+    double minTimeMs = 200;
+    double thresholdPct = 10;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        std::string value = arg.substr(arg.find("=") + 1);
+        if (arg.find("--filter=") == 0)
+            filter = value;
+        else if (arg.find("--min-time-ms=") == 0)
+            minTimeMs = atof(value.c_str());
+        else if (arg.find("--out=") == 0)
+            outPath = value;
+        else if (arg.find("--compare=") == 0)
+            baselinePath = value;
+        else if (arg.find("--threshold=") == 0)
+            thresholdPct = atof(value.c_str());
+        else {
+            fprintf(stderr, "Invalid argument %s\n", arg.c_str());
+            return -1;
+        }
+    }
+
+    // Keep logging out of the measurements; codecs only log on failure.
+    setAllLogLevels(LOG_LEVEL_ERROR);
+    // Created first: ThunderInterface::initialize() registers itself as the event listener.
+    LoopbackClient client;
+    NullListener listener;
+    client.responses.registerEventListener(&listener);
+
+    std::vector<BenchResult> results;
+    for (const auto &c : buildCases(client)) {
+        if (!filter.empty() && c.first.find(filter) == std::string::npos)
+            continue;
+        results.push_back(runCase(c.first, c.second, minTimeMs));
+        const BenchResult &r = results.back();
+        fprintf(stderr, "%-44s %10.1f ns/op %8.2f allocs/op %10.1f B/op %10lld B peak\n", r.name.c_str(),
+                r.nsPerOp, r.allocsPerOp, r.bytesPerOp, static_cast<long long>(r.peakBytes));
+    }
+
+    std::string json = toJson(results);
+    if (outPath.empty()) {
+        fputs(json.c_str(), stdout);
+    } else {
+        std::ofstream out(outPath);
+        out << json;
+    }
+
+    int status = 0;
+    if (!baselinePath.empty()) {
+        int regressions = compareWithBaseline(results, baselinePath, thresholdPct);
+        status = regressions != 0 ? 1 : 0;
+    }
+    client.responses.shutdown();
+    return status;
+}
@@ -0,0 +1,66 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2022 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+// Frames captured from Thunder on an RDK-E device while casting YouTube and Netflix.
+
+namespace fixtures {
+
+// Notifications
+static const char *DIAL_LAUNCH_EVENT =
+    R"({"jsonrpc":"2.0","method":"1003.onApplicationLaunchRequest","params":{"applicationName":"YouTube",)"
+    R"("applicationId":"1234","strPayLoad":"pairingCode=8c3c1b4e-4f2a-4b4a-9d2b-3b5a3c7e2f11&v=dQw4w9WgXcQ&t=0",)"
+    R"("strQuery":"source_type=12","strAddDataUrl":"http://192.168.1.23:8009/apps/YouTube/dial_data"}})";
+
+static const char *DIAL_STATE_EVENT =
+    R"({"jsonrpc":"2.0","method":"1005.onApplicationStateRequest","params":{"applicationName":"Netflix",)"
+    R"("applicationId":"5678"}})";
+
+static const char *RDKSHELL_LAUNCHED_EVENT =
+    R"({"jsonrpc":"2.0","method":"1024.onLaunched","params":{"client":"Cobalt","launchType":"activate"}})";
+
+static const char *CONTROLLER_STATECHANGE_EVENT =
+    R"({"jsonrpc":"2.0","method":"1030.statechange","params":{"callsign":"Cobalt","reason":"Requested",)"
+    R"("state":"Activated"}})";
+
+// Replies
+static const char *SUCCESS_REPLY = R"({"jsonrpc":"2.0","id":1002,"result":{"launchType":"activate","success":true}})";
+
+static const char *STATUS_REPLY = R"({"jsonrpc":"2.0","id":1017,"result":{"status":true,"success":true}})";
+
+static const char *SUBSCRIBE_REPLY = R"({"jsonrpc":"2.0","id":1001,"result":0})";
+
+static const char *NULL_RESULT_REPLY = R"({"jsonrpc":"2.0","id":1044,"result":null})";
+
+static const char *ERROR_REPLY = R"({"jsonrpc":"2.0","id":4,"error":{"code":-32601,"message":"Method not found"}})";
+
+static const char *GET_CLIENTS_REPLY =
+    R"({"jsonrpc":"2.0","id":1040,"result":{"clients":["vol_overlay","amazon","residentapp","cobalt"],)"
+    R"("success":true}})";
+
+static const char *FRIENDLY_NAME_REPLY =
+    R"({"jsonrpc":"2.0","id":1009,"result":{"friendlyName":"RDKE-48213377","success":true}})";
+
+static const char *CONTROLLER_STATUS_REPLY =
+    R"({"jsonrpc":"2.0","id":1012,"result":[{"callsign":"Cobalt","locator":"libWPEFrameworkCobalt.so",)"
+    R"("classname":"Cobalt","autostart":false,"precondition":["Platform"],"state":"suspended",)"
+    R"("startmode":"Deactivated","observers":0,"module":"Plugin_Cobalt","hash":"engineering_build_for_debugging_purpose_only",)"
+    R"("configuration":{"url":"https://www.youtube.com/tv","clientidentifier":"wst-cobalt","language":"en-US"}}]})";
+
+} // namespace fixtures
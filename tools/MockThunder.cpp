@@ -0,0 +1,354 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2022 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <sstream>
+
+#include "MockThunder.h"
+
+static bool endsWith(const std::string &str, const std::string &suffix)
+{
+    return str.size() >= suffix.size() && str.compare(str.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+static std::string toLower(std::string str)
+{
+    std::transform(str.begin(), str.end(), str.begin(), ::tolower);
+    return str;
+}
+
+MockThunder::MockThunder(const MockThunderConfig &config)
+    : m_config(config), mp_thread(nullptr), m_random(config.seed), m_friendlyName("MockThunder"),
+      m_castingEnabled(false), m_observer(nullptr)
+{
+    m_pluginStates["Cobalt"] = "Deactivated";
+    m_pluginStates["Netflix"] = "Deactivated";
+    m_pluginStates["Amazon"] = "Deactivated";
+}
+
+MockThunder::~MockThunder()
+{
+    stop();
+}
+
+bool MockThunder::start()
+{
+    try
+    {
+        m_server.clear_access_channels(websocketpp::log::alevel::all);
+        m_server.init_asio();
+        m_server.set_reuse_addr(true);
+        m_server.set_message_handler([this](websocketpp::connection_hdl hdl, wsserver::message_ptr msg)
+                                     { onMessage(hdl, msg); });
+        m_server.set_close_handler([this](websocketpp::connection_hdl hdl)
+                                   { onClose(hdl); });
+        m_server.listen(m_config.port);
+        m_server.start_accept();
+    }
+    catch (const std::exception &e)
+    {
+        fprintf(stderr, "mockthunder: failed to listen on port %u: %s\n", m_config.port, e.what());
+        return false;
+    }
+    mp_thread = new std::thread([this] { m_server.run(); });
+    return true;
+}
+
+void MockThunder::stop()
+{
+    if (mp_thread == nullptr)
+        return;
+    m_server.stop_listening();
+    m_server.stop();
+    mp_thread->join();
+    delete mp_thread;
+    mp_thread = nullptr;
+}
+
+void MockThunder::setRequestObserver(RequestObserver observer)
+{
+    std::lock_guard<std::mutex> lock(m_stateMutex);
+    m_observer = observer;
+}
+
+void MockThunder::setPluginState(const std::string &callsign, const std::string &state)
+{
+    std::lock_guard<std::mutex> lock(m_stateMutex);
+    m_pluginStates[callsign] = state;
+}
+
+size_t MockThunder::subscriberCount(const std::string &event)
+{
+    std::lock_guard<std::mutex> lock(m_stateMutex);
+    auto it = m_subscribers.find(event);
+    return it == m_subscribers.end() ? 0 : it->second.size();
+}
+
+const char *MockThunder::dialEventName(const std::string &shortName)
+{
+    if (shortName == "launch")
+        return "onApplicationLaunchRequest";
+    if (shortName == "hide")
+        return "onApplicationHideRequest";
+    if (shortName == "resume")
+        return "onApplicationResumeRequest";
+    if (shortName == "stop")
+        return "onApplicationStopRequest";
+    if (shortName == "state")
+        return "onApplicationStateRequest";
+    return nullptr;
+}
+
+void MockThunder::emitDialEvent(const std::string &event, const std::string &appName, const std::string &appId,
+                                const std::string &payload)
+{
+    Json::Value params;
+    params["applicationName"] = appName;
+    params["applicationId"] = appId;
+    if (!payload.empty())
+        params["strPayLoad"] = payload;
+    m_server.get_io_service().post([this, event, params] { notify(event, params); });
+}
+
+int MockThunder::replyDelayMs()
+{
+    int delay = m_config.latencyMs;
+    if (m_config.jitterMs > 0)
+        delay += std::uniform_int_distribution<int>(0, m_config.jitterMs)(m_random);
+    return delay;
+}
+
+void MockThunder::sendJson(websocketpp::connection_hdl hdl, const Json::Value &root)
+{
+    Json::StreamWriterBuilder builder;
+    builder["indentation"] = "";
+    std::ostringstream os;
+    std::unique_ptr<Json::StreamWriter> writer(builder.newStreamWriter());
+    writer->write(root, &os);
+
+    websocketpp::lib::error_code ec;
+    m_server.send(hdl, os.str(), websocketpp::frame::opcode::text, ec);
+}
+
+void MockThunder::notify(const std::string &event, const Json::Value &params)
+{
+    std::vector<Subscription> subscribers;
+    {
+        std::lock_guard<std::mutex> lock(m_stateMutex);
+        auto it = m_subscribers.find(event);
+        if (it != m_subscribers.end())
+            subscribers = it->second;
+    }
+    for (const auto &sub : subscribers)
+    {
+        Json::Value root;
+        root["jsonrpc"] = "2.0";
+        root["method"] = sub.id + "." + event;
+        root["params"] = params;
+        sendJson(sub.hdl, root);
+    }
+}
+
+void MockThunder::changePluginState(const std::string &callsign, const std::string &state, const char *shellEvent)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_stateMutex);
+        m_pluginStates[callsign] = state;
+    }
+    m_server.set_timer(m_config.launchMs, [this, callsign, state, shellEvent](const websocketpp::lib::error_code &ec) {
+        if (ec)
+            return;
+        Json::Value stateParams;
+        stateParams["callsign"] = callsign;
+        stateParams["state"] = state;
+        stateParams["reason"] = "Requested";
+        notify("statechange", stateParams);
+
+        Json::Value shellParams;
+        shellParams["client"] = toLower(callsign);
+        shellParams["launchType"] = "activate";
+        notify(shellEvent, shellParams);
+    });
+}
+
+void MockThunder::onClose(websocketpp::connection_hdl hdl)
+{
+    std::lock_guard<std::mutex> lock(m_stateMutex);
+    for (auto &entry : m_subscribers)
+    {
+        auto &subs = entry.second;
+        subs.erase(std::remove_if(subs.begin(), subs.end(), [&hdl](const Subscription &sub) {
+                       return !sub.hdl.owner_before(hdl) && !hdl.owner_before(sub.hdl);
+                   }), subs.end());
+    }
+}
+
+bool MockThunder::handleRequest(websocketpp::connection_hdl hdl, const std::string &method, const Json::Value &params,
+                                Json::Value &result, Json::Value &error)
+{
+    std::string callsign = params.get("callsign", "").asString();
+
+    if (endsWith(method, ".register") || endsWith(method, ".unregister"))
+    {
+        std::string event = params.get("event", "").asString();
+        std::lock_guard<std::mutex> lock(m_stateMutex);
+        auto &subs = m_subscribers[event];
+        if (endsWith(method, ".register"))
+            subs.push_back({hdl, params.get("id", "").asString()});
+        else
+            // The client sends a fresh id with each unregister, so match on the connection.
+            subs.erase(std::remove_if(subs.begin(), subs.end(), [&hdl](const Subscription &sub) {
+                           return !sub.hdl.owner_before(hdl) && !hdl.owner_before(sub.hdl);
+                       }), subs.end());
+        result = 0;
+    }
+    else if (method.compare(0, 20, "Controller.1.status@") == 0)
+    {
+        callsign = method.substr(20);
+        std::lock_guard<std::mutex> lock(m_stateMutex);
+        auto it = m_pluginStates.find(callsign);
+        if (it == m_pluginStates.end())
+        {
+            error["code"] = 30;
+            error["message"] = "Unknown callsign";
+            return false;
+        }
+        Json::Value entry;
+        result = Json::Value(Json::arrayValue);
+        entry["callsign"] = callsign;
+        // Controller reports lower case states here but capitalised ones in statechange events.
+        entry["state"] = toLower(it->second);
+        result.append(entry);
+    }
+    else if (method == "org.rdk.Xcast.1.getEnabled")
+    {
+        result["enabled"] = m_castingEnabled;
+        result["success"] = true;
+    }
+    else if (method == "org.rdk.Xcast.1.setEnabled")
+    {
+        m_castingEnabled = params.get("enabled", true).asBool();
+        result["success"] = true;
+    }
+    else if (method == "org.rdk.System.getFriendlyName")
+    {
+        result["friendlyName"] = m_friendlyName;
+        result["success"] = true;
+    }
+    else if (method == "org.rdk.System.setFriendlyName")
+    {
+        m_friendlyName = params.get("friendlyName", m_friendlyName).asString();
+        result["success"] = true;
+    }
+    else if (method == "org.rdk.Xcast.1.registerApplications" || method == "org.rdk.Xcast.1.setStandbyBehavior" ||
+             method == "org.rdk.Xcast.1.setApplicationState")
+    {
+        result["success"] = true;
+    }
+    else if (method == "org.rdk.RDKShell.1.getClients")
+    {
+        result["clients"] = Json::Value(Json::arrayValue);
+        std::lock_guard<std::mutex> lock(m_stateMutex);
+        for (const auto &plugin : m_pluginStates)
+            if (plugin.second != "Deactivated")
+                result["clients"].append(toLower(plugin.first));
+        result["success"] = true;
+    }
+    else if (method == "org.rdk.RDKShell.1.launch")
+    {
+        changePluginState(callsign, "Activated", "onLaunched");
+        result["launchType"] = "activate";
+        result["success"] = true;
+    }
+    else if (method == "org.rdk.RDKShell.1.suspend")
+    {
+        changePluginState(callsign, "Suspended", "onSuspended");
+        result["success"] = true;
+    }
+    else if (method == "org.rdk.RDKShell.1.destroy")
+    {
+        changePluginState(callsign, "Deactivated", "onDestroyed");
+        result["success"] = true;
+    }
+    else if (endsWith(method, ".deeplink") || endsWith(method, ".systemcommand"))
+    {
+        result = Json::Value(Json::nullValue);
+    }
+    else
+    {
+        error["code"] = -32601;
+        error["message"] = "Method not found";
+        return false;
+    }
+    return true;
+}
+
+void MockThunder::onMessage(websocketpp::connection_hdl hdl, wsserver::message_ptr msg)
+{
+    Json::Value request;
+    Json::CharReaderBuilder builder;
+    std::unique_ptr<Json::CharReader> reader(builder.newCharReader());
+    std::string errs;
+    const std::string &payload = msg->get_payload();
+    if (!reader->parse(payload.c_str(), payload.c_str() + payload.size(), &request, &errs) || !request.isObject())
+    {
+        fprintf(stderr, "mockthunder: bad request %s\n", payload.c_str());
+        return;
+    }
+
+    std::string method = request.get("method", "").asString();
+    Json::Value params = request.get("params", Json::Value(Json::objectValue));
+
+    RequestObserver observer;
+    {
+        std::lock_guard<std::mutex> lock(m_stateMutex);
+        observer = m_observer;
+    }
+    if (observer)
+        observer(method, params);
+
+    if (m_config.dropRate > 0 && std::uniform_real_distribution<double>(0, 1)(m_random) < m_config.dropRate)
+        return;
+
+    Json::Value reply;
+    reply["jsonrpc"] = "2.0";
+    // xdialtester sends ids as strings; Thunder answers with numeric ids.
+    const Json::Value &id = request["id"];
+    reply["id"] = id.isString() ? Json::Value(atoi(id.asCString())) : id;
+
+    Json::Value result(Json::objectValue), error(Json::objectValue);
+    if (handleRequest(hdl, method, params, result, error))
+        reply["result"] = result;
+    else
+        reply["error"] = error;
+
+    int delay = replyDelayMs();
+    if (delay <= 0)
+    {
+        sendJson(hdl, reply);
+        return;
+    }
+    m_server.set_timer(delay, [this, hdl, reply](const websocketpp::lib::error_code &ec) {
+        if (!ec)
+            sendJson(hdl, reply);
+    });
+}
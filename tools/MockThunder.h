@@ -0,0 +1,101 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2022 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <websocketpp/config/asio_no_tls.hpp>
+#include <websocketpp/server.hpp>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include "json/json.h"
+
+typedef websocketpp::server<websocketpp::config::asio> wsserver;
+
+struct MockThunderConfig {
+    uint16_t port = 9998;
+    int latencyMs = 0;          // added to every reply
+    int jitterMs = 0;           // uniform extra delay in [0, jitterMs]
+    double dropRate = 0.0;      // probability that a request gets no reply at all
+    int launchMs = 50;          // RDKShell launch/suspend/destroy time before state events fire
+    unsigned seed = 1;
+};
+
+/*
+ * Minimal stand-in for the Thunder JSON-RPC endpoint used by xdialtester. Emulates the
+ * Controller, org.rdk.Xcast, org.rdk.RDKShell and org.rdk.System methods the client
+ * calls, keeps a plugin state per callsign and emits the matching statechange and
+ * RDKShell notifications to subscribers. All protocol work runs on the server thread.
+ */
+class MockThunder
+{
+public:
+    // Called on the server thread for every request, before the reply is scheduled.
+    using RequestObserver = std::function<void(const std::string &method, const Json::Value &params)>;
+
+    explicit MockThunder(const MockThunderConfig &config);
+    ~MockThunder();
+
+    bool start();
+    void stop();
+
+    void setRequestObserver(RequestObserver observer);
+    void setPluginState(const std::string &callsign, const std::string &state);
+
+    // Sends an org.rdk.Xcast DIAL notification (e.g. "onApplicationLaunchRequest").
+    void emitDialEvent(const std::string &event, const std::string &appName, const std::string &appId,
+                       const std::string &payload = "");
+    size_t subscriberCount(const std::string &event);
+
+    // Maps launch, hide, resume, stop and state to the Xcast event name; nullptr otherwise.
+    static const char *dialEventName(const std::string &shortName);
+
+    MockThunder(const MockThunder &) = delete;
+    MockThunder &operator=(const MockThunder &) = delete;
+
+private:
+    struct Subscription {
+        websocketpp::connection_hdl hdl;
+        std::string id;
+    };
+
+    MockThunderConfig m_config;
+    wsserver m_server;
+    std::thread *mp_thread;
+    std::mt19937 m_random;
+
+    std::mutex m_stateMutex;
+    std::map<std::string, std::string> m_pluginStates;             // callsign -> Controller state
+    std::map<std::string, std::vector<Subscription>> m_subscribers; // event -> subscriptions
+    std::string m_friendlyName;
+    bool m_castingEnabled;
+    RequestObserver m_observer;
+
+    void onMessage(websocketpp::connection_hdl hdl, wsserver::message_ptr msg);
+    void onClose(websocketpp::connection_hdl hdl);
+    bool handleRequest(websocketpp::connection_hdl hdl, const std::string &method, const Json::Value &params,
+                       Json::Value &result, Json::Value &error);
+    void changePluginState(const std::string &callsign, const std::string &state, const char *shellEvent);
+    void notify(const std::string &event, const Json::Value &params);
+    void sendJson(websocketpp::connection_hdl hdl, const Json::Value &root);
+    int replyDelayMs();
+};
@@ -0,0 +1,98 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2022 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+
+#include "MockThunder.h"
+
+/***
+ * Stand-alone mock Thunder endpoint for running xdialtester off-device.
+ * Usage: xdialtester_mockthunder [--port=9998] [--latency-ms=N] [--jitter-ms=N] [--drop-rate=0.0-1.0]
+ *                                [--launch-ms=N] [--seed=N]
+ *
+ * DIAL requests are injected from stdin, one per line:
+ *     launch|hide|resume|stop|state <appName> [appId] [payload]
+ */
+int main(int argc, char *argv[])
+{
+    MockThunderConfig config;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        std::string value = arg.substr(arg.find("=") + 1);
+        if (arg.find("--port=") == 0) {
+            config.port = static_cast<uint16_t>(atoi(value.c_str()));
+        } else if (arg.find("--latency-ms=") == 0) {
+            config.latencyMs = atoi(value.c_str());
+        } else if (arg.find("--jitter-ms=") == 0) {
+            config.jitterMs = atoi(value.c_str());
+        } else if (arg.find("--drop-rate=") == 0) {
+            config.dropRate = atof(value.c_str());
+        } else if (arg.find("--launch-ms=") == 0) {
+            config.launchMs = atoi(value.c_str());
+        } else if (arg.find("--seed=") == 0) {
+            config.seed = static_cast<unsigned>(strtoul(value.c_str(), nullptr, 10));
+        } else {
+            fprintf(stderr, "Invalid argument %s. Usage: xdialtester_mockthunder [--port=9998] [--latency-ms=N] "
+                            "[--jitter-ms=N] [--drop-rate=R] [--launch-ms=N] [--seed=N]\n", arg.c_str());
+            return -1;
+        }
+    }
+
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+
+    MockThunder mock(config);
+    if (!mock.start())
+        return -1;
+    fprintf(stderr, "mockthunder: listening on ws://127.0.0.1:%u/jsonrpc\n", config.port);
+    mock.setRequestObserver([](const std::string &method, const Json::Value &) {
+        fprintf(stderr, "mockthunder: <- %s\n", method.c_str());
+    });
+
+    std::string line;
+    int autoId = 1;
+    while (std::getline(std::cin, line)) {
+        std::istringstream words(line);
+        std::string kind, app, appId, payload;
+        words >> kind >> app >> appId >> payload;
+        if (kind.empty())
+            continue;
+        const char *event = MockThunder::dialEventName(kind);
+        if (event == nullptr || app.empty()) {
+            fprintf(stderr, "mockthunder: expected 'launch|hide|resume|stop|state <appName> [appId] [payload]'\n");
+            continue;
+        }
+        if (appId.empty())
+            appId = std::to_string(autoId++);
+        mock.emitDialEvent(event, app, appId, payload);
+    }
+
+    // stdin closed (or not interactive); keep serving until signalled.
+    int sig = 0;
+    sigwait(&signals, &sig);
+    mock.stop();
+    return 0;
+}
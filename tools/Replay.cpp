@@ -0,0 +1,176 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2022 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <thread>
+
+#include "FrameRecorder.h"
+#include "JsonDocument.h"
+#include "ResponseHandler.h"
+#include "ThunderInterface.h"
+#include "Tracer.h"
+
+using Clock = std::chrono::steady_clock;
+
+// Mirrors Transport::processPayload: replies go to the response queue, everything
+// else that is not an unroutable JSON object ends up on the event queue.
+static bool reachesEventQueue(const std::string &payload)
+{
+    JsonDocument message;
+    if (!message.parse(payload))
+        return true;
+    return !message.root().isMember("id") && message.root().isMember("method");
+}
+
+static double percentileMs(std::vector<int64_t> &samples, double q)
+{
+    if (samples.empty())
+        return 0;
+    std::sort(samples.begin(), samples.end());
+    size_t rank = static_cast<size_t>(std::ceil(q * samples.size()));
+    return samples[std::min(samples.size(), std::max<size_t>(rank, 1)) - 1] / 1000.0;
+}
+
+static size_t countEventSpans(const std::vector<TraceSpan> &spans)
+{
+    return std::count_if(spans.begin(), spans.end(), [](const TraceSpan &span) { return span.name == "event"; });
+}
+
+/***
+ * Feeds the inbound frames of a capture written with `xdialtester --capture=<path>` back
+ * through Transport::processPayload and reports event throughput and per-event
+ * latency (queue wait plus dispatch) of the client pipeline. Nothing is sent to Thunder.
+ * Usage: xdialtester_replay <capture> [--speed=N] [--timeout-s=N]
+ *        --speed=1 replays in real time (default), N replays N times faster, 0 as fast as possible.
+ */
+int main(int argc, char *argv[])
+{
+    std::string path;
+    double speed = 1.0;
+    int timeoutSec = 60;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        std::string value = arg.substr(arg.find("=") + 1);
+        if (arg.find("--speed=") == 0) {
+            speed = atof(value.c_str());
+        } else if (arg.find("--timeout-s=") == 0) {
+            timeoutSec = atoi(value.c_str());
+        } else if (arg.find("--") != 0 && path.empty()) {
+            path = arg;
+        } else {
+            fprintf(stderr, "Invalid argument %s. Usage: xdialtester_replay <capture> [--speed=N] [--timeout-s=N]\n",
+                    arg.c_str());
+            return -1;
+        }
+    }
+    if (path.empty() || speed < 0) {
+        fprintf(stderr, "Usage: xdialtester_replay <capture> [--speed=N] [--timeout-s=N]\n");
+        return -1;
+    }
+
+    FrameReader reader;
+    if (!reader.open(path))
+        return -1;
+    std::vector<CapturedFrame> frames;
+    size_t outbound = 0;
+    size_t expectedEvents = 0;
+    CapturedFrame frame;
+    while (reader.next(frame)) {
+        if (frame.direction != FrameDirection::INBOUND) {
+            outbound++;
+            continue;
+        }
+        if (reachesEventQueue(frame.payload))
+            expectedEvents++;
+        frames.push_back(std::move(frame));
+    }
+    if (frames.empty()) {
+        fprintf(stderr, "%s has no inbound frames\n", path.c_str());
+        return -1;
+    }
+
+    // Every event leaves an "event" span, a "queue_wait" span and a few children.
+    Tracer::getInstance()->setCapacity(std::max<size_t>(Tracer::DEFAULT_CAPACITY, expectedEvents * 8));
+    ResponseHandler responses;
+    responses.initialize();
+    ThunderInterface iface(nullptr, &responses);
+    iface.initialize();
+
+    int64_t maxLagUs = 0;
+    auto start = Clock::now();
+    int64_t startUs = traceTimestampUs(start);
+    uint64_t firstNs = frames.front().timestampNs;
+    for (auto &captured : frames) {
+        if (speed > 0) {
+            auto due = start + std::chrono::nanoseconds(static_cast<int64_t>((captured.timestampNs - firstNs) / speed));
+            std::this_thread::sleep_until(due);
+            maxLagUs = std::max<int64_t>(maxLagUs,
+                std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - due).count());
+        }
+        iface.injectFrame(std::move(captured.payload));
+    }
+
+    std::vector<TraceSpan> spans = Tracer::getInstance()->snapshot();
+    auto deadline = Clock::now() + std::chrono::seconds(timeoutSec);
+    while (countEventSpans(spans) < expectedEvents && Clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        spans = Tracer::getInstance()->snapshot();
+    }
+    responses.shutdown();
+
+    std::map<std::string, std::vector<int64_t>> latencyUs;
+    std::vector<int64_t> queueWaitUs;
+    std::vector<int64_t> all;
+    int64_t endUs = startUs;
+    for (const TraceSpan &span : spans) {
+        if (span.name == "event") {
+            latencyUs[span.detail.empty() ? "unknown" : span.detail].push_back(span.durationUs);
+            all.push_back(span.durationUs);
+            endUs = std::max(endUs, span.startUs + span.durationUs);
+        } else if (span.name == "queue_wait") {
+            queueWaitUs.push_back(span.durationUs);
+        }
+    }
+
+    double elapsed = (endUs - startUs) / 1e6;
+    char pace[32] = "max";
+    if (speed > 0)
+        snprintf(pace, sizeof(pace), "%gx", speed);
+    printf("frames: %zu inbound, %zu outbound skipped  events: %zu of %zu processed  speed: %s\n", frames.size(),
+           outbound, all.size(), expectedEvents, pace);
+    printf("elapsed: %.3f s  throughput: %.2f events/s  max pacing lag: %.2f ms\n", elapsed,
+           elapsed > 0 ? all.size() / elapsed : 0.0, maxLagUs / 1000.0);
+    printf("%-36s %8s %10s %10s %10s\n", "event", "count", "p50 ms", "p99 ms", "max ms");
+    for (auto &entry : latencyUs) {
+        auto &samples = entry.second;
+        printf("%-36s %8zu %10.3f %10.3f %10.3f\n", entry.first.c_str(), samples.size(), percentileMs(samples, 0.50),
+               percentileMs(samples, 0.99), percentileMs(samples, 1.0));
+    }
+    printf("%-36s %8zu %10.3f %10.3f %10.3f\n", "(queue wait)", queueWaitUs.size(), percentileMs(queueWaitUs, 0.50),
+           percentileMs(queueWaitUs, 0.99), percentileMs(queueWaitUs, 1.0));
+    printf("%-36s %8zu %10.3f %10.3f %10.3f\n", "all", all.size(), percentileMs(all, 0.50), percentileMs(all, 0.99),
+           percentileMs(all, 1.0));
+    return all.size() == expectedEvents ? 0 : 1;
+}
@@ -0,0 +1,58 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2022 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "ScriptedThunder.h"
+
+ScriptedThunder::ScriptedThunder(LoopbackTransport &transport)
+    : m_transport(transport), m_defaultResult(R"({"success":true})")
+{
+    m_transport.setPeer([this](const std::string &frame) { onFrame(frame); });
+}
+
+void ScriptedThunder::setResult(const std::string &method, const std::string &resultJson)
+{
+    m_results[method] = resultJson;
+}
+
+void ScriptedThunder::emitEvent(const std::string &method, const std::string &paramsJson)
+{
+    m_transport.deliver(R"({"jsonrpc":"2.0","method":")" + method + R"(","params":)" + paramsJson + "}");
+}
+
+// Requests come from ProtocolHandler's compact writer, so a plain scan finds id and method.
+void ScriptedThunder::onFrame(const std::string &frame)
+{
+    size_t idPos = frame.find("\"id\":");
+    size_t methodPos = frame.find("\"method\":\"");
+    if (idPos == std::string::npos || methodPos == std::string::npos)
+        return;
+    // ProtocolHandler sends the id as a string; Thunder parses it and replies with a number.
+    idPos = frame.find_first_not_of('"', idPos + 5);
+    std::string id = frame.substr(idPos, frame.find_first_of("\",}", idPos) - idPos);
+    methodPos += 10;
+    std::string method = frame.substr(methodPos, frame.find('"', methodPos) - methodPos);
+
+    auto it = m_results.find(method);
+    if (it == m_results.end())
+        it = m_results.find(method.substr(0, method.find('@')));
+    const std::string &result = (it != m_results.end()) ? it->second : m_defaultResult;
+
+    std::string reply = R"({"jsonrpc":"2.0","id":)" + id + R"(,"result":)" + result + "}";
+    m_transport.deliver(std::move(reply));
+}
@@ -0,0 +1,48 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2022 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <map>
+#include <string>
+#include "LoopbackTransport.h"
+
+/*
+ * Canned Thunder for LoopbackTransport: answers every request synchronously with the
+ * result scripted for its method, on the sending thread. The client side can then be
+ * measured without a network stack or a JSON parser on the Thunder side.
+ */
+class ScriptedThunder
+{
+    LoopbackTransport &m_transport;
+    std::map<std::string, std::string> m_results;  // method -> JSON text of "result"
+    std::string m_defaultResult;
+
+public:
+    explicit ScriptedThunder(LoopbackTransport &transport);
+
+    // method may be a full designator ("Controller.1.status@Cobalt") or the part before '@'.
+    void setResult(const std::string &method, const std::string &resultJson);
+    void setDefaultResult(const std::string &resultJson) { m_defaultResult = resultJson; }
+
+    // Sends a notification, e.g. emitEvent("1003.onApplicationLaunchRequest", "{...}").
+    void emitEvent(const std::string &method, const std::string &paramsJson);
+
+private:
+    void onFrame(const std::string &frame);
+};
@@ -0,0 +1,300 @@
+/*
+ * If not stated otherwise in this file or this component's LICENSE file the
+ * following copyright and licenses apply:
+ *
+ * Copyright 2022 RDK Management
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <sstream>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+
+#include "ClientProcess.h"
+#include "MockThunder.h"
+
+#ifndef XDIALTESTER_PATH
+#define XDIALTESTER_PATH "xdialtester"
+#endif
+
+using Clock = std::chrono::steady_clock;
+
+// A sampled series and the growth it may show after warm-up, in units per hour.
+struct Series {
+    const char *column;
+    const char *metric;
+    double maxSlopePerHour;
+};
+
+static Series g_series[] = {
+    {"rss_bytes", "process_resident_bytes", 512 * 1024},
+    {"heap_bytes", "process_heap_inuse_bytes", 256 * 1024},
+    {"open_fds", "process_open_fds", 1},
+    {"threads", "process_threads", 1},
+    {"pending_requests", "thunder_requests_pending", 1},
+    {"event_queue_depth", "event_queue_depth", 1},
+};
+
+// Sends one command to the stats socket and returns the reply, empty on failure.
+static std::string queryStats(const std::string &socketPath, const char *command)
+{
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+        return "";
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, socketPath.c_str(), sizeof(addr.sun_path) - 1);
+    std::string reply;
+    if (connect(fd, reinterpret_cast<struct sockaddr *>(&addr), sizeof(addr)) == 0) {
+        std::string request = std::string(command) + "\n";
+        if (write(fd, request.data(), request.size()) == static_cast<ssize_t>(request.size())) {
+            char buf[4096];
+            ssize_t n;
+            while ((n = read(fd, buf, sizeof(buf))) > 0)
+                reply.append(buf, n);
+        }
+    }
+    close(fd);
+    return reply;
+}
+
+// Picks unlabelled samples out of Prometheus text.
+static std::map<std::string, double> parseMetrics(const std::string &text)
+{
+    std::map<std::string, double> values;
+    std::istringstream lines(text);
+    std::string line;
+    while (std::getline(lines, line)) {
+        if (line.empty() || line[0] == '#' || line.find('{') != std::string::npos)
+            continue;
+        size_t space = line.find(' ');
+        if (space != std::string::npos)
+            values[line.substr(0, space)] = atof(line.c_str() + space + 1);
+    }
+    return values;
+}
+
+// Least squares slope of y over x.
+static double slope(const std::vector<double> &x, const std::vector<double> &y)
+{
+    size_t n = x.size();
+    if (n < 2)
+        return 0;
+    double mx = 0, my = 0;
+    for (size_t i = 0; i < n; i++) {
+        mx += x[i];
+        my += y[i];
+    }
+    mx /= n;
+    my /= n;
+    double num = 0, den = 0;
+    for (size_t i = 0; i < n; i++) {
+        num += (x[i] - mx) * (y[i] - my);
+        den += (x[i] - mx) * (x[i] - mx);
+    }
+    return den > 0 ? num / den : 0;
+}
+
+static bool setLimit(const std::string &column, double limit)
+{
+    for (auto &series : g_series) {
+        if (column == series.column) {
+            series.maxSlopePerHour = limit;
+            return true;
+        }
+    }
+    return false;
+}
+
+/***
+ * Runs xdialtester against the mock Thunder endpoint for hours, cycling DIAL launch, hide,
+ * state and stop requests across apps. RSS, heap in use, open fds, threads, pending requests
+ * and event queue depth are sampled from the stats socket into a CSV file. The run fails
+ * when any series grows faster than its limit after warm-up.
+ * Usage: xdialtester_soak [--xdialtester=path] [--port=19997] [--duration-s=3600] [--interval-s=10]
+ *                         [--warmup-s=300] [--rate=cycles/s] [--apps=YouTube,Netflix,Amazon] [--csv=soak.csv]
+ *                         [--max-slope=<column>:<per hour>] [--latency-ms=N] [--jitter-ms=N] [--drop-rate=R]
+ *                         [--seed=N] [--verbose] [-- <extra xdialtester args>]
+ */
+int main(int argc, char *argv[])
+{
+    MockThunderConfig config;
+    config.port = 19997;
+    std::string clientPath = XDIALTESTER_PATH;
+    std::string csvPath = "soak.csv";
+    std::vector<std::string> apps = {"YouTube", "Netflix", "Amazon"};
+    std::vector<std::string> clientArgs;
+    int durationSec = 3600;
+    int intervalSec = 10;
+    int warmupSec = 300;
+    double rate = 0.25;
+    bool verbose = false;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        std::string value = arg.substr(arg.find("=") + 1);
+        if (arg == "--") {
+            clientArgs.assign(argv + i + 1, argv + argc);
+            break;
+        } else if (arg.find("--xdialtester=") == 0) {
+            clientPath = value;
+        } else if (arg.find("--port=") == 0) {
+            config.port = static_cast<uint16_t>(atoi(value.c_str()));
+        } else if (arg.find("--duration-s=") == 0) {
+            durationSec = atoi(value.c_str());
+        } else if (arg.find("--interval-s=") == 0) {
+            intervalSec = atoi(value.c_str());
+        } else if (arg.find("--warmup-s=") == 0) {
+            warmupSec = atoi(value.c_str());
+        } else if (arg.find("--rate=") == 0) {
+            rate = atof(value.c_str());
+        } else if (arg.find("--apps=") == 0) {
+            apps.clear();
+            std::stringstream list(value);
+            std::string app;
+            while (std::getline(list, app, ','))
+                if (!app.empty())
+                    apps.push_back(app);
+        } else if (arg.find("--csv=") == 0) {
+            csvPath = value;
+        } else if (arg.find("--max-slope=") == 0) {
+            size_t colon = value.find(':');
+            if (colon == std::string::npos || !setLimit(value.substr(0, colon), atof(value.c_str() + colon + 1))) {
+                fprintf(stderr, "Invalid limit %s; use <column>:<growth per hour>\n", value.c_str());
+                return -1;
+            }
+        } else if (arg.find("--latency-ms=") == 0) {
+            config.latencyMs = atoi(value.c_str());
+        } else if (arg.find("--jitter-ms=") == 0) {
+            config.jitterMs = atoi(value.c_str());
+        } else if (arg.find("--drop-rate=") == 0) {
+            config.dropRate = atof(value.c_str());
+        } else if (arg.find("--seed=") == 0) {
+            config.seed = static_cast<unsigned>(strtoul(value.c_str(), nullptr, 10));
+        } else if (arg == "--verbose") {
+            verbose = true;
+        } else {
+            fprintf(stderr, "Invalid argument %s\n", arg.c_str());
+            return -1;
+        }
+    }
+    if (apps.empty() || rate <= 0 || intervalSec <= 0 || durationSec <= warmupSec) {
+        fprintf(stderr, "Nothing to run: need apps, a positive rate and interval, and a duration beyond warm-up\n");
+        return -1;
+    }
+
+    FILE *csv = fopen(csvPath.c_str(), "w");
+    if (csv == nullptr) {
+        fprintf(stderr, "Unable to write %s: %s\n", csvPath.c_str(), strerror(errno));
+        return -1;
+    }
+    fprintf(csv, "elapsed_s,cycles");
+    for (const auto &series : g_series)
+        fprintf(csv, ",%s", series.column);
+    fprintf(csv, "\n");
+
+    std::atomic<uint64_t> requests{0};
+    MockThunder mock(config);
+    mock.setRequestObserver([&requests](const std::string &, const Json::Value &) { requests++; });
+    if (!mock.start())
+        return -1;
+
+    std::string statsSocket = "/tmp/xdialtester-soak-" + std::to_string(getpid()) + ".sock";
+    clientArgs.insert(clientArgs.begin(), "--stats-socket=" + statsSocket);
+    pid_t client = spawnClient(clientPath, config.port, clientArgs, verbose);
+    if (client < 0) {
+        fprintf(stderr, "Failed to start %s\n", clientPath.c_str());
+        return -1;
+    }
+
+    std::atomic<bool> running{true};
+    std::atomic<uint64_t> cycles{0};
+    std::thread driver([&] {
+        static const char *steps[] = {"launch", "hide", "state", "stop"};
+        auto next = Clock::now();
+        for (uint64_t n = 0; running.load(); n++) {
+            const std::string &app = apps[n % apps.size()];
+            for (const char *step : steps)
+                mock.emitDialEvent(MockThunder::dialEventName(step), app, "soak-" + std::to_string(n),
+                                   strcmp(step, "launch") == 0 ? "v=soak" : "");
+            cycles++;
+            next += std::chrono::microseconds(static_cast<int64_t>(1e6 / rate));
+            while (running.load() && Clock::now() < next)
+                std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        }
+    });
+
+    std::vector<double> times;
+    std::vector<std::vector<double>> samples(sizeof(g_series) / sizeof(g_series[0]));
+    bool clientDied = false;
+    auto start = Clock::now();
+    for (int tick = 1; tick * intervalSec <= durationSec; tick++) {
+        std::this_thread::sleep_until(start + std::chrono::seconds(tick * intervalSec));
+        if (waitpid(client, nullptr, WNOHANG) == client) {
+            fprintf(stderr, "xdialtester exited after %d s\n", tick * intervalSec);
+            clientDied = true;
+            break;
+        }
+        std::map<std::string, double> values = parseMetrics(queryStats(statsSocket, "metrics"));
+        if (values.empty())
+            continue;
+
+        double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+        fprintf(csv, "%.1f,%llu", elapsed, static_cast<unsigned long long>(cycles.load()));
+        for (size_t i = 0; i < samples.size(); i++) {
+            double value = values[g_series[i].metric];
+            fprintf(csv, ",%.0f", value);
+            if (elapsed >= warmupSec)
+                samples[i].push_back(value);
+        }
+        fprintf(csv, "\n");
+        fflush(csv);
+        if (elapsed >= warmupSec)
+            times.push_back(elapsed / 3600.0);
+    }
+
+    running = false;
+    driver.join();
+    if (!clientDied)
+        stopClient(client);
+    mock.stop();
+    fclose(csv);
+
+    bool failed = clientDied || times.size() < 3;
+    if (times.size() < 3)
+        fprintf(stderr, "Too few samples after warm-up to judge growth\n");
+    printf("cycles: %llu  requests: %llu  samples after warm-up: %zu  csv: %s\n",
+           static_cast<unsigned long long>(cycles.load()), static_cast<unsigned long long>(requests.load()),
+           times.size(), csvPath.c_str());
+    printf("%-20s %14s %14s %16s %16s\n", "series", "first", "last", "slope/hour", "limit/hour");
+    for (size_t i = 0; i < samples.size() && times.size() >= 3; i++) {
+        double growth = slope(times, samples[i]);
+        bool over = growth > g_series[i].maxSlopePerHour;
+        failed = failed || over;
+        printf("%-20s %14.0f %14.0f %16.1f %16.1f%s\n", g_series[i].column, samples[i].front(), samples[i].back(),
+               growth, g_series[i].maxSlopePerHour, over ? "  FAIL" : "");
+    }
+    return failed ? 1 : 0;
+}